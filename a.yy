@@ -79,6 +79,7 @@
 %token	<a_lang::Token *>       INT
 %token	<a_lang::IntLitToken *> INTLITERAL
 %token	<a_lang::Token *>       IMMUTABLE
+%token	<a_lang::Token *>       IMPORT
 %token	<a_lang::Token *>       LCURLY
 %token	<a_lang::Token *>       LESS
 %token	<a_lang::Token *>       LESSEQ
@@ -115,6 +116,7 @@
 */
 /*       (attribute type)    (nonterminal)    */
 %type <a_lang::ProgramNode *> program
+%type <std::list<a_lang::ImportNode *> *> imports
 %type <std::list<a_lang::DeclNode *> *> globals
 %type <a_lang::DeclNode *> decl
 %type <a_lang::VarDeclNode *> varDecl
@@ -156,12 +158,23 @@
 %%
 
 
-program		: globals
+program		: imports globals
 		  {
-		  $$ = new ProgramNode($1);
+		  $$ = new ProgramNode($1, $2);
 		  *root = $$;
 		  }
 
+imports		: imports IMPORT STRINGLITERAL SEMICOL
+		  {
+		  $$ = $1;
+		  Position * p = new Position($2->pos(), $4->pos());
+		  $$->push_back(new ImportNode(p, $3->str()));
+		  }
+		| /* epsilon */
+		  {
+		  $$ = AstArena::track(new std::list<ImportNode *>());
+		  }
+
 globals		: globals decl
 		  {
 		  $$ = $1;
@@ -170,7 +183,7 @@ globals		: globals decl
 		  }
 		| /* epsilon */
 		  {
-		  $$ = new std::list<DeclNode *>();
+		  $$ = AstArena::track(new std::list<DeclNode *>());
 		  }
 
 decl		: varDecl SEMICOL
@@ -179,9 +192,11 @@ decl		: varDecl SEMICOL
 		  }
 		| classTypeDecl
 		  {
+		  $$ = $1;
 		  }
 		| fnDecl
 		  {
+		  $$ = $1;
 		  }
 
 varDecl		: name COLON type
@@ -197,6 +212,8 @@ varDecl		: name COLON type
 
 type		: IMMUTABLE datatype
 		  {
+		  Position * p = new Position($1->pos(), $2->pos());
+		  $$ = new ImmutableTypeNode(p, $2);
 		  }
 		| datatype
 		  {
@@ -254,7 +271,7 @@ classBody       : classBody varDecl SEMICOL
       }
       | /* epsilon */
       {
-      $$ = new std::list<DeclNode *>();
+      $$ = AstArena::track(new std::list<DeclNode *>());
       }
 
 fnDecl 		: name COLON LPAREN maybeFormals RPAREN ARROW type LCURLY stmtList RCURLY
@@ -265,7 +282,7 @@ fnDecl 		: name COLON LPAREN maybeFormals RPAREN ARROW type LCURLY stmtList RCUR
 
 maybeFormals	: /* epsilon */
 		  {
-		  $$ = new std::list<FormalDeclNode *>();
+		  $$ = AstArena::track(new std::list<FormalDeclNode *>());
 		  }
 		| formalList
 		  {
@@ -274,7 +291,7 @@ maybeFormals	: /* epsilon */
 
 formalList	: formalDecl
 		  {
-		  $$ = new std::list<FormalDeclNode *>();
+		  $$ = AstArena::track(new std::list<FormalDeclNode *>());
 		  $$->push_back($1);
 		  }
 		| formalList COMMA formalDecl
@@ -291,7 +308,7 @@ formalDecl	: name COLON type
 
 stmtList	: /* epsilon */
 		  {
-		  $$ = new std::list<StmtNode *>();
+		  $$ = AstArena::track(new std::list<StmtNode *>());
 		  }
 		| stmtList stmt SEMICOL
 		  {
@@ -448,7 +465,7 @@ callExp		: loc LPAREN RPAREN
 		  {
 		  const Position * p = new Position($1->pos(), $3->pos());
 		  std::list<ExpNode *> * noargs =
-		    new std::list<ExpNode *>();
+		    AstArena::track(new std::list<ExpNode *>());
 		  $$ = new CallExpNode(p, $1, noargs);
 		  }
 		| loc LPAREN actualsList RPAREN
@@ -460,7 +477,7 @@ callExp		: loc LPAREN RPAREN
 actualsList	: exp
 		  {
 		  std::list<ExpNode *> * list =
-		    new std::list<ExpNode *>();
+		    AstArena::track(new std::list<ExpNode *>());
 		  list->push_back($1);
 		  $$ = list;
 		  }
@@ -493,6 +510,8 @@ loc		: name
 		  }
 		| loc ARROW name
 		  {
+		  const Position * p = new Position($1->pos(), $3->pos());
+		  $$ = new MemberFieldExpNode(p, $1, $3);
 		  }
 
 name		: ID
@@ -504,6 +523,11 @@ name		: ID
 %%
 
 void a_lang::Parser::error(const std::string& msg){
+	if (a_lang::Report::collector() != nullptr){
+		a_lang::Position at = scanner.here();
+		a_lang::Report::fatal(&at, msg);
+		return;
+	}
 	std::cout << msg << std::endl;
 	std::cerr << "syntax error" << std::endl;
 }
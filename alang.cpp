@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <streambuf>
+#include "alang.hpp"
+#include "scanner.hpp"
+
+namespace a_lang{
+
+/* A read-only stream buffer over bytes the caller owns, so the
+   scanner reads the source where it already is */
+class SourceBuf : public std::streambuf{
+public:
+	SourceBuf(const char * data, size_t len){
+		char * start = const_cast<char *>(data);
+		setg(start, start, start + len);
+	}
+};
+
+std::unique_ptr<CompilationUnit> parseSource(const char * data, size_t len){
+	std::unique_ptr<CompilationUnit> unit(new CompilationUnit());
+	SourceBuf buf(data, len);
+	std::istream in(&buf);
+
+	std::vector<Report::Diagnostic> * outer = Report::collector();
+	Report::collector() = &unit->myDiagnostics;
+	try {
+		AstArena::Scope scope(&unit->myArena);
+		ProgramNode * root = nullptr;
+		Scanner scanner(&in);
+		Parser parser(scanner, &root);
+		if (parser.parse() == 0){ unit->myAst = root; }
+	} catch (...){
+		Report::collector() = outer;
+		throw;
+	}
+	Report::collector() = outer;
+	return unit;
+}
+
+std::unique_ptr<CompilationUnit> parseSource(const std::string& text){
+	return parseSource(text.data(), text.size());
+}
+
+size_t CompilationUnit::unparse(char * buf, size_t cap) const{
+	if (myAst == nullptr){
+		if (cap > 0){ buf[0] = '\0'; }
+		return 0;
+	}
+	if (!myUnparseDone){
+		std::stringstream text;
+		myAst->unparse(text, 0);
+		myUnparsed = text.str();
+		myUnparseDone = true;
+	}
+	if (cap > 0){
+		size_t n = std::min(myUnparsed.size(), cap - 1);
+		memcpy(buf, myUnparsed.data(), n);
+		buf[n] = '\0';
+	}
+	return myUnparsed.size();
+}
+
+}
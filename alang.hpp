@@ -0,0 +1,56 @@
+#ifndef A_LANG_ALANG_HPP
+#define A_LANG_ALANG_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "arena.hpp"
+#include "ast.hpp"
+#include "errors.hpp"
+
+/* The interface to libalang, the frontend as a library: parse
+   a-lang source held in memory and get its AST and canonical
+   form, with no files and no ac process involved. */
+
+namespace a_lang{
+
+/** A parsed a-lang source, which owns its AST: the tree is
+ * freed with the unit. Units are independent, so different
+ * threads may parse and use their own at the same time. **/
+class CompilationUnit{
+public:
+	CompilationUnit(const CompilationUnit&) = delete;
+	CompilationUnit& operator=(const CompilationUnit&) = delete;
+	/** Whether the source parsed. If not, ast() is null and the
+	 * syntax errors are among the diagnostics. **/
+	bool ok() const { return myAst != nullptr; }
+	ProgramNode * ast() const { return myAst; }
+	/** The errors found, in the order they were found **/
+	const std::vector<Report::Diagnostic>& diagnostics() const {
+		return myDiagnostics;
+	}
+	/** Write the program's canonical form into buf, truncated to
+	 * fit and NUL-terminated if cap > 0. Returns the length of
+	 * the whole text (as snprintf does), so a caller whose buffer
+	 * was too small can retry with one of that length plus one.
+	 * A unit that did not parse has no text. **/
+	size_t unparse(char * buf, size_t cap) const;
+private:
+	CompilationUnit(){ }
+	friend std::unique_ptr<CompilationUnit> parseSource(const char *,
+	  size_t);
+	AstArena myArena;
+	ProgramNode * myAst = nullptr;
+	std::vector<Report::Diagnostic> myDiagnostics;
+	mutable std::string myUnparsed;
+	mutable bool myUnparseDone = false;
+};
+
+/** Parse len bytes of a-lang source at data. The bytes are read
+ * in place, not copied, and need only last for the call. **/
+std::unique_ptr<CompilationUnit> parseSource(const char * data, size_t len);
+std::unique_ptr<CompilationUnit> parseSource(const std::string& text);
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef A_LANG_ARENA_HPP
+#define A_LANG_ARENA_HPP
+
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace a_lang{
+
+class Position;
+
+/** Owns everything a parse allocates (AST nodes, tokens,
+ * positions and the lists that hold them) while it is the
+ * current arena, and frees it all when it goes. With no current
+ * arena, as in ac itself, nothing is tracked and the AST lives
+ * until the process exits. Each thread has its own current
+ * arena. **/
+class AstArena{
+public:
+	AstArena(){ }
+	AstArena(const AstArena&) = delete;
+	AstArena& operator=(const AstArena&) = delete;
+	~AstArena(){
+		for (auto& owned : myOwned){ owned.second(owned.first); }
+	}
+
+	static AstArena *& current(){
+		static thread_local AstArena * arena = nullptr;
+		return arena;
+	}
+
+	/** Give p to the current arena, if any, to be deleted as a T **/
+	template <typename T>
+	static T * track(T * p){
+		if (current() != nullptr){
+			current()->myOwned.emplace_back(p, [](void * q){
+				delete static_cast<T *>(q);
+			});
+		}
+		return p;
+	}
+
+	/** The positions made while this was current, so that what
+	 * was parsed into it can be moved to other lines **/
+	std::vector<Position *>& positions(){ return myPositions; }
+
+	/** Make arena current for as long as this lives **/
+	class Scope{
+	public:
+		Scope(AstArena * arena) : myOuter(current()){ current() = arena; }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		~Scope(){ current() = myOuter; }
+	private:
+		AstArena * myOuter;
+	};
+private:
+	std::vector<std::pair<void *, void (*)(void *)>> myOwned;
+	std::vector<Position *> myPositions;
+};
+
+}
+
+#endif
@@ -1,11 +1,19 @@
 #include "ast.hpp"
 
-a_lang::ProgramNode::ProgramNode(std::list<DeclNode *> * globalsIn)
-: ASTNode(new Position(0,0,0,0)), myGlobals(globalsIn){
+a_lang::ProgramNode::ProgramNode(std::list<ImportNode *> * importsIn,
+  std::list<DeclNode *> * globalsIn)
+: ASTNode(new Position(0,0,0,0)), myImports(importsIn), myGlobals(globalsIn){
 	if (!globalsIn->empty()){
+		const Position * first = importsIn->empty()
+		  ? myGlobals->front()->pos() : importsIn->front()->pos();
 		myPos = new Position(
-			myGlobals->front()->pos(),
+			first,
 			myGlobals->back()->pos()
 		);
 	}
 }
+
+// The lexeme keeps its quotes
+a_lang::ImportNode::ImportNode(const Position * p, std::string lexeme)
+: ASTNode(p), myPath(lexeme.substr(1, lexeme.length() - 2)){
+}
@@ -18,6 +18,28 @@ class DeclNode;
 class TypeNode;
 class StmtNode;
 class IDNode;
+class FnDeclNode;
+class ClassDefnNode;
+
+/* Used by the C backend (see cgen.hpp) */
+class CGen;
+class CType;
+class CGenOpts;
+class CRange;
+
+/* Used by name analysis (see names.hpp) */
+class NameIndex;
+class NameDecl;
+
+/* Used by module interfaces (see module.hpp) */
+class ModuleWriter;
+
+/* Used by the native backend (see ir.hpp) */
+class IrGen;
+class IrPlace;
+class IrProgram;
+class IrValue;
+enum class IrOp : int;
 
 /** 
 * \class ASTNode
@@ -25,7 +47,8 @@ class IDNode;
 **/
 class ASTNode{
 public:
-	ASTNode(const Position * p) : myPos(p){ }
+	ASTNode(const Position * p) : myPos(p){ AstArena::track(this); }
+	virtual ~ASTNode(){ }
 	virtual void unparse(std::ostream& out, int indent) = 0;
 	const Position * pos() { return myPos; }
 	std::string posStr() { return pos()->span(); }
@@ -33,6 +56,17 @@ protected:
 	const Position * myPos = nullptr;
 };
 
+/** An import of another module, as in 'import "shapes.a";'.
+ * The path is relative to the importing file. **/
+class ImportNode : public ASTNode{
+public:
+	ImportNode(const Position * p, std::string lexeme);
+	void unparse(std::ostream& out, int indent) override;
+	std::string getPath() const { return myPath; }
+private:
+	std::string myPath;
+};
+
 /** 
 * \class ProgramNode
 * Class that contains the entire abstract syntax tree for a program.
@@ -42,9 +76,16 @@ protected:
 **/
 class ProgramNode : public ASTNode{
 public:
-	ProgramNode(std::list<DeclNode *> * globalsIn) ;
+	ProgramNode(std::list<ImportNode *> * importsIn,
+	  std::list<DeclNode *> * globalsIn) ;
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(std::ostream& out, const CGenOpts& opts);
+	/** Lower the program to the IR of the native backend **/
+	void lower(IrProgram& program, const CGenOpts& opts);
+	std::list<ImportNode *> * getImports() const { return myImports; }
+	std::list<DeclNode *> * getGlobals() const { return myGlobals; }
 private:
+	std::list<ImportNode *> * myImports;
 	std::list<DeclNode * > * myGlobals;
 };
 
@@ -52,6 +93,11 @@ class StmtNode : public ASTNode{
 public:
 	StmtNode(const Position * p) : ASTNode(p){ }
 	void unparse(std::ostream& out, int indent) override = 0;
+	virtual void emitC(CGen * gen, std::ostream& out, int indent) = 0;
+	/** Lower to the IR (see lower.cpp) **/
+	virtual void lower(IrGen * gen) = 0;
+	/** Resolve the names used here (see names.cpp) **/
+	virtual void nameAnalysis(NameIndex * names) = 0;
 };
 
 
@@ -63,6 +109,18 @@ class DeclNode : public StmtNode{
 public:
 	DeclNode(const Position * p) : StmtNode(p) { }
 	void unparse(std::ostream& out, int indent) override = 0;
+	/** Emit the C declarations (types, prototypes, storage)
+	 * for a global, making it visible to later code **/
+	virtual void cDeclare(CGen * gen, std::ostream& out) = 0;
+	/** Emit the C definitions (bodies, initializers) **/
+	virtual void cDefine(CGen * gen, std::ostream& out) = 0;
+	/** Lower a global: its storage, code and initialization **/
+	virtual void lowerGlobal(IrGen * gen) = 0;
+	/** Make the declared name visible to name analysis **/
+	virtual void nameDeclare(NameIndex * names) = 0;
+	/** Write what importers of the module see of this
+	 * declaration (see module.cpp) **/
+	virtual void exportDecl(ModuleWriter& out) = 0;
 };
 
 /**  \class ExpNode
@@ -75,6 +133,22 @@ protected:
 	ExpNode(const Position * p) : ASTNode(p){ }
 public:
 	virtual void unparseNested(std::ostream& out);
+	/** Emit this expression as C and return its type **/
+	virtual CType emitC(CGen * gen, std::ostream& out) = 0;
+	/** True if evaluating this expression has no effects and
+	 * cannot fail, so C code may evaluate it unconditionally **/
+	virtual bool cSpeculable(CGen * gen){ return true; }
+	/** The values this expression can take if it is an int
+	 * (see crange.cpp) **/
+	virtual CRange cRange(CGen * gen);
+	/** Narrow the ranges of int locals, given that this
+	 * (bool) expression evaluated to truth **/
+	virtual void cRefine(CGen * gen, bool truth){ }
+	/** Lower to the IR, returning where the value is **/
+	virtual IrValue lower(IrGen * gen) = 0;
+	/** Resolve the names used here and, for a location,
+	 * return what it refers to if that is known **/
+	virtual const NameDecl * nameAnalysis(NameIndex * names);
 }; // Added a virtual unparseNested to deal with expressions better
 
 /**  \class TypeNode
@@ -88,6 +162,13 @@ protected:
 	}
 public:
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	virtual CType cType(CGen * gen) = 0;
+	virtual void nameAnalysis(NameIndex * names);
+	/** Write this type into a module interface **/
+	virtual void exportType(ModuleWriter& out) = 0;
+	/** The custom type this names, if any, ignoring ref and
+	 * immutable **/
+	virtual std::string className();
 };
 
 /** A memory location. LocNodes subclass ExpNode
@@ -98,6 +179,9 @@ public:
 	LocNode(const Position * p)
 	: ExpNode(p) {}
 	void unparse(std::ostream& out, int indent) = 0;
+	IrValue lower(IrGen * gen) override;
+	/** Where the location is, in the IR **/
+	virtual IrPlace lowerPlace(IrGen * gen) = 0;
 };
 
 /** An identifier. Note that IDNodes subclass
@@ -108,11 +192,38 @@ public:
 	IDNode(const Position * p, std::string nameIn) 
 	: LocNode(p), name(nameIn){ }
 	void unparse(std::ostream& out, int indent);
+	CType emitC(CGen * gen, std::ostream& out) override;
+	bool cSpeculable(CGen * gen) override;
+	CRange cRange(CGen * gen) override;
+	IrPlace lowerPlace(IrGen * gen) override;
+	const NameDecl * nameAnalysis(NameIndex * names) override;
+	std::string getName() const { return name; }
 private:
 	/** The name of the identifier **/
 	std::string name;
 };
 
+/** A field (or method) of a custom object, as in "obj->field".
+ * The base can itself be a member access, so "a->b->c"
+ * nests to the left.
+**/
+class MemberFieldExpNode : public LocNode{
+public:
+	MemberFieldExpNode(const Position * p, LocNode * inBase,
+	  IDNode * inField)
+	: LocNode(p), myBase(inBase), myField(inField){ }
+	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	bool cSpeculable(CGen * gen) override;
+	IrPlace lowerPlace(IrGen * gen) override;
+	const NameDecl * nameAnalysis(NameIndex * names) override;
+	LocNode * getBase() const { return myBase; }
+	IDNode * getField() const { return myField; }
+private:
+	LocNode * myBase;
+	IDNode * myField;
+};
+
  
 /** A variable declaration.
 **/
@@ -122,8 +233,17 @@ public:
 	TypeNode * inType, ExpNode * inInit)
 	: DeclNode(p), myID(inID), myType(inType), myInit(inInit){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void cDeclare(CGen * gen, std::ostream& out) override;
+	void cDefine(CGen * gen, std::ostream& out) override;
+	void lower(IrGen * gen) override;
+	void lowerGlobal(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
+	void nameDeclare(NameIndex * names) override;
+	void exportDecl(ModuleWriter& out) override;
 	IDNode * ID(){ return myID; }
 	TypeNode * getTypeNode() const{ return myType; }
+	ExpNode * getInit() const{ return myInit; }
 private:
 	IDNode * myID;
 	TypeNode * myType;
@@ -136,29 +256,43 @@ class IntTypeNode : public TypeNode{
 public:
 	IntTypeNode(const Position * p) : TypeNode(p){ }
 	void unparse(std::ostream& out, int indent);
+	CType cType(CGen * gen) override;
+	void exportType(ModuleWriter& out) override;
 };
 
 class BoolTypeNode : public TypeNode{
 public:
     BoolTypeNode(const Position * p) : TypeNode(p){ }
     void unparse(std::ostream& out, int indent) override;
+    CType cType(CGen * gen) override;
+    void exportType(ModuleWriter& out) override;
 };
 
 /* More complex types */
 
 class ClassTypeNode : public TypeNode{
 public:
-	ClassTypeNode(const Position * p, IDNode * inID)
-	: TypeNode(p), myID(inID){}
+	ClassTypeNode(const Position * p, IDNode * inID,
+	  std::string inModule = "")
+	: TypeNode(p), myID(inID), myModule(inModule){}
 	void unparse(std::ostream& out, int indent) override;
+	CType cType(CGen * gen) override;
+	void exportType(ModuleWriter& out) override;
+	void nameAnalysis(NameIndex * names) override;
+	std::string className() override;
 private:
 	IDNode * myID;
+	/* The tag of the module that declares the type, when it was
+	   read from an interface. In source, a type is just named. */
+	std::string myModule;
 };
 
 class VoidTypeNode : public TypeNode{
 public:
     VoidTypeNode(const Position * p) : TypeNode(p){ }
     void unparse(std::ostream& out, int indent) override;
+    CType cType(CGen * gen) override;
+    void exportType(ModuleWriter& out) override;
 };
 
 class ImmutableTypeNode : public TypeNode{
@@ -166,6 +300,10 @@ public:
 	ImmutableTypeNode(const Position * p, TypeNode * inSub)
 	: TypeNode(p), mySub(inSub){}
 	void unparse(std::ostream& out, int indent) override;
+	CType cType(CGen * gen) override;
+	void exportType(ModuleWriter& out) override;
+	void nameAnalysis(NameIndex * names) override;
+	std::string className() override;
 private:
 	TypeNode * mySub;
 };
@@ -175,6 +313,10 @@ public:
 	RefTypeNode(const Position * p, TypeNode * inSub)
 	: TypeNode(p), mySub(inSub){}
 	void unparse(std::ostream& out, int indent) override;
+	CType cType(CGen * gen) override;
+	void exportType(ModuleWriter& out) override;
+	void nameAnalysis(NameIndex * names) override;
+	std::string className() override;
 private:
 	TypeNode * mySub;
 };
@@ -188,6 +330,15 @@ public:
 	  std::list<ExpNode *> * inArgs)
 	: ExpNode(p), myCallee(inCallee), myArgs(inArgs){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	/** As emitC and lower, but if the callee returns a reference
+	 * (ref is set) this is the address returned, not the value
+	 * there, so that a reference can be bound to it **/
+	CType emitCCall(CGen * gen, std::ostream& out, bool& ref);
+	IrValue lowerCall(IrGen * gen, bool& ref);
+	bool cSpeculable(CGen * gen) override{ return false; }
+	const NameDecl * nameAnalysis(NameIndex * names) override;
 private:
 	LocNode * myCallee;
 	std::list<ExpNode *> * myArgs;
@@ -201,6 +352,9 @@ public:
 		unparse(out, 0);
 	}
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	CRange cRange(CGen * gen) override;
 private:
 	const int myNum;
 };
@@ -213,6 +367,8 @@ public:
 		unparse(out, 0);
 	}
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
 private:
 	 const std::string myStr;
 };
@@ -224,6 +380,8 @@ public:
 		unparse(out, 0);
 	}
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
 };
 
 class FalseNode : public ExpNode{
@@ -233,6 +391,8 @@ public:
 		unparse(out, 0);
 	}
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
 };
 
 class EhNode : public ExpNode{
@@ -242,6 +402,9 @@ public:
 		unparse(out, 0);
 	}
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	bool cSpeculable(CGen * gen) override{ return false; }
 };
 
 // Binary Expression Nodes
@@ -250,6 +413,24 @@ class BinaryExpNode : public ExpNode{
 public:
 	BinaryExpNode(const Position * p, ExpNode * lhs, ExpNode * rhs)
 	: ExpNode(p), myExp1(lhs), myExp2(rhs) { }
+protected:
+	/* Shared C emission for the three families of operator */
+	/* Plain C arithmetic when the operands' ranges show it is
+	   safe, the runtime's wrapping or checked fn otherwise */
+	CType emitCArith(CGen * gen, std::ostream& out, const char * fn,
+	  const char * op, bool plain);
+	void cRefineCompare(CGen * gen, bool truth, std::string op);
+	CType emitCCompare(CGen * gen, std::ostream& out, const char * op);
+	CType emitCLogic(CGen * gen, std::ostream& out, const char * op);
+	/* Shared lowering of the same families */
+	IrValue lowerArith(IrGen * gen, IrOp op);
+	IrValue lowerCompare(IrGen * gen, IrOp op);
+	IrValue lowerLogic(IrGen * gen, bool isAnd);
+public:
+	bool cSpeculable(CGen * gen) override{
+		return myExp1->cSpeculable(gen) && myExp2->cSpeculable(gen);
+	}
+	const NameDecl * nameAnalysis(NameIndex * names) override;
 protected:
 	ExpNode * myExp1;
 	ExpNode * myExp2;
@@ -260,6 +441,9 @@ public:
 	PlusNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	CRange cRange(CGen * gen) override;
 };
 
 class MinusNode : public BinaryExpNode{
@@ -267,6 +451,9 @@ public:
 	MinusNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	CRange cRange(CGen * gen) override;
 };
 
 class TimesNode : public BinaryExpNode{
@@ -274,6 +461,9 @@ public:
 	TimesNode(const Position * p, ExpNode * e1In, ExpNode * e2In)
 	: BinaryExpNode(p, e1In, e2In){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	CRange cRange(CGen * gen) override;
 };
 
 class DivideNode : public BinaryExpNode{
@@ -281,6 +471,10 @@ public:
 	DivideNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	CRange cRange(CGen * gen) override;
+	bool cSpeculable(CGen * gen) override{ return false; }
 };
 
 class AndNode : public BinaryExpNode{
@@ -288,6 +482,9 @@ public:
 	AndNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 class OrNode : public BinaryExpNode{
@@ -295,6 +492,9 @@ public:
 	OrNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 class EqualsNode : public BinaryExpNode{
@@ -302,6 +502,9 @@ public:
 	EqualsNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 class NotEqualsNode : public BinaryExpNode{
@@ -309,6 +512,9 @@ public:
 	NotEqualsNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 class LessNode : public BinaryExpNode{
@@ -316,6 +522,9 @@ public:
 	LessNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 class LessEqNode : public BinaryExpNode{
@@ -323,6 +532,9 @@ public:
 	LessEqNode(const Position * pos, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(pos, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 class GreaterNode : public BinaryExpNode{
@@ -330,6 +542,9 @@ public:
 	GreaterNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 class GreaterEqNode : public BinaryExpNode{
@@ -337,6 +552,9 @@ public:
 	GreaterEqNode(const Position * p, ExpNode * e1, ExpNode * e2)
 	: BinaryExpNode(p, e1, e2){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 // Unary Expression Nodes
@@ -348,6 +566,10 @@ public:
 		this->myExp = expIn;
 	}
 	virtual void unparse(std::ostream& out, int indent) override = 0;
+	bool cSpeculable(CGen * gen) override{
+		return myExp->cSpeculable(gen);
+	}
+	const NameDecl * nameAnalysis(NameIndex * names) override;
 protected:
 	ExpNode * myExp;
 };
@@ -357,6 +579,9 @@ public:
 	NegNode(const Position * p, ExpNode * exp)
 	: UnaryExpNode(p, exp){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	CRange cRange(CGen * gen) override;
 };
 
 class NotNode : public UnaryExpNode{
@@ -364,6 +589,9 @@ public:
 	NotNode(const Position * p, ExpNode * exp)
 	: UnaryExpNode(p, exp){ }
 	void unparse(std::ostream& out, int indent) override;
+	CType emitC(CGen * gen, std::ostream& out) override;
+	IrValue lower(IrGen * gen) override;
+	void cRefine(CGen * gen, bool truth) override;
 };
 
 /** Statement Nodes **/
@@ -373,6 +601,9 @@ public:
 	AssignStmtNode(const Position * p, LocNode * inDst, ExpNode * inSrc)
 	: StmtNode(p), myDst(inDst), mySrc(inSrc){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	LocNode * myDst;
 	ExpNode * mySrc;
@@ -383,6 +614,9 @@ public:
 	CallStmtNode(const Position * p, CallExpNode * expIn)
 	: StmtNode(p), myCallExp(expIn){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	CallExpNode * myCallExp;
 };
@@ -392,7 +626,11 @@ public:
 	ReturnStmtNode(const Position * p, ExpNode * exp)
 	: StmtNode(p), myExp(exp){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
+	void emitReturnValue(CGen * gen, std::ostream& out);
 	ExpNode * myExp;
 };
 
@@ -401,6 +639,9 @@ public:
 	MaybeStmtNode(const Position * p, LocNode * inDst, ExpNode * inSrc1, ExpNode * inSrc2)
 	: StmtNode(p), myDst(inDst), mySrc1(inSrc1), mySrc2(inSrc2){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	LocNode * myDst;
 	ExpNode * mySrc1;
@@ -414,6 +655,9 @@ public:
 	FromConsoleStmtNode(const Position * p, LocNode * inDst)
 	: StmtNode(p), myDst(inDst){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	LocNode * myDst;
 };
@@ -423,6 +667,9 @@ public:
 	ToConsoleStmtNode(const Position * p, ExpNode * inSrc)
 	: StmtNode(p), mySrc(inSrc){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	ExpNode * mySrc;
 };
@@ -434,6 +681,9 @@ public:
 	PostDecStmtNode(const Position * p, LocNode * inLoc)
 	: StmtNode(p), myLoc(inLoc){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	LocNode * myLoc;
 };
@@ -443,6 +693,9 @@ public:
 	PostIncStmtNode(const Position * p, LocNode * inLoc)
 	: StmtNode(p), myLoc(inLoc){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	LocNode * myLoc;
 };
@@ -455,6 +708,9 @@ public:
 	  std::list<StmtNode *> * bodyIn)
 	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBody;
@@ -468,6 +724,9 @@ public:
 	: StmtNode(p), myCond(condIn),
 	  myBodyTrue(bodyTrueIn), myBodyFalse(bodyFalseIn) { }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBodyTrue;
@@ -480,6 +739,9 @@ public:
 	  std::list<StmtNode *> * bodyIn)
 	: StmtNode(p), myCond(condIn), myBody(bodyIn){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void lower(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
 private:
 	ExpNode * myCond;
 	std::list<StmtNode *> * myBody;
@@ -493,7 +755,16 @@ public:
 	ClassDefnNode(const Position * p, IDNode * inID, std::list<DeclNode *> * inMembers)
 	: DeclNode(p), myID(inID), myMembers(inMembers){ }
 	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void cDeclare(CGen * gen, std::ostream& out) override;
+	void cDefine(CGen * gen, std::ostream& out) override;
+	void lower(IrGen * gen) override;
+	void lowerGlobal(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
+	void nameDeclare(NameIndex * names) override;
+	void exportDecl(ModuleWriter& out) override;
 	IDNode * ID(){ return myID; }
+	std::list<DeclNode *> * getMembers() const{ return myMembers; }
 private:
 	IDNode * myID;
 	std::list<DeclNode *> * myMembers;
@@ -504,6 +775,7 @@ public:
     FormalDeclNode(const Position * p, IDNode * id, TypeNode * type)
     : VarDeclNode(p, id, type, nullptr){ }
     void unparse(std::ostream& out, int indent) override;
+    void nameDeclare(NameIndex * names) override;
 };
 
 class FnDeclNode : public DeclNode{
@@ -521,7 +793,16 @@ public:
 	std::list<FormalDeclNode *> * getFormals() const{
 		return myFormals;
 	}
-	void unparse(std::ostream& out, int indent) override;
+	TypeNode * getRetTypeNode() const{ return myRetType; }
+	void unparse(std::ostream& out, int indent) override;
+	void emitC(CGen * gen, std::ostream& out, int indent) override;
+	void cDeclare(CGen * gen, std::ostream& out) override;
+	void cDefine(CGen * gen, std::ostream& out) override;
+	void lower(IrGen * gen) override;
+	void lowerGlobal(IrGen * gen) override;
+	void nameAnalysis(NameIndex * names) override;
+	void nameDeclare(NameIndex * names) override;
+	void exportDecl(ModuleWriter& out) override;
 private:
 	IDNode * myID;
 	std::list<FormalDeclNode *> * myFormals;
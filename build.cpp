@@ -0,0 +1,249 @@
+#include <cerrno>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "build.hpp"
+#include "cache.hpp"
+#include "module.hpp"
+
+namespace a_lang{
+
+/*
+The build scheduler (ac --build). Each module is two tasks:
+writing its interface and writing its C. Both need the module's
+source and the interfaces of its imports, since an interface
+carries the types its imports declare that its signatures name.
+A task starts as soon as the tasks it needs are done, so a
+module's interface and C wait only on the interfaces of the
+modules it imports, and modules that do not import each other
+build in parallel. Tasks run in forked copies of this process,
+as the daemon's compiles do.
+
+A task is skipped when a hash of everything it reads (the
+compiler, the module's source and its imports' interfaces)
+matches the one recorded when it last succeeded, and its output
+is still there. Interfaces are only rewritten when a signature
+changes, so editing a function body rebuilds that module's C
+and nothing else. The hashes are kept in .acbuild, in the
+current directory.
+*/
+
+static const char * const buildFormat = "ac-build-1";
+static const char * const stateFile = ".acbuild";
+
+class BuildTask{
+public:
+	BuildTask(std::string moduleIn, bool cIn)
+	: module(moduleIn), c(cIn), waiting(0), failed(false){ }
+	/** What the task writes **/
+	std::string output() const {
+		return c ? cPathOf(module) : interfacePath(module);
+	}
+	/** How the task is known in the state file **/
+	std::string name() const { return (c ? "c " : "i ") + module; }
+	std::string module;
+	/** Whether this writes the C (or else the interface) **/
+	bool c;
+	/** The interface tasks of the imports **/
+	std::vector<size_t> imports;
+	std::vector<size_t> dependents;
+	size_t waiting;
+	bool failed;
+	std::string key;
+};
+
+static bool readFile(const std::string& path, std::string& contents){
+	std::ifstream in(path, std::ios::binary);
+	if (!in.good()){ return false; }
+	std::stringstream all;
+	all << in.rdbuf();
+	contents = all.str();
+	return true;
+}
+
+/* Add the tasks of module and everything it imports, depth first,
+   and return the module's interface task, or false on a cycle */
+static bool addModule(const std::string& module,
+  std::map<std::string, size_t>& ids, std::vector<BuildTask>& tasks,
+  std::vector<std::string>& path, size_t& id){
+	auto found = ids.find(module);
+	if (found != ids.end()){
+		for (size_t i = 0; i < path.size(); i++){
+			if (path[i] != module){ continue; }
+			std::cerr << "Import cycle: ";
+			for (size_t j = i; j < path.size(); j++){
+				std::cerr << path[j] << " -> ";
+			}
+			std::cerr << module << "\n";
+			return false;
+		}
+		id = found->second;
+		return true;
+	}
+	id = tasks.size();
+	ids[module] = id;
+	tasks.push_back(BuildTask(module, false));
+	tasks.push_back(BuildTask(module, true));
+	path.push_back(module);
+	for (auto& import : scanImports(module)){
+		size_t dep;
+		if (!addModule(normalPath(resolveImport(module, import)),
+		  ids, tasks, path, dep)){
+			return false;
+		}
+		for (size_t task = id; task <= id + 1; task++){
+			tasks[task].imports.push_back(dep);
+			tasks[dep].dependents.push_back(task);
+		}
+	}
+	path.pop_back();
+	return true;
+}
+
+static std::string taskKey(const std::vector<BuildTask>& tasks,
+  const BuildTask& task){
+	uint64_t h = 14695981039346656037ull;
+	h = fnv(h, buildFormat);
+	h = fnv(h, compilerStamp());
+	h = fnv(h, task.name());
+	std::string contents;
+	readFile(task.module, contents);
+	h = fnv(h, contents);
+	for (size_t dep : task.imports){
+		std::string iface = tasks[dep].output();
+		contents.clear();
+		readFile(iface, contents);
+		h = fnv(fnv(h, iface), contents);
+	}
+	char hex[17];
+	snprintf(hex, sizeof hex, "%016llx", static_cast<unsigned long long>(h));
+	return hex;
+}
+
+static std::map<std::string, std::string> loadState(){
+	std::map<std::string, std::string> state;
+	std::ifstream in(stateFile);
+	std::string key;
+	std::string name;
+	while (in >> key && std::getline(in >> std::ws, name)){
+		state[name] = key;
+	}
+	return state;
+}
+
+static void saveState(const std::map<std::string, std::string>& state){
+	std::string tmpPath = std::string(stateFile) + "."
+	  + std::to_string(getpid());
+	std::ofstream out(tmpPath);
+	for (auto& entry : state){
+		out << entry.second << " " << entry.first << "\n";
+	}
+	out.close();
+	if (!out.good() || rename(tmpPath.c_str(), stateFile) != 0){
+		unlink(tmpPath.c_str());
+		std::cerr << "Could not record the build in " << stateFile << "\n";
+	}
+}
+
+int buildModules(const std::vector<std::string>& modules, int jobs,
+  CompileFn compile){
+	if (jobs <= 0){ jobs = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN)); }
+	if (jobs <= 0){ jobs = 1; }
+
+	std::map<std::string, size_t> ids;
+	std::vector<BuildTask> tasks;
+	for (auto& module : modules){
+		std::vector<std::string> path;
+		size_t id;
+		if (!addModule(normalPath(module), ids, tasks, path, id)){ return 1; }
+	}
+
+	std::map<std::string, std::string> state = loadState();
+	std::deque<size_t> ready;
+	for (size_t t = 0; t < tasks.size(); t++){
+		tasks[t].waiting = tasks[t].imports.size();
+		if (tasks[t].waiting == 0){ ready.push_back(t); }
+	}
+	auto finish = [&](size_t t, bool ok){
+		for (size_t dep : tasks[t].dependents){
+			if (!ok){ tasks[dep].failed = true; }
+			if (--tasks[dep].waiting == 0){ ready.push_back(dep); }
+		}
+	};
+
+	std::map<pid_t, size_t> running;
+	size_t built = 0;
+	size_t current = 0;
+	size_t failed = 0;
+	while (!ready.empty() || !running.empty()){
+		while (!ready.empty() && running.size() < static_cast<size_t>(jobs)){
+			size_t t = ready.front();
+			ready.pop_front();
+			BuildTask& task = tasks[t];
+			if (task.failed){
+				std::cerr << "Not building " << task.output()
+				  << ": an import failed\n";
+				failed++;
+				finish(t, false);
+				continue;
+			}
+			task.key = taskKey(tasks, task);
+			auto recorded = state.find(task.name());
+			if (recorded != state.end() && recorded->second == task.key
+			  && access(task.output().c_str(), F_OK) == 0){
+				current++;
+				finish(t, true);
+				continue;
+			}
+
+			std::string out = task.output();
+			const char * argv[] = { "ac", task.module.c_str(),
+			  task.c ? "-c" : "-i", out.c_str(), nullptr };
+			std::cout << "ac " << argv[1] << " " << argv[2] << " "
+			  << argv[3] << std::endl;
+			pid_t pid = fork();
+			if (pid == 0){ exit(compile(4, argv)); }
+			if (pid < 0){
+				std::cerr << "Could not start a compile\n";
+				failed++;
+				finish(t, false);
+				continue;
+			}
+			running[pid] = t;
+		}
+		if (running.empty()){ continue; }
+
+		int status = 0;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0){
+			if (errno == EINTR){ continue; }
+			break;
+		}
+		auto done = running.find(pid);
+		if (done == running.end()){ continue; }
+		size_t t = done->second;
+		running.erase(done);
+		bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		if (ok){
+			state[tasks[t].name()] = tasks[t].key;
+			built++;
+		} else {
+			state.erase(tasks[t].name());
+			failed++;
+		}
+		finish(t, ok);
+	}
+
+	saveState(state);
+	std::cout << built << " built, " << current << " up to date";
+	if (failed > 0){ std::cout << ", " << failed << " failed"; }
+	std::cout << std::endl;
+	return failed > 0 ? 1 : 0;
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef A_LANG_BUILD_HPP
+#define A_LANG_BUILD_HPP
+
+#include <string>
+#include <vector>
+#include "daemon.hpp"
+
+namespace a_lang{
+
+/** Build the given modules and every module they import: write
+ * each one's interface and C beside it (see module.hpp). Runs up
+ * to jobs compiles at once (all cores if jobs is 0), each as soon
+ * as the interfaces it needs are written, and skips those whose
+ * inputs are as they were at the last successful build. Returns
+ * 0 if everything built. **/
+int buildModules(const std::vector<std::string>& modules, int jobs,
+  CompileFn compile);
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "cache.hpp"
+#include "errors.hpp"
+
+namespace a_lang{
+
+/*
+Bump this when the format of any cached output changes in a way
+the compiler binary's identity would not catch.
+*/
+static const char * const cacheFormat = "ac-cache-1";
+
+/* 64-bit FNV-1a, continued from h */
+static uint64_t fnv(uint64_t h, const char * data, size_t len){
+	for (size_t i = 0; i < len; i++){
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+uint64_t fnv(uint64_t h, const std::string& s){
+	// The length keeps "ab"+"c" apart from "a"+"bc"
+	std::string len = std::to_string(s.size()) + ":";
+	return fnv(fnv(h, len.data(), len.size()), s.data(), s.size());
+}
+
+bool mapFile(const char * path, const char *& data, size_t& len){
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){ return false; }
+	struct stat info;
+	if (fstat(fd, &info) != 0){
+		close(fd);
+		return false;
+	}
+	len = static_cast<size_t>(info.st_size);
+	data = "";
+	if (len > 0){
+		void * map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED){
+			close(fd);
+			return false;
+		}
+		data = static_cast<const char *>(map);
+	}
+	close(fd);
+	return true;
+}
+
+void unmapFile(const char * data, size_t len){
+	if (len > 0){ munmap(const_cast<char *>(data), len); }
+}
+
+std::string compilerStamp(){
+	struct stat self;
+	if (stat("/proc/self/exe", &self) != 0){ return ""; }
+	return std::to_string(self.st_size) + " " + std::to_string(self.st_mtime);
+}
+
+void writeOutput(const char * outPath, const char * text, size_t len){
+	std::streamsize size = static_cast<std::streamsize>(len);
+	if (strcmp(outPath, "--") == 0){
+		std::cout.write(text, size);
+		return;
+	}
+	std::ofstream outStream(outPath);
+	if (!outStream.good()){
+		std::string msg = "Bad output file ";
+		msg += outPath;
+		throw new InternalError(msg.c_str());
+	}
+	outStream.write(text, size);
+}
+
+FrontendCache::FrontendCache(const char * dir, const char * inPath)
+: myDir(dir), myUsable(false), myInputHash(14695981039346656037ull){
+	if (mkdir(dir, 0777) != 0 && errno != EEXIST){ return; }
+
+	// A rebuilt compiler may print things differently, so it is
+	// part of every key
+	myInputHash = fnv(myInputHash, cacheFormat);
+	myInputHash = fnv(myInputHash, compilerStamp());
+
+	const char * text;
+	size_t len;
+	if (!mapFile(inPath, text, len)){ return; }
+	myInputHash = fnv(myInputHash, std::string(text, len));
+	unmapFile(text, len);
+	myUsable = true;
+}
+
+std::string FrontendCache::entryPath(const std::string& kind,
+  const std::string& opts) const{
+	uint64_t h = fnv(fnv(myInputHash, kind), opts);
+	char name[17];
+	snprintf(name, sizeof name, "%016llx",
+	  static_cast<unsigned long long>(h));
+	return myDir + "/" + name + "." + kind;
+}
+
+bool FrontendCache::serve(const std::string& kind,
+  const std::string& opts, const char * outPath){
+	if (!myUsable){ return false; }
+	const char * text;
+	size_t len;
+	if (!mapFile(entryPath(kind, opts).c_str(), text, len)){
+		return false;
+	}
+	writeOutput(outPath, text, len);
+	unmapFile(text, len);
+	return true;
+}
+
+void FrontendCache::store(const std::string& kind,
+  const std::string& opts, const std::string& text){
+	if (!myUsable){ return; }
+	// Write aside and rename, so that a concurrent compile never
+	// maps a half-written entry
+	std::string path = entryPath(kind, opts);
+	std::string tmpPath = path + "." + std::to_string(getpid());
+	std::ofstream out(tmpPath);
+	out.write(text.data(), static_cast<std::streamsize>(text.size()));
+	out.close();
+	if (!out.good() || rename(tmpPath.c_str(), path.c_str()) != 0){
+		unlink(tmpPath.c_str());
+	}
+}
+
+}
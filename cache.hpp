@@ -0,0 +1,55 @@
+#ifndef A_LANG_CACHE_HPP
+#define A_LANG_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace a_lang{
+
+/** An on-disk cache of what the compiler outputs for an input
+ * file. Entries are named by a hash of the file's contents, the
+ * compiler binary, the kind of output and the options it was
+ * made with, so an entry never needs invalidating: a change to
+ * any of them simply looks up a different entry.
+**/
+class FrontendCache{
+public:
+	/** A cache in dir (created if need be) for the input file
+	 * at inPath, which is read and hashed once here **/
+	FrontendCache(const char * dir, const char * inPath);
+	/** If there is an entry for this kind of output with these
+	 * options, copy it to outPath ("--" is stdout) and return
+	 * true. The entry is mapped, not read. **/
+	bool serve(const std::string& kind, const std::string& opts,
+	  const char * outPath);
+	/** Record text as the output of this kind with these
+	 * options. Failing to write the cache is not an error. **/
+	void store(const std::string& kind, const std::string& opts,
+	  const std::string& text);
+private:
+	std::string entryPath(const std::string& kind,
+	  const std::string& opts) const;
+	std::string myDir;
+	bool myUsable;
+	uint64_t myInputHash;
+};
+
+/** 64-bit FNV-1a of s, continued from h (start from
+ * 14695981039346656037) **/
+uint64_t fnv(uint64_t h, const std::string& s);
+
+/** The running compiler binary's size and timestamp, which
+ * change when it is rebuilt **/
+std::string compilerStamp();
+
+/** Write text to outPath, where "--" means stdout **/
+void writeOutput(const char * outPath, const char * text, size_t len);
+
+/** Map the whole file at path read-only, or return false if it
+ * can't be. An empty file maps to "". **/
+bool mapFile(const char * path, const char *& data, size_t& len);
+void unmapFile(const char * data, size_t len);
+
+}
+
+#endif
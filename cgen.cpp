@@ -0,0 +1,1561 @@
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "cgen.hpp"
+#include "module.hpp"
+
+namespace a_lang{
+
+/*
+The C backend. As in unparse.cpp, the functions here are
+grouped by purpose rather than by class: every emitC method
+lives in this file. Expressions return the CType of the value
+they emitted, which is how the backend gets by without a
+separate type analysis pass.
+*/
+
+static void doIndent(std::ostream& out, int indent){
+	for (int k = 0 ; k < indent; k++){ out << "\t"; }
+}
+
+static void emitBlock(CGen * gen, std::ostream& out,
+  std::list<StmtNode *> * body, int indent){
+	gen->enterScope();
+	for (auto stmt : *body){
+		if (gen->profiling()){
+			// Tell the profiler which line is running
+			doIndent(out, indent);
+			out << "art_prof_line = " << stmt->pos()->line() << ";\n";
+		}
+		stmt->emitC(gen, out, indent);
+	}
+	gen->leaveScope();
+}
+
+/* The counter key of the branch or call at pos */
+static std::string siteKey(std::string kind, const Position * pos){
+	return kind + ":" + std::to_string(pos->line())
+	  + ":" + std::to_string(pos->col());
+}
+
+/* How profiles name a function, e.g. "fact" or "Point->bump" */
+static std::string fnName(CGen * gen, std::string name){
+	CClass * cls = gen->currentClass();
+	if (cls == nullptr){ return name; }
+	return cls->defn->ID()->getName() + "->" + name;
+}
+
+/** CGenOpts **/
+
+void CGenOpts::loadFeedback(std::string path){
+	std::ifstream in(path);
+	if (!in.good()){
+		std::string msg = "Cannot read counts file " + path;
+		throw new UserError(msg.c_str());
+	}
+	std::string key;
+	uint64_t count;
+	while (in >> key >> count){
+		feedback[key] += count;
+	}
+	if (!in.eof()){
+		std::string msg = "Malformed counts file " + path;
+		throw new UserError(msg.c_str());
+	}
+}
+
+/** CType **/
+
+std::string CType::cName() const{
+	std::string result;
+	switch (kind){
+	case INT: result = "art_int"; break;
+	case BOOL: result = "art_bool"; break;
+	case STR: result = "art_str"; break;
+	case VOID: result = "void"; break;
+	case CLASS: result = "struct " + CGen::structName(module, cls); break;
+	}
+	if (ref){ result += " *"; }
+	return result;
+}
+
+std::string CType::toString() const{
+	std::string result = ref ? "&" : "";
+	switch (kind){
+	case INT: result += "int"; break;
+	case BOOL: result += "bool"; break;
+	case STR: result += "string"; break;
+	case VOID: result += "void"; break;
+	case CLASS: result += cls; break;
+	}
+	return result;
+}
+
+/** CGen **/
+
+CGen::CGen(const CGenOpts& opts)
+: myOpts(opts), myTotalCalls(0), myTempCount(0), myRangesOn(true),
+  myScratch(0), myDeclModule(opts.module), myDeclVisible(true), myClass(nullptr), myRetType(CType::VOID){
+	// Sum the call sites of each function ("call:line:col:name")
+	for (auto& entry : myOpts.feedback){
+		const std::string& key = entry.first;
+		if (key.compare(0, 5, "call:") != 0){ continue; }
+		myCallsTo[key.substr(key.rfind(':') + 1)] += entry.second;
+		myTotalCalls += entry.second;
+	}
+}
+
+CGen::~CGen(){
+	for (auto& cls : myAllClasses){ delete cls.second; }
+}
+
+std::string CGen::varName(std::string name){
+	return "a_" + name;
+}
+
+/* Length prefixes keep apart, e.g., (A_b, c) and (A, b_c) */
+static std::string prefixed(std::string part){
+	return std::to_string(part.length()) + part;
+}
+
+std::string CGen::globalName(std::string module, std::string name){
+	return "a" + prefixed(module) + "_" + name;
+}
+
+std::string CGen::structName(std::string module, std::string cls){
+	return "a" + prefixed(module) + "_" + cls;
+}
+
+std::string CGen::initName(std::string module, std::string cls){
+	return "ai" + prefixed(module) + "_" + cls;
+}
+
+std::string CGen::methodName(std::string module, std::string cls,
+  std::string fn){
+	return "am" + prefixed(module) + prefixed(cls) + "_" + fn;
+}
+
+int CGen::profileId(std::string name){
+	myProfileNames.push_back(name);
+	return myProfileNames.size() - 1;
+}
+
+int CGen::countSite(std::string key){
+	auto found = myCountSlots.find(key);
+	if (found != myCountSlots.end()){ return found->second; }
+	int slot = myCountKeys.size();
+	myCountSlots[key] = slot;
+	myCountKeys.push_back(key);
+	return slot;
+}
+
+int CGen::countBranch(std::string key){
+	int slot = countSite(key + ":true");
+	countSite(key + ":false");
+	return slot;
+}
+
+std::string CGen::countField(std::string cls, std::string field,
+  CType type, std::string access){
+	if (!counting()){ return access; }
+	int slot = countSite("field:" + cls + "." + field);
+	return "(*(" + type.cName() + " *)art_count_use("
+	  + std::to_string(slot) + ", &" + access + "))";
+}
+
+uint64_t CGen::feedback(std::string key){
+	auto found = myOpts.feedback.find(key);
+	if (found == myOpts.feedback.end()){ return 0; }
+	return found->second;
+}
+
+std::string CGen::branchHint(std::string key){
+	uint64_t taken = feedback(key + ":true");
+	uint64_t notTaken = feedback(key + ":false");
+	// Too few samples to trust either way
+	if (taken + notTaken < 16){ return ""; }
+	if (taken >= 9 * notTaken){ return "ART_LIKELY"; }
+	if (notTaken >= 9 * taken){ return "ART_UNLIKELY"; }
+	return "";
+}
+
+bool CGen::hotLoop(std::string key){
+	uint64_t iterations = feedback(key + ":true");
+	uint64_t entries = feedback(key + ":false");
+	return iterations >= 64 && iterations >= 8 * entries;
+}
+
+std::string CGen::fnTemperature(std::string name){
+	// Functions the profile knows nothing about are left alone
+	auto found = myCallsTo.find(name);
+	if (found == myCallsTo.end()){ return ""; }
+	if (found->second == 0){ return "ART_COLD"; }
+	if (found->second * 10 >= myTotalCalls){ return "ART_HOT"; }
+	return "";
+}
+
+void CGen::fail(const Position * pos, std::string msg){
+	std::string full = pos->span() + " " + msg;
+	throw new UserError(full.c_str());
+}
+
+void CGen::enterScope(){
+	myScopes.push_front(std::map<std::string, CSym>());
+}
+
+void CGen::leaveScope(){
+	myScopes.pop_front();
+}
+
+void CGen::declareLocal(const Position * pos, std::string name,
+  CType type){
+	std::map<std::string, CSym>& scope = myScopes.front();
+	if (scope.find(name) != scope.end()){
+		fail(pos, "Multiply declared identifier " + name);
+	}
+	scope.emplace(name, CSym(type, varName(name)));
+}
+
+void CGen::declareGlobal(const Position * pos, std::string name,
+  CType type){
+	if (myGlobals.find(name) != myGlobals.end()
+	  || myFns.find(name) != myFns.end()){
+		fail(pos, "Multiply declared identifier " + name);
+	}
+	myGlobals.emplace(name, CSym(type, globalName(myDeclModule, name)));
+}
+
+void CGen::declareFn(const Position * pos, std::string name,
+  FnDeclNode * fn){
+	if (myGlobals.find(name) != myGlobals.end()
+	  || myFns.find(name) != myFns.end()){
+		fail(pos, "Multiply declared identifier " + name);
+	}
+	myFns[name] = fn;
+	myFnCNames[name] = globalName(myDeclModule, name);
+}
+
+CClass * CGen::declareClass(const Position * pos, std::string name,
+  ClassDefnNode * defn){
+	if (myDeclVisible && myClasses.find(name) != myClasses.end()){
+		fail(pos, "Multiply declared type " + name);
+	}
+	CClass *& cls = myAllClasses[{myDeclModule, name}];
+	if (cls != nullptr){
+		// Already declared hidden, for an earlier import
+		if (myDeclVisible){ myClasses[name] = cls; }
+		return nullptr;
+	}
+	cls = new CClass(defn, myDeclModule);
+	if (myDeclVisible){ myClasses[name] = cls; }
+	return cls;
+}
+
+CSym CGen::lookupVar(IDNode * id){
+	std::string name = id->getName();
+	for (auto& scope : myScopes){
+		auto found = scope.find(name);
+		if (found != scope.end()){ return found->second; }
+	}
+	if (myClass != nullptr){
+		auto field = myClass->fields.find(name);
+		if (field != myClass->fields.end()){
+			std::string cls = myClass->defn->ID()->getName();
+			return CSym(field->second,
+			  countField(cls, name, field->second,
+			  "art_self->" + varName(name)));
+		}
+	}
+	auto global = myGlobals.find(name);
+	if (global != myGlobals.end()){ return global->second; }
+	fail(id->pos(), "Undeclared identifier " + name);
+}
+
+CClass * CGen::lookupClass(const Position * pos, std::string name){
+	auto found = myClasses.find(name);
+	if (found == myClasses.end()){
+		fail(pos, "Undeclared type " + name);
+	}
+	return found->second;
+}
+
+CClass * CGen::lookupClass(const Position * pos, std::string module,
+  std::string name){
+	auto found = myAllClasses.find({module, name});
+	if (found == myAllClasses.end()){
+		fail(pos, "Undeclared type " + name);
+	}
+	return found->second;
+}
+
+CClass * CGen::lookupClass(const Position * pos, CType type){
+	if (type.kind != CType::CLASS){
+		fail(pos, "Member access on non-custom type "
+		  + type.toString());
+	}
+	return lookupClass(pos, type.module, type.cls);
+}
+
+FnDeclNode * CGen::findFn(std::string name){
+	auto found = myFns.find(name);
+	if (found == myFns.end()){ return nullptr; }
+	return found->second;
+}
+
+std::string CGen::fnCName(std::string name){
+	return myFnCNames.find(name)->second;
+}
+
+FnDeclNode * CGen::lookupFn(IDNode * id, bool& isMethod){
+	std::string name = id->getName();
+	if (myClass != nullptr){
+		auto method = myClass->methods.find(name);
+		if (method != myClass->methods.end()){
+			isMethod = true;
+			return method->second;
+		}
+	}
+	isMethod = false;
+	FnDeclNode * fn = findFn(name);
+	if (fn == nullptr){
+		fail(id->pos(), "Undeclared function " + name);
+	}
+	return fn;
+}
+
+int CGen::internString(std::string lexeme){
+	// Strip the quotes and undo a-lang's escapes
+	std::string value;
+	for (size_t k = 1; k + 1 < lexeme.length(); k++){
+		char c = lexeme[k];
+		if (c == '\\'){
+			c = lexeme[++k];
+			if (c == 'n'){ c = '\n'; }
+			else if (c == 't'){ c = '\t'; }
+		}
+		value += c;
+	}
+	if (value.empty()){ return -1; }
+	auto found = myStringIds.find(value);
+	if (found != myStringIds.end()){ return found->second; }
+	int id = myStrings.size();
+	myStringIds[value] = id;
+	myStrings.push_back(value);
+	return id;
+}
+
+void CGen::emitStrings(std::ostream& out){
+	if (myStrings.empty()){ return; }
+	out << "static const art_str_rep " << moduleSym("art_strs") << "["
+	  << myStrings.size()
+	  << "] = {\n";
+	for (auto value : myStrings){
+		// FNV-1a, as a hashed container in the runtime would use
+		uint32_t hash = 2166136261u;
+		out << "\t{\"";
+		for (char c : value){
+			hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+			switch (c){
+			case '\n': out << "\\n"; break;
+			case '\t': out << "\\t"; break;
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			default: out << c;
+			}
+		}
+		out << "\", " << value.length() << ", " << hash << "u},\n";
+	}
+	out << "};\n\n";
+}
+
+/* The entry for loc if it is an int local with a known range */
+static CSym * trackedLocal(CGen::Facts& scopes,
+  const std::set<std::string>& escaped, ExpNode * loc){
+	auto id = dynamic_cast<IDNode *>(loc);
+	if (id == nullptr){ return nullptr; }
+	std::string name = id->getName();
+	for (auto& scope : scopes){
+		auto found = scope.find(name);
+		if (found == scope.end()){ continue; }
+		CType type = found->second.type;
+		if (type.kind != CType::INT || type.ref){ return nullptr; }
+		if (escaped.find(name) != escaped.end()){ return nullptr; }
+		return &found->second;
+	}
+	return nullptr;
+}
+
+CRange CGen::rangeOf(ExpNode * loc){
+	CSym * sym = trackedLocal(myScopes, myEscaped, loc);
+	if (!myRangesOn || sym == nullptr){ return CRange(); }
+	return sym->range;
+}
+
+void CGen::assignRange(ExpNode * loc, CRange range){
+	CSym * sym = trackedLocal(myScopes, myEscaped, loc);
+	if (sym != nullptr){ sym->range = range; }
+}
+
+void CGen::narrowRange(ExpNode * loc, CRange range){
+	CSym * sym = trackedLocal(myScopes, myEscaped, loc);
+	if (sym != nullptr){ sym->range = sym->range.meet(range); }
+}
+
+void CGen::escape(ExpNode * loc){
+	auto id = dynamic_cast<IDNode *>(loc);
+	if (id != nullptr){ myEscaped.insert(id->getName()); }
+}
+
+void CGen::joinFacts(const Facts& other){
+	// Both sides come from the same point in the program, so
+	// their scopes line up
+	auto from = other.begin();
+	for (auto& scope : myScopes){
+		for (auto& entry : scope){
+			auto sym = from->find(entry.first);
+			if (sym == from->end()){ continue; }
+			entry.second.range = entry.second.range.join(sym->second.range);
+		}
+		++from;
+	}
+}
+
+bool CGen::widenFacts(const Facts& prev){
+	bool changed = false;
+	auto from = prev.begin();
+	for (auto& scope : myScopes){
+		for (auto& entry : scope){
+			auto sym = from->find(entry.first);
+			if (sym == from->end()){ continue; }
+			CRange before = sym->second.range;
+			entry.second.range = entry.second.range.widen(before);
+			if (!(entry.second.range == before)){ changed = true; }
+		}
+		++from;
+	}
+	return changed;
+}
+
+void CGen::havocFacts(){
+	for (auto& scope : myScopes){
+		for (auto& entry : scope){ entry.second.range = CRange(); }
+	}
+}
+
+CType CGen::emitArg(ExpNode * arg, CType formal, std::ostream& out){
+	if (!formal.ref){
+		return arg->emitC(this, out);
+	}
+	// Bind a reference: pass the address of the argument's
+	// storage, or of a temporary if it has none
+	std::stringstream argOut;
+	bool bound = false;
+	CType type = emitStorage(arg, argOut, bound);
+	if (bound){
+		out << argOut.str();
+	} else {
+		out << "&(" << formal.base().cName() << "){"
+		  << argOut.str() << "}";
+	}
+	return type;
+}
+
+CType CGen::emitStorage(ExpNode * exp, std::ostream& out, bool& bound){
+	auto call = dynamic_cast<CallExpNode *>(exp);
+	if (call != nullptr){ return call->emitCCall(this, out, bound); }
+	bound = dynamic_cast<LocNode *>(exp) != nullptr;
+	if (!bound){ return exp->emitC(this, out); }
+	std::stringstream loc;
+	CType type = exp->emitC(this, loc);
+	escape(exp);
+	out << "&(" << loc.str() << ")";
+	return type;
+}
+
+std::string CGen::newTemp(CType type){
+	std::string name = "art_t" + std::to_string(myTempCount++);
+	// What is emitted only for analysis is thrown away, and
+	// its temporaries with it
+	if (myScratch == 0){ myTemps.push_back(type.cName() + " " + name); }
+	return name;
+}
+
+void CGen::takeTemps(std::ostream& out, int indent){
+	for (auto& decl : myTemps){
+		doIndent(out, indent);
+		out << decl << ";\n";
+	}
+	myTemps.clear();
+}
+
+/* The operands of an operator, or the arguments of a call. The
+   other backends evaluate them left to right, but C leaves the
+   order unspecified. So wherever the order could be seen, i.e.
+   one of two operands has effects or can fail, the earlier is
+   stored in a temporary by a comma expression ahead of the
+   operator, which then uses the temporary. */
+class COperands{
+public:
+	COperands(CGen * gen) : myGen(gen){ }
+	CType add(ExpNode * exp){
+		std::stringstream code;
+		CType type = exp->emitC(myGen, code);
+		push(exp, code.str(), type);
+		return type;
+	}
+	CType addArg(ExpNode * arg, CType formal){
+		std::stringstream code;
+		CType type = myGen->emitArg(arg, formal, code);
+		push(arg, code.str(), formal);
+		return type;
+	}
+	/* Write the stores of the temporaries, then the operands
+	   may be written, and then close */
+	void open(std::ostream& out){
+		for (size_t k = 0; k < myExps.size(); k++){
+			if (!ahead(k)){ continue; }
+			std::string temp = myGen->newTemp(myTypes[k]);
+			myTemps += temp + " = " + myCodes[k] + ", ";
+			myCodes[k] = temp;
+		}
+		if (!myTemps.empty()){ out << "(" << myTemps; }
+	}
+	void close(std::ostream& out){
+		if (!myTemps.empty()){ out << ")"; }
+	}
+	const std::string& operator[](size_t k){ return myCodes[k]; }
+private:
+	void push(ExpNode * exp, std::string code, CType type){
+		myExps.push_back(exp);
+		myCodes.push_back(code);
+		myTypes.push_back(type);
+	}
+	static bool constant(ExpNode * exp){
+		return dynamic_cast<IntLitNode *>(exp) != nullptr
+		  || dynamic_cast<StrLitNode *>(exp) != nullptr
+		  || dynamic_cast<TrueNode *>(exp) != nullptr
+		  || dynamic_cast<FalseNode *>(exp) != nullptr;
+	}
+	/* Whether operand k must be evaluated before those after it */
+	bool ahead(size_t k){
+		if (constant(myExps[k]) || myTypes[k].kind == CType::VOID){
+			return false;
+		}
+		bool speculable = myExps[k]->cSpeculable(myGen);
+		for (size_t later = k + 1; later < myExps.size(); later++){
+			if (constant(myExps[later])){ continue; }
+			if (!speculable || !myExps[later]->cSpeculable(myGen)){
+				return true;
+			}
+		}
+		return false;
+	}
+	CGen * myGen;
+	std::vector<ExpNode *> myExps;
+	std::vector<std::string> myCodes;
+	std::vector<CType> myTypes;
+	std::string myTemps;
+};
+
+bool CGen::outlivesFn(ExpNode * exp){
+	auto loc = dynamic_cast<LocNode *>(exp);
+	while (loc != nullptr){
+		auto member = dynamic_cast<MemberFieldExpNode *>(loc);
+		if (member == nullptr){ break; }
+		// Past a reference field, the storage is whatever it was
+		// bound to, which has already been checked
+		std::stringstream ignored;
+		CType baseType = member->getBase()->emitC(this, ignored);
+		CClass * cls = lookupClass(member->pos(), baseType);
+		auto field = cls->fields.find(member->getField()->getName());
+		if (field != cls->fields.end() && field->second.ref){
+			return true;
+		}
+		loc = member->getBase();
+	}
+	auto id = dynamic_cast<IDNode *>(loc);
+	if (id == nullptr){ return false; }
+	// Only a reference parameter refers to storage of the
+	// caller's; other locals (references among them, which may
+	// be bound to a temporary) end with the call. Fields of
+	// the object a method runs on, and globals, outlive it.
+	for (auto& scope : myScopes){
+		auto found = scope.find(id->getName());
+		if (found == scope.end()){ continue; }
+		return found->second.type.ref && &scope == &myScopes.back();
+	}
+	return true;
+}
+
+/** Program **/
+
+/* A C string literal holding str */
+static std::string cQuote(std::string str){
+	std::string result = "\"";
+	for (char c : str){
+		if (c == '"' || c == '\\'){ result += '\\'; }
+		result += c;
+	}
+	return result + "\"";
+}
+
+void ProgramNode::emitC(std::ostream& out, const CGenOpts& opts){
+	CGen gen(opts);
+	if (!myImports->empty() && (opts.profile || opts.count)){
+		CGen::fail(myImports->front()->pos(),
+		  "-P and -I need a program of one module");
+	}
+	CGen::emitRuntime(out, opts.profile, opts.count);
+
+	// The C of every module can be included by its importers,
+	// so each guards against being included twice and includes
+	// the C of its own imports. The program is then compiled as
+	// one unit from the C of its main module.
+	std::string guard = "ART_MODULE_" + opts.module;
+	out << "#ifndef " << guard << "\n#define " << guard << "\n";
+	for (auto import : *myImports){
+		out << "#include \"" << cPathOf(import->getPath()) << "\"\n";
+	}
+	if (opts.imported != nullptr){
+		// Their C declarations are in the included files
+		std::stringstream declared;
+		for (auto& module : *opts.imported){
+			gen.setDeclVisible(false);
+			for (auto& type : module.types){
+				gen.setDeclModule(type.module);
+				type.defn->cDeclare(&gen, declared);
+			}
+			gen.setDeclVisible(true);
+			gen.setDeclModule(moduleTag(module.path));
+			for (auto decl : *module.decls){
+				decl->cDeclare(&gen, declared);
+			}
+		}
+		gen.setDeclModule(opts.module);
+	}
+	for (auto global : *myGlobals){
+		global->cDeclare(&gen, out);
+	}
+	out << "\n";
+	// Definitions are buffered so that the string table,
+	// which they fill in, can come before them
+	std::stringstream defs;
+	for (auto global : *myGlobals){
+		global->cDefine(&gen, defs);
+	}
+	gen.emitStrings(out);
+	out << defs.str();
+
+	// Imported modules are initialized first, and once each
+	std::string initFn = gen.moduleSym("art_init_globals");
+	out << "static void " << initFn << "(void){\n";
+	out << "\tstatic art_bool done = 0;\n";
+	out << "\tif (done){ return; }\n";
+	out << "\tdone = 1;\n";
+	if (opts.imported != nullptr){
+		for (auto& module : *opts.imported){
+			out << "\tart_init_globals_" << moduleTag(module.path) << "();\n";
+		}
+	}
+	out << gen.globalInitCode();
+	out << "}\n\n";
+
+	FnDeclNode * mainFn = gen.findFn("main");
+	if (mainFn == nullptr || gen.fnCName("main")
+	  != CGen::globalName(opts.module, "main")){
+		out << "#endif\n";
+		return;
+	}
+	if (!mainFn->getFormals()->empty()){
+		CGen::fail(mainFn->pos(), "main cannot take arguments");
+	}
+	CType retType = mainFn->getRetTypeNode()->cType(&gen);
+	if (gen.profiling()){
+		out << "static const char * const art_prof_name_table[] = {\n";
+		for (auto name : gen.profileNames()){
+			out << "\t" << cQuote(name) << ",\n";
+		}
+		out << "};\n\n";
+	}
+	if (gen.counting()){
+		out << "static uint64_t art_count_table["
+		  << gen.countKeys().size() + 1 << "];\n";
+		out << "static const char * const art_count_key_table[] = {\n";
+		for (auto key : gen.countKeys()){
+			out << "\t" << cQuote(key) << ",\n";
+		}
+		out << "\t0\n};\n\n";
+	}
+	out << "int main(int argc, char ** argv){\n";
+	out << "\tint result = 0;\n";
+	if (gen.profiling()){
+		out << "\tart_prof_src = " << cQuote(gen.srcName()) << ";\n";
+		out << "\tart_prof_names = art_prof_name_table;\n";
+		out << "\tart_prof_nfns = " << gen.profileNames().size() << ";\n";
+	}
+	if (gen.counting()){
+		out << "\tart_counts = art_count_table;\n";
+		out << "\tart_count_keys = art_count_key_table;\n";
+		out << "\tart_count_nkeys = " << gen.countKeys().size() << ";\n";
+	}
+	out << "\tart_init(argc, argv);\n";
+	out << "\t" << initFn << "();\n";
+	if (retType.kind == CType::INT && !retType.ref){
+		out << "\tresult = (int)" << gen.fnCName("main") << "();\n";
+	} else {
+		out << "\t" << gen.fnCName("main") << "();\n";
+	}
+	out << "\tart_exit();\n";
+	out << "\treturn result;\n";
+	out << "}\n";
+	out << "#endif\n";
+}
+
+/** Type Nodes **/
+
+CType IntTypeNode::cType(CGen * gen){
+	return CType(CType::INT);
+}
+
+CType BoolTypeNode::cType(CGen * gen){
+	return CType(CType::BOOL);
+}
+
+CType VoidTypeNode::cType(CGen * gen){
+	return CType(CType::VOID);
+}
+
+CType ClassTypeNode::cType(CGen * gen){
+	CClass * cls = myModule.empty()
+	  ? gen->lookupClass(myPos, myID->getName())
+	  : gen->lookupClass(myPos, myModule, myID->getName());
+	return CType(CType::CLASS, myID->getName(), false, cls->module);
+}
+
+CType ImmutableTypeNode::cType(CGen * gen){
+	// Immutability is enforced (if at all) by the frontend
+	return mySub->cType(gen);
+}
+
+CType RefTypeNode::cType(CGen * gen){
+	CType sub = mySub->cType(gen);
+	sub.ref = true;
+	return sub;
+}
+
+/** Locations **/
+
+CType IDNode::emitC(CGen * gen, std::ostream& out){
+	CSym sym = gen->lookupVar(this);
+	if (sym.type.ref){
+		out << "(*" << sym.cName << ")";
+	} else {
+		out << sym.cName;
+	}
+	return sym.type.base();
+}
+
+bool IDNode::cSpeculable(CGen * gen){
+	// A reference may be unbound, so dereferencing it can fail
+	return !gen->lookupVar(this).type.ref;
+}
+
+bool MemberFieldExpNode::cSpeculable(CGen * gen){
+	if (!myBase->cSpeculable(gen)){ return false; }
+	std::stringstream ignored;
+	CType baseType = myBase->emitC(gen, ignored);
+	CClass * cls = gen->lookupClass(myPos, baseType);
+	auto field = cls->fields.find(myField->getName());
+	return field != cls->fields.end() && !field->second.ref;
+}
+
+CType MemberFieldExpNode::emitC(CGen * gen, std::ostream& out){
+	std::stringstream baseOut;
+	CType baseType = myBase->emitC(gen, baseOut);
+	CClass * cls = gen->lookupClass(myPos, baseType);
+	std::string name = myField->getName();
+	auto field = cls->fields.find(name);
+	if (field == cls->fields.end()){
+		CGen::fail(myField->pos(),
+		  "Undeclared field " + name + " of " + baseType.cls);
+	}
+	std::string access = gen->countField(baseType.cls, name,
+	  field->second, baseOut.str() + "." + CGen::varName(name));
+	if (field->second.ref){
+		out << "(*" << access << ")";
+	} else {
+		out << access;
+	}
+	return field->second.base();
+}
+
+/** Expression Nodes **/
+
+CType CallExpNode::emitC(CGen * gen, std::ostream& out){
+	bool ref = false;
+	std::stringstream call;
+	CType type = emitCCall(gen, call, ref);
+	if (ref){ out << "(*" << call.str() << ")"; }
+	else { out << call.str(); }
+	return type;
+}
+
+CType CallExpNode::emitCCall(CGen * gen, std::ostream& out, bool& ref){
+	FnDeclNode * fn = nullptr;
+	std::string target;
+	std::string self;
+	std::string calleeName;
+	auto member = dynamic_cast<MemberFieldExpNode *>(myCallee);
+	auto id = dynamic_cast<IDNode *>(myCallee);
+	if (member != nullptr){
+		std::stringstream baseOut;
+		CType baseType = member->getBase()->emitC(gen, baseOut);
+		CClass * cls = gen->lookupClass(member->pos(), baseType);
+		std::string name = member->getField()->getName();
+		auto method = cls->methods.find(name);
+		if (method == cls->methods.end()){
+			CGen::fail(member->getField()->pos(),
+			  "Undeclared method " + name + " of " + baseType.cls);
+		}
+		fn = method->second;
+		target = CGen::methodName(cls->module, baseType.cls, name);
+		self = "&(" + baseOut.str() + ")";
+		calleeName = baseType.cls + "->" + name;
+	} else if (id != nullptr){
+		bool isMethod = false;
+		fn = gen->lookupFn(id, isMethod);
+		if (isMethod){
+			CClass * cls = gen->currentClass();
+			target = CGen::methodName(cls->module,
+			  cls->defn->ID()->getName(), id->getName());
+			self = "art_self";
+			calleeName = fnName(gen, id->getName());
+		} else {
+			target = gen->fnCName(id->getName());
+			calleeName = id->getName();
+		}
+	} else {
+		throw new InternalError("Unexpected callee kind");
+	}
+
+	std::list<FormalDeclNode *> * formals = fn->getFormals();
+	if (formals->size() != myArgs->size()){
+		CGen::fail(myPos, "Function call with wrong number of args");
+	}
+
+	CType retType = fn->getRetTypeNode()->cType(gen);
+	if (gen->counting()){
+		out << "(art_counts["
+		  << gen->countSite(siteKey("call", myPos) + ":" + calleeName)
+		  << "]++, ";
+	}
+	COperands args(gen);
+	auto formal = formals->begin();
+	for (auto arg : *myArgs){
+		CType formalType = (*formal)->getTypeNode()->cType(gen);
+		CType argType = args.addArg(arg, formalType);
+		if (!argType.sameBase(formalType)){
+			CGen::fail(arg->pos(), "Cannot pass a value of type "
+			  + argType.toString() + " as " + formalType.base().toString());
+		}
+		++formal;
+	}
+	args.open(out);
+	out << target << "(";
+	bool first = true;
+	if (!self.empty()){
+		out << self;
+		first = false;
+	}
+	for (size_t k = 0; k < myArgs->size(); k++){
+		if (first){ first = false; }
+		else { out << ", "; }
+		out << args[k];
+	}
+	out << ")";
+	args.close(out);
+	if (gen->counting()){ out << ")"; }
+	ref = retType.ref;
+	return retType.base();
+}
+
+CType IntLitNode::emitC(CGen * gen, std::ostream& out){
+	out << myNum;
+	return CType(CType::INT);
+}
+
+CType StrLitNode::emitC(CGen * gen, std::ostream& out){
+	int id = gen->internString(myStr);
+	if (id < 0){
+		out << "((art_str)0)";
+	} else {
+		out << "(&" << gen->moduleSym("art_strs") << "[" << id << "])";
+	}
+	return CType(CType::STR);
+}
+
+CType TrueNode::emitC(CGen * gen, std::ostream& out){
+	out << "1";
+	return CType(CType::BOOL);
+}
+
+CType FalseNode::emitC(CGen * gen, std::ostream& out){
+	out << "0";
+	return CType(CType::BOOL);
+}
+
+CType EhNode::emitC(CGen * gen, std::ostream& out){
+	out << "art_eh()";
+	return CType(CType::BOOL);
+}
+
+// Binary Expression Nodes
+
+CType BinaryExpNode::emitCArith(CGen * gen, std::ostream& out,
+  const char * fn, const char * op, bool plain){
+	COperands operands(gen);
+	CType t1 = operands.add(myExp1);
+	CType t2 = operands.add(myExp2);
+	if (t1.kind != CType::INT || t2.kind != CType::INT){
+		CGen::fail(myPos, "Arithmetic operator applied to non-numeric operand");
+	}
+	operands.open(out);
+	if (plain){
+		out << "(" << operands[0] << " " << op << " " << operands[1] << ")";
+	} else {
+		out << fn << "(" << operands[0] << ", " << operands[1] << ")";
+	}
+	operands.close(out);
+	return CType(CType::INT);
+}
+
+CType BinaryExpNode::emitCCompare(CGen * gen, std::ostream& out,
+  const char * op){
+	COperands operands(gen);
+	CType t1 = operands.add(myExp1);
+	CType t2 = operands.add(myExp2);
+	if (t1.kind != t2.kind
+	  || t1.kind == CType::CLASS || t1.kind == CType::STR){
+		CGen::fail(myPos, "Invalid operands to comparison");
+	}
+	operands.open(out);
+	out << "(" << operands[0] << " " << op << " " << operands[1] << ")";
+	operands.close(out);
+	return CType(CType::BOOL);
+}
+
+CType BinaryExpNode::emitCLogic(CGen * gen, std::ostream& out,
+  const char * op){
+	out << "(";
+	CType t1 = myExp1->emitC(gen, out);
+	out << " " << op << " ";
+	CType t2 = myExp2->emitC(gen, out);
+	out << ")";
+	if (t1.kind != CType::BOOL || t2.kind != CType::BOOL){
+		CGen::fail(myPos, "Logical operator applied to non-bool operand");
+	}
+	return CType(CType::BOOL);
+}
+
+CType PlusNode::emitC(CGen * gen, std::ostream& out){
+	CRange sum = CRange::add(myExp1->cRange(gen), myExp2->cRange(gen));
+	return emitCArith(gen, out, "art_add", "+", sum.fits());
+}
+
+CType MinusNode::emitC(CGen * gen, std::ostream& out){
+	CRange diff = CRange::sub(myExp1->cRange(gen), myExp2->cRange(gen));
+	return emitCArith(gen, out, "art_sub", "-", diff.fits());
+}
+
+CType TimesNode::emitC(CGen * gen, std::ostream& out){
+	CRange prod = CRange::mul(myExp1->cRange(gen), myExp2->cRange(gen));
+	return emitCArith(gen, out, "art_mul", "*", prod.fits());
+}
+
+CType DivideNode::emitC(CGen * gen, std::ostream& out){
+	// Safe unless the divisor can be 0, or -1 with INT_MIN
+	CRange dividend = myExp1->cRange(gen);
+	CRange divisor = myExp2->cRange(gen);
+	bool plain = !divisor.contains(0)
+	  && !(divisor.contains(-1) && dividend.contains(INT32_MIN));
+	return emitCArith(gen, out, "art_div", "/", plain);
+}
+
+CType AndNode::emitC(CGen * gen, std::ostream& out){
+	return emitCLogic(gen, out, "&&");
+}
+
+CType OrNode::emitC(CGen * gen, std::ostream& out){
+	return emitCLogic(gen, out, "||");
+}
+
+CType EqualsNode::emitC(CGen * gen, std::ostream& out){
+	return emitCCompare(gen, out, "==");
+}
+
+CType NotEqualsNode::emitC(CGen * gen, std::ostream& out){
+	return emitCCompare(gen, out, "!=");
+}
+
+CType LessNode::emitC(CGen * gen, std::ostream& out){
+	return emitCCompare(gen, out, "<");
+}
+
+CType LessEqNode::emitC(CGen * gen, std::ostream& out){
+	return emitCCompare(gen, out, "<=");
+}
+
+CType GreaterNode::emitC(CGen * gen, std::ostream& out){
+	return emitCCompare(gen, out, ">");
+}
+
+CType GreaterEqNode::emitC(CGen * gen, std::ostream& out){
+	return emitCCompare(gen, out, ">=");
+}
+
+// Unary Expression Nodes
+
+CType NegNode::emitC(CGen * gen, std::ostream& out){
+	bool plain = CRange::neg(myExp->cRange(gen)).fits();
+	out << (plain ? "(-" : "art_neg(");
+	CType type = myExp->emitC(gen, out);
+	out << ")";
+	if (type.kind != CType::INT){
+		CGen::fail(myPos, "Arithmetic operator applied to non-numeric operand");
+	}
+	return CType(CType::INT);
+}
+
+CType NotNode::emitC(CGen * gen, std::ostream& out){
+	out << "(!";
+	CType type = myExp->emitC(gen, out);
+	out << ")";
+	if (type.kind != CType::BOOL){
+		CGen::fail(myPos, "Logical operator applied to non-bool operand");
+	}
+	return CType(CType::BOOL);
+}
+
+/** Statement Nodes **/
+
+/* Fail unless a value of type src may be stored where one of
+   type dst goes */
+static void checkAssign(const Position * pos, CType src, CType dst){
+	if (!src.sameBase(dst)){
+		CGen::fail(pos, "Cannot assign a value of type "
+		  + src.toString() + " to " + dst.base().toString());
+	}
+}
+
+void AssignStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	std::stringstream dstOut;
+	std::stringstream srcOut;
+	CType dstType = myDst->emitC(gen, dstOut);
+	CType srcType = mySrc->emitC(gen, srcOut);
+	checkAssign(mySrc->pos(), srcType, dstType);
+	doIndent(out, indent);
+	out << dstOut.str() << " = " << srcOut.str() << ";\n";
+	gen->assignRange(myDst, mySrc->cRange(gen));
+}
+
+void CallStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	doIndent(out, indent);
+	myCallExp->emitC(gen, out);
+	out << ";\n";
+}
+
+void ReturnStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	bool isVoid = gen->currentRetType().kind == CType::VOID;
+	if (myExp == nullptr && !isVoid){
+		CGen::fail(myPos, "Missing return value");
+	} else if (myExp != nullptr && isVoid){
+		CGen::fail(myExp->pos(), "Return with a value from a void function");
+	}
+	doIndent(out, indent);
+	if (gen->profiling()){
+		// Pop the profiler's frame after evaluating the result
+		out << "{ ";
+		if (myExp != nullptr){
+			out << gen->currentRetType().cName() << " art_ret = ";
+			emitReturnValue(gen, out);
+			out << "; ";
+		}
+		out << "art_prof_leave(art_prof_saved); return";
+		if (myExp != nullptr){ out << " art_ret"; }
+		out << "; }\n";
+		return;
+	}
+	if (myExp == nullptr){
+		out << "return;\n";
+		return;
+	}
+	out << "return ";
+	emitReturnValue(gen, out);
+	out << ";\n";
+}
+
+void ReturnStmtNode::emitReturnValue(CGen * gen, std::ostream& out){
+	CType retType = gen->currentRetType();
+	if (retType.ref && !gen->outlivesFn(myExp)){
+		CGen::fail(myExp->pos(),
+		  "Returned reference outlives what it refers to");
+	}
+	CType type = gen->emitArg(myExp, retType, out);
+	if (!type.sameBase(retType)){
+		CGen::fail(myExp->pos(), "Cannot return a value of type "
+		  + type.toString() + " from a function returning "
+		  + retType.toString());
+	}
+}
+
+void MaybeStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	std::stringstream src1Out;
+	std::stringstream src2Out;
+	CType type = mySrc1->emitC(gen, src1Out);
+	CType type2 = mySrc2->emitC(gen, src2Out);
+	std::stringstream dstOut;
+	CType dstType = myDst->emitC(gen, dstOut);
+	checkAssign(mySrc1->pos(), type, dstType);
+	checkAssign(mySrc2->pos(), type2, dstType);
+	doIndent(out, indent);
+	out << dstOut.str();
+	bool scalar = type.kind == CType::INT || type.kind == CType::BOOL;
+	if (scalar && mySrc1->cSpeculable(gen) && mySrc2->cSpeculable(gen)){
+		// Evaluate both sides and pick one without a branch
+		out << " = (" << type.cName() << ")art_select(art_eh(), "
+		  << src1Out.str() << ", " << src2Out.str() << ");\n";
+	} else {
+		out << " = art_eh() ? " << src1Out.str()
+		  << " : " << src2Out.str() << ";\n";
+	}
+	gen->assignRange(myDst, mySrc1->cRange(gen).join(mySrc2->cRange(gen)));
+}
+
+// Console statement nodes
+
+void FromConsoleStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	std::stringstream dstOut;
+	CType type = myDst->emitC(gen, dstOut);
+	doIndent(out, indent);
+	out << dstOut.str() << " = ";
+	switch (type.kind){
+	case CType::INT: out << "art_get_int();\n"; break;
+	case CType::BOOL: out << "art_get_bool();\n"; break;
+	default:
+		CGen::fail(myPos, "Cannot read a value of type " + type.toString());
+	}
+	gen->assignRange(myDst, CRange());
+}
+
+void ToConsoleStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	std::stringstream srcOut;
+	CType type = mySrc->emitC(gen, srcOut);
+	doIndent(out, indent);
+	switch (type.kind){
+	case CType::INT: out << "art_put_int("; break;
+	case CType::BOOL: out << "art_put_bool("; break;
+	case CType::STR: out << "art_put_str("; break;
+	default:
+		CGen::fail(myPos, "Cannot write a value of type " + type.toString());
+	}
+	out << srcOut.str() << ");\n";
+}
+
+// Increment and Decrement Statement Nodes
+
+void PostDecStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	std::stringstream locOut;
+	myLoc->emitC(gen, locOut);
+	CRange result = CRange::sub(myLoc->cRange(gen), CRange(1, 1));
+	doIndent(out, indent);
+	if (result.fits()){
+		out << locOut.str() << "--;\n";
+		gen->assignRange(myLoc, result);
+	} else {
+		out << locOut.str() << " = art_sub(" << locOut.str() << ", 1);\n";
+		gen->assignRange(myLoc, CRange());
+	}
+}
+
+void PostIncStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	std::stringstream locOut;
+	myLoc->emitC(gen, locOut);
+	CRange result = CRange::add(myLoc->cRange(gen), CRange(1, 1));
+	doIndent(out, indent);
+	if (result.fits()){
+		out << locOut.str() << "++;\n";
+		gen->assignRange(myLoc, result);
+	} else {
+		out << locOut.str() << " = art_add(" << locOut.str() << ", 1);\n";
+		gen->assignRange(myLoc, CRange());
+	}
+}
+
+/* block statements */
+
+/* The condition of a branch, with its counter and hint */
+static void emitCond(CGen * gen, std::ostream& out, ExpNode * cond,
+  std::string key){
+	std::string hint = gen->branchHint(key);
+	if (!hint.empty()){ out << hint << "("; }
+	if (gen->counting()){
+		out << "art_count_branch(";
+		cond->emitC(gen, out);
+		out << ", " << gen->countBranch(key) << ")";
+	} else {
+		cond->emitC(gen, out);
+	}
+	if (!hint.empty()){ out << ")"; }
+}
+
+void IfStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << "if (";
+	emitCond(gen, out, myCond, siteKey("if", myPos));
+	out << "){\n";
+	CGen::Facts before = gen->facts();
+	myCond->cRefine(gen, true);
+	emitBlock(gen, out, myBody, indent + 1);
+	CGen::Facts after = gen->facts();
+	gen->setFacts(before);
+	myCond->cRefine(gen, false);
+	gen->joinFacts(after);
+	doIndent(out, indent);
+	out << "}\n";
+}
+
+void IfElseStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << "if (";
+	emitCond(gen, out, myCond, siteKey("if", myPos));
+	out << "){\n";
+	CGen::Facts before = gen->facts();
+	myCond->cRefine(gen, true);
+	emitBlock(gen, out, myBodyTrue, indent + 1);
+	CGen::Facts afterTrue = gen->facts();
+	gen->setFacts(before);
+	myCond->cRefine(gen, false);
+	doIndent(out, indent);
+	out << "} else {\n";
+	emitBlock(gen, out, myBodyFalse, indent + 1);
+	gen->joinFacts(afterTrue);
+	doIndent(out, indent);
+	out << "}\n";
+}
+
+/* The ranges that hold every time the loop condition is
+   tested, found by emitting the body (to nowhere) until they
+   stop changing */
+static CGen::Facts loopFacts(CGen * gen, ExpNode * cond,
+  std::list<StmtNode *> * body){
+	CGen::Facts head = gen->facts();
+	if (!gen->rangesOn()){ return head; }
+	if (gen->scratchDepth() > 2){
+		// Deep inside other loops' analysis: give up rather
+		// than pay for another nested fixpoint
+		gen->havocFacts();
+		return gen->facts();
+	}
+	for (int pass = 0; ; pass++){
+		gen->setFacts(head);
+		cond->cRefine(gen, true);
+		std::stringstream ignored;
+		gen->enterScratch();
+		emitBlock(gen, ignored, body, 0);
+		gen->leaveScratch();
+		gen->joinFacts(head);
+		bool changed = pass == 0 ? true : gen->widenFacts(head);
+		CGen::Facts next = gen->facts();
+		gen->setFacts(head);
+		if (!changed){ return head; }
+		head = next;
+	}
+}
+
+void WhileStmtNode::emitC(CGen * gen, std::ostream& out, int indent){
+	std::string key = siteKey("while", myPos);
+	CGen::Facts head = loopFacts(gen, myCond, myBody);
+	gen->setFacts(head);
+	if (gen->hotLoop(key)){
+		doIndent(out, indent);
+		out << "ART_UNROLL\n";
+	}
+	doIndent(out, indent);
+	out << "while (";
+	emitCond(gen, out, myCond, key);
+	out << "){\n";
+	myCond->cRefine(gen, true);
+	emitBlock(gen, out, myBody, indent + 1);
+	gen->setFacts(head);
+	myCond->cRefine(gen, false);
+	doIndent(out, indent);
+	out << "}\n";
+}
+
+/** Declaration Nodes **/
+
+static bool isObject(CType type){
+	return type.kind == CType::CLASS && !type.ref;
+}
+
+void VarDeclNode::emitC(CGen * gen, std::ostream& out, int indent){
+	CType type = myType->cType(gen);
+	if (type.kind == CType::VOID){
+		CGen::fail(myPos, "Invalid type in declaration");
+	}
+	std::string name = CGen::varName(myID->getName());
+
+	// The initializer is emitted before the name is in scope
+	std::stringstream initOut;
+	CRange initRange(0, 0);
+	if (myInit != nullptr){
+		checkAssign(myInit->pos(), gen->emitArg(myInit, type, initOut), type);
+		initRange = myInit->cRange(gen);
+	} else if (isObject(type)){
+		initOut << "{0}";
+	} else {
+		initOut << "0";
+	}
+	gen->declareLocal(myPos, myID->getName(), type);
+	gen->assignRange(myID, initRange);
+
+	doIndent(out, indent);
+	out << type.cName() << " " << name << " = " << initOut.str() << ";\n";
+	if (myInit == nullptr && isObject(type)){
+		doIndent(out, indent);
+		out << CGen::initName(type.module, type.cls)
+		  << "(&" << name << ");\n";
+	}
+}
+
+void VarDeclNode::cDeclare(CGen * gen, std::ostream& out){
+	CType type = myType->cType(gen);
+	if (type.kind == CType::VOID){
+		CGen::fail(myPos, "Invalid type in declaration");
+	}
+	gen->declareGlobal(myPos, myID->getName(), type);
+	out << "static " << type.cName() << " "
+	  << CGen::globalName(gen->declModule(), myID->getName()) << ";\n";
+}
+
+void VarDeclNode::cDefine(CGen * gen, std::ostream& out){
+	// Globals are zeroed by C; anything more runs before main
+	CType type = myType->cType(gen);
+	std::string name = CGen::globalName(gen->declModule(), myID->getName());
+	if (myInit != nullptr && type.ref){
+		std::stringstream init;
+		bool bound = false;
+		checkAssign(myInit->pos(), gen->emitStorage(myInit, init, bound),
+		  type);
+		gen->takeTemps(gen->globalInits(), 1);
+		if (bound){
+			gen->globalInits() << "\t" << name << " = " << init.str()
+			  << ";\n";
+		} else {
+			// A global reference to a value refers to a cell of
+			// its own, which must outlive the initializing function
+			gen->globalInits() << "\t{ static " << type.base().cName()
+			  << " art_cell; art_cell = " << init.str() << "; "
+			  << name << " = &art_cell; }\n";
+		}
+	} else if (myInit != nullptr){
+		std::stringstream init;
+		checkAssign(myInit->pos(), gen->emitArg(myInit, type, init), type);
+		gen->takeTemps(gen->globalInits(), 1);
+		gen->globalInits() << "\t" << name << " = " << init.str() << ";\n";
+	} else if (isObject(type)){
+		gen->globalInits() << "\t" << CGen::initName(type.module, type.cls)
+		  << "(&" << name << ");\n";
+	}
+}
+
+void ClassDefnNode::emitC(CGen * gen, std::ostream& out, int indent){
+	throw new InternalError("Class definition in statement position");
+}
+
+void ClassDefnNode::cDeclare(CGen * gen, std::ostream& out){
+	std::string name = myID->getName();
+	CClass * cls = gen->declareClass(myPos, name, this);
+	if (cls == nullptr){ return; }
+	gen->enterClass(cls);
+
+	// Objects are plain structs; methods take the object
+	// as an explicit first argument
+	std::list<VarDeclNode *> fields;
+	for (auto member : *myMembers){
+		auto field = dynamic_cast<VarDeclNode *>(member);
+		if (field == nullptr){ continue; }
+		std::string fieldName = field->ID()->getName();
+		CType type = field->getTypeNode()->cType(gen);
+		if (type.kind == CType::VOID){
+			CGen::fail(field->pos(), "Invalid type in declaration");
+		}
+		if (isObject(type) && type.cls == name
+		  && type.module == cls->module){
+			CGen::fail(field->pos(), "Custom type " + name
+			  + " cannot contain itself");
+		}
+		if (cls->fields.find(fieldName) != cls->fields.end()){
+			CGen::fail(field->pos(),
+			  "Multiply declared identifier " + fieldName);
+		}
+		cls->fields.emplace(fieldName, type);
+		fields.push_back(field);
+	}
+
+	// With counts, the most used fields go first so that they
+	// share cache lines
+	if (gen->hasFeedback()){
+		auto uses = [gen, name](VarDeclNode * field){
+			return gen->feedback("field:" + name + "."
+			  + field->ID()->getName());
+		};
+		fields.sort([uses](VarDeclNode * a, VarDeclNode * b){
+			return uses(a) > uses(b);
+		});
+	}
+	out << "struct " << CGen::structName(cls->module, name) << "{\n";
+	for (auto field : fields){
+		std::string fieldName = field->ID()->getName();
+		cls->fieldOrder.push_back(fieldName);
+		out << "\t" << cls->fields.find(fieldName)->second.cName() << " "
+		  << CGen::varName(fieldName) << ";\n";
+	}
+	if (cls->fields.empty()){
+		// C does not allow empty structs
+		out << "\tchar art_unused;\n";
+	}
+	out << "};\n";
+	out << "static void " << CGen::initName(cls->module, name)
+	  << "(struct " << CGen::structName(cls->module, name)
+	  << " * art_self);\n";
+
+	for (auto member : *myMembers){
+		auto method = dynamic_cast<FnDeclNode *>(member);
+		if (method != nullptr){ method->cDeclare(gen, out); }
+	}
+	gen->leaveClass();
+}
+
+void ClassDefnNode::cDefine(CGen * gen, std::ostream& out){
+	std::string name = myID->getName();
+	CClass * cls = gen->lookupClass(myPos, name);
+	gen->enterClass(cls);
+
+	// Field initializers run (in order) whenever an object
+	// of this type comes into existence
+	out << "static void " << CGen::initName(cls->module, name)
+	  << "(struct " << CGen::structName(cls->module, name)
+	  << " * art_self){\n";
+	out << "\t(void)art_self;\n";
+	for (auto member : *myMembers){
+		auto field = dynamic_cast<VarDeclNode *>(member);
+		if (field == nullptr){ continue; }
+		CType type = cls->fields.find(field->ID()->getName())->second;
+		std::string access = "art_self->"
+		  + CGen::varName(field->ID()->getName());
+		if (field->getInit() != nullptr){
+			if (type.ref && !gen->outlivesFn(field->getInit())){
+				CGen::fail(field->getInit()->pos(),
+				  "Reference field outlives what it refers to");
+			}
+			std::stringstream init;
+			checkAssign(field->getInit()->pos(),
+			  gen->emitArg(field->getInit(), type, init), type);
+			gen->takeTemps(out, 1);
+			out << "\t" << access << " = " << init.str() << ";\n";
+		} else if (isObject(type)){
+			out << "\t" << CGen::initName(type.module, type.cls)
+			  << "(&" << access << ");\n";
+		}
+	}
+	out << "}\n\n";
+
+	for (auto member : *myMembers){
+		auto method = dynamic_cast<FnDeclNode *>(member);
+		if (method != nullptr){ method->cDefine(gen, out); }
+	}
+	gen->leaveClass();
+}
+
+/* The C signature of a function or (in class context) method */
+static std::string cSignature(CGen * gen, FnDeclNode * fn){
+	std::string name = fn->ID()->getName();
+	CClass * cls = gen->currentClass();
+	std::stringstream sig;
+	std::string temperature = gen->fnTemperature(fnName(gen, name));
+	if (!temperature.empty()){ sig << temperature << " "; }
+	sig << "static ";
+	// Let the C compiler inline hot functions into their callers
+	if (temperature == "ART_HOT"){ sig << "inline "; }
+	sig << fn->getRetTypeNode()->cType(gen).cName() << " ";
+	bool first = true;
+	if (cls != nullptr){
+		std::string clsName = cls->defn->ID()->getName();
+		sig << CGen::methodName(cls->module, clsName, name) << "(struct "
+		  << CGen::structName(cls->module, clsName) << " * art_self";
+		first = false;
+	} else {
+		sig << gen->fnCName(name) << "(";
+	}
+	for (auto formal : *fn->getFormals()){
+		if (first){ first = false; }
+		else { sig << ", "; }
+		sig << formal->getTypeNode()->cType(gen).cName() << " "
+		  << CGen::varName(formal->ID()->getName());
+	}
+	if (first){ sig << "void"; }
+	sig << ")";
+	return sig.str();
+}
+
+void FnDeclNode::emitC(CGen * gen, std::ostream& out, int indent){
+	throw new InternalError("Function definition in statement position");
+}
+
+void FnDeclNode::cDeclare(CGen * gen, std::ostream& out){
+	std::string name = myID->getName();
+	CClass * cls = gen->currentClass();
+	if (cls == nullptr){
+		gen->declareFn(myPos, name, this);
+	} else if (cls->methods.find(name) != cls->methods.end()
+	  || cls->fields.find(name) != cls->fields.end()){
+		CGen::fail(myPos, "Multiply declared identifier " + name);
+	} else {
+		cls->methods[name] = this;
+	}
+	out << cSignature(gen, this) << ";\n";
+}
+
+void FnDeclNode::cDefine(CGen * gen, std::ostream& out){
+	out << cSignature(gen, this) << "{\n";
+	if (gen->profiling()){
+		out << "\tint32_t art_prof_saved = art_prof_enter("
+		  << gen->profileId(fnName(gen, myID->getName())) << ");\n";
+	}
+	gen->enterFn(myRetType->cType(gen));
+	gen->enterScope();
+	for (auto formal : *myFormals){
+		CType type = formal->getTypeNode()->cType(gen);
+		if (type.kind == CType::VOID){
+			CGen::fail(formal->pos(), "Invalid type in declaration");
+		}
+		gen->declareLocal(formal->pos(), formal->ID()->getName(), type);
+	}
+	// A first pass finds the locals whose address is taken
+	// anywhere in the body, before any range is relied on
+	std::stringstream ignored;
+	gen->setRanges(false);
+	emitBlock(gen, ignored, myBody, 1);
+	gen->takeTemps(ignored, 1);
+	gen->setRanges(true);
+	std::stringstream body;
+	emitBlock(gen, body, myBody, 1);
+	gen->takeTemps(out, 1);
+	out << body.str();
+	gen->leaveScope();
+	if (gen->profiling()){ out << "\tart_prof_leave(art_prof_saved);\n"; }
+	out << "}\n\n";
+}
+
+} // End namespace a_lang
@@ -0,0 +1,328 @@
+#ifndef A_LANG_CGEN_HPP
+#define A_LANG_CGEN_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+#include "ast.hpp"
+#include "errors.hpp"
+#include "module.hpp"
+
+namespace a_lang{
+
+/** The type of an expression (or declaration) as far as
+ * the C backend is concerned. Immutability is a frontend
+ * concern, so it is dropped here. A reference is a pointer
+ * to its base type, and uses of it are implicitly
+ * dereferenced.
+**/
+class CType{
+public:
+	enum Kind { INT, BOOL, STR, VOID, CLASS };
+	CType(Kind kindIn, std::string clsIn = "", bool refIn = false,
+	  std::string moduleIn = "")
+	: kind(kindIn), cls(clsIn), ref(refIn), module(moduleIn){ }
+	/** The same type without the reference **/
+	CType base() const { return CType(kind, cls, false, module); }
+	/** Whether other is this type, references aside **/
+	bool sameBase(const CType& other) const {
+		return kind == other.kind && cls == other.cls
+		  && module == other.module;
+	}
+	/** The C spelling of this type, e.g. "struct a_Point *" **/
+	std::string cName() const;
+	std::string toString() const;
+	Kind kind;
+	std::string cls;
+	bool ref;
+	/** The module a custom type is declared in **/
+	std::string module;
+};
+
+/** An interval of int values, used to prove that arithmetic
+ * cannot overflow or divide by zero. The bounds are wider than
+ * an int so that the exact result of an operation on two int
+ * ranges is representable. lo > hi means no value at all, i.e.
+ * the code is unreachable.
+**/
+class CRange{
+public:
+	CRange() : lo(INT32_MIN), hi(INT32_MAX){ }
+	CRange(int64_t loIn, int64_t hiIn) : lo(loIn), hi(hiIn){ }
+	bool empty() const { return lo > hi; }
+	/** Whether every value in the range is a valid int **/
+	bool fits() const {
+		return empty() || (lo >= INT32_MIN && hi <= INT32_MAX);
+	}
+	bool contains(int64_t v) const { return lo <= v && v <= hi; }
+	bool operator==(const CRange& other) const {
+		return lo == other.lo && hi == other.hi;
+	}
+	CRange join(CRange other) const;
+	CRange meet(CRange other) const;
+	/** Push the bounds that moved since prev to the int limits,
+	 * so that loop analysis terminates **/
+	CRange widen(CRange prev) const;
+	static CRange add(CRange a, CRange b);
+	static CRange sub(CRange a, CRange b);
+	static CRange mul(CRange a, CRange b);
+	static CRange div(CRange a, CRange b);
+	static CRange neg(CRange a);
+	int64_t lo;
+	int64_t hi;
+};
+
+/** What an identifier in scope resolves to. The range is only
+ * meaningful for int locals whose address is never taken. **/
+class CSym{
+public:
+	CSym(CType typeIn, std::string cNameIn)
+	: type(typeIn), cName(cNameIn){ }
+	CType type;
+	std::string cName;
+	CRange range;
+};
+
+/** Layout and members of a custom type **/
+class CClass{
+public:
+	CClass(ClassDefnNode * defnIn, std::string moduleIn)
+	: defn(defnIn), module(moduleIn){ }
+	ClassDefnNode * defn;
+	/** The module it is declared in **/
+	std::string module;
+	/** Fields in struct layout order **/
+	std::list<std::string> fieldOrder;
+	std::map<std::string, CType> fields;
+	std::map<std::string, FnDeclNode *> methods;
+};
+
+/** Options that change what the backend emits **/
+class CGenOpts{
+public:
+	CGenOpts() : profile(false), count(false), srcName("<input>"),
+	  module("input"), imported(nullptr){ }
+	/** Read counts written by a program built with count set.
+	 * Throws a UserError if the file cannot be read. **/
+	void loadFeedback(std::string path);
+	/** Instrument the program for the sampling profiler **/
+	bool profile;
+	/** Instrument the program to count branches, calls and
+	 * field accesses **/
+	bool count;
+	/** The source file, as named in profile reports **/
+	std::string srcName;
+	/** Counts from an earlier run, by key **/
+	std::map<std::string, uint64_t> feedback;
+	/** The module's tag (see moduleTag), which names the C
+	 * symbols each module of a program has its own of **/
+	std::string module;
+	/** The imported modules, as read from their interfaces
+	 * (see importedDecls) **/
+	std::list<ImportedModule> * imported;
+};
+
+/** \class CGen
+* State threaded through the C backend: the scopes needed
+* to resolve names (there is no separate name analysis
+* pass yet), the custom types and functions declared so
+* far, and the statements that initialize globals.
+**/
+class CGen{
+public:
+	CGen(const CGenOpts& opts);
+	CGen(const CGen&) = delete;
+	CGen& operator=(const CGen&) = delete;
+	~CGen();
+
+	/** Emit the fixed runtime that every program links against,
+	 * plus the profiler and counters if asked **/
+	static void emitRuntime(std::ostream& out, bool profile, bool count);
+
+	/* Name mangling. Every user identifier gets a prefix so
+	   it cannot collide with C keywords or the runtime, which
+	   only uses the art_ prefix. Locals and fields are named as
+	   they are; what is declared at the top level of a module
+	   also gets the module's tag, since the C of a program's
+	   modules is compiled as one unit. */
+	static std::string varName(std::string name);
+	static std::string globalName(std::string module, std::string name);
+	static std::string structName(std::string module, std::string cls);
+	static std::string initName(std::string module, std::string cls);
+	static std::string methodName(std::string module, std::string cls,
+	  std::string fn);
+
+	void enterScope();
+	void leaveScope();
+	void declareLocal(const Position * pos, std::string name, CType type);
+	void declareGlobal(const Position * pos, std::string name, CType type);
+	void declareFn(const Position * pos, std::string name,
+	  FnDeclNode * fn);
+	/** Declare a custom type of the module being declared, or
+	 * return nullptr if another module's interface has already
+	 * declared it (see setDeclVisible) **/
+	CClass * declareClass(const Position * pos, std::string name,
+	  ClassDefnNode * defn);
+
+	/** Look up a variable (local, field of the enclosing
+	 * class, or global). Throws a UserError if undeclared. **/
+	CSym lookupVar(IDNode * id);
+	/** The custom type called name here, i.e. not one only an
+	 * import's signatures use **/
+	CClass * lookupClass(const Position * pos, std::string name);
+	/** The custom type called name of the module tagged module **/
+	CClass * lookupClass(const Position * pos, std::string module,
+	  std::string name);
+	CClass * lookupClass(const Position * pos, CType type);
+	/** The global function called name, or nullptr **/
+	FnDeclNode * findFn(std::string name);
+	/** The C name of the global function called name **/
+	std::string fnCName(std::string name);
+	/** Look up the target of a call by bare name. Sets
+	 * isMethod when it is a method of the enclosing class. **/
+	FnDeclNode * lookupFn(IDNode * id, bool& isMethod);
+
+	/** The constant-table slot of a string literal (given as
+	 * its lexeme, quotes and escapes included), or -1 for the
+	 * empty string, which is the null handle **/
+	int internString(std::string lexeme);
+	/** Every string interned so far, by slot **/
+	const std::list<std::string>& strings(){ return myStrings; }
+	/** Emit the table of every string interned so far **/
+	void emitStrings(std::ostream& out);
+
+	/** Emit an argument bound to a formal of type formal, and
+	 * return the argument's type **/
+	CType emitArg(ExpNode * arg, CType formal, std::ostream& out);
+	/** Emit the address of exp's storage, if it has any (it is a
+	 * location, or a call that returns a reference), and set
+	 * bound; otherwise emit its value. Return exp's type. **/
+	CType emitStorage(ExpNode * exp, std::ostream& out, bool& bound);
+	/** A C variable to hold a value of type that must be
+	 * computed ahead of where it is used (see COperands in
+	 * cgen.cpp). The next takeTemps declares it. **/
+	std::string newTemp(CType type);
+	/** Declare the temporaries made since the last call **/
+	void takeTemps(std::ostream& out, int indent);
+	/** Whether exp is a location whose storage lives on after
+	 * the function being emitted returns, so that a reference
+	 * to it may be returned or kept in an object **/
+	bool outlivesFn(ExpNode * exp);
+
+	/* Ranges of int locals, updated as statements are emitted.
+	   The facts are just the scopes, so they can be saved
+	   before a branch and joined after it. */
+	typedef std::list<std::map<std::string, CSym>> Facts;
+	Facts facts(){ return myScopes; }
+	void setFacts(const Facts& facts){ myScopes = facts; }
+	/** Join other into the current facts (control flow merge) **/
+	void joinFacts(const Facts& other);
+	/** Widen the current facts against those of the last pass
+	 * over a loop. Returns false if nothing changed. **/
+	bool widenFacts(const Facts& prev);
+	/** Forget the ranges of every local **/
+	void havocFacts();
+	CRange rangeOf(ExpNode * loc);
+	void assignRange(ExpNode * loc, CRange range);
+	void narrowRange(ExpNode * loc, CRange range);
+	/** Stop tracking a local whose address is taken, since it
+	 * can then change behind the analysis' back **/
+	void escape(ExpNode * loc);
+	/** Range tracking is off while looking for escapes **/
+	void setRanges(bool on){ myRangesOn = on; }
+	bool rangesOn(){ return myRangesOn; }
+	/** Nesting of loop bodies being emitted only for analysis **/
+	void enterScratch(){ myScratch++; }
+	void leaveScratch(){ myScratch--; }
+	int scratchDepth(){ return myScratch; }
+
+	void enterClass(CClass * cls){ myClass = cls; }
+	void leaveClass(){ myClass = nullptr; }
+	CClass * currentClass(){ return myClass; }
+	void enterFn(CType retType){
+		myRetType = retType;
+		myEscaped.clear();
+	}
+	CType currentRetType(){ return myRetType; }
+
+	/** A per-module C symbol, such as the string table **/
+	std::string moduleSym(std::string base){
+		return base + "_" + myOpts.module;
+	}
+	/** The tag of the module whose declarations are being
+	 * declared: an imported one's, then the program's own **/
+	std::string declModule(){ return myDeclModule; }
+	void setDeclModule(std::string module){ myDeclModule = module; }
+	/** Whether the custom types being declared can be named, or
+	 * are only used by an imported module's signatures **/
+	void setDeclVisible(bool visible){ myDeclVisible = visible; }
+
+	bool profiling(){ return myOpts.profile; }
+	std::string srcName(){ return myOpts.srcName; }
+	/** Give a function the next id in the profiler's name table **/
+	int profileId(std::string name);
+	const std::list<std::string>& profileNames(){ return myProfileNames; }
+
+	/* Counters (-I). A site is keyed by its kind and source
+	   position so that the keys survive a recompile. */
+	bool counting(){ return myOpts.count; }
+	int countSite(std::string key);
+	/** Two slots, for the taken and not taken sides **/
+	int countBranch(std::string key);
+	/** Wrap the lvalue access to a field so it is counted **/
+	std::string countField(std::string cls, std::string field,
+	  CType type, std::string access);
+	const std::list<std::string>& countKeys(){ return myCountKeys; }
+
+	/* Decisions driven by counts from an earlier run (-F) */
+	bool hasFeedback(){ return !myOpts.feedback.empty(); }
+	uint64_t feedback(std::string key);
+	/** ART_LIKELY, ART_UNLIKELY, or "" for a branch site **/
+	std::string branchHint(std::string key);
+	/** Whether a loop runs many iterations per entry **/
+	bool hotLoop(std::string key);
+	/** ART_HOT, ART_COLD or "" for a function **/
+	std::string fnTemperature(std::string name);
+
+	/** Statements run before main to initialize globals **/
+	std::ostream& globalInits(){ return myGlobalInits; }
+	std::string globalInitCode(){ return myGlobalInits.str(); }
+
+	[[noreturn]] static void fail(const Position * pos, std::string msg);
+private:
+	CGenOpts myOpts;
+	std::list<std::string> myProfileNames;
+	std::map<std::string, int> myCountSlots;
+	std::list<std::string> myCountKeys;
+	std::map<std::string, uint64_t> myCallsTo;
+	uint64_t myTotalCalls;
+	std::set<std::string> myEscaped;
+	std::map<std::string, int> myStringIds;
+	std::list<std::string> myStrings;
+	int myTempCount;
+	std::list<std::string> myTemps;
+	bool myRangesOn;
+	int myScratch;
+	std::list<std::map<std::string, CSym>> myScopes;
+	std::map<std::string, CSym> myGlobals;
+	std::map<std::string, FnDeclNode *> myFns;
+	std::map<std::string, std::string> myFnCNames;
+	std::string myDeclModule;
+	bool myDeclVisible;
+	/* Every custom type, by module and name, and those that can
+	   be named by name */
+	std::map<std::pair<std::string, std::string>, CClass *> myAllClasses;
+	std::map<std::string, CClass *> myClasses;
+	CClass * myClass;
+	CType myRetType;
+	std::stringstream myGlobalInits;
+};
+
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include "cgen.hpp"
+
+namespace a_lang{
+
+/*
+Value ranges for the C backend. As the backend emits a
+function it keeps an interval for each int local (see
+CGen::facts), and the methods here compute the interval of an
+expression from them (cRange) or narrow them by what a branch
+condition says (cRefine). Where the intervals show that an
+operation cannot overflow or divide by zero, cgen.cpp emits a
+plain C operator in place of the runtime's wrapping or checked
+helper.
+*/
+
+static CRange nothing(){
+	return CRange(1, 0);
+}
+
+/** CRange **/
+
+CRange CRange::join(CRange other) const{
+	if (empty()){ return other; }
+	if (other.empty()){ return *this; }
+	return CRange(std::min(lo, other.lo), std::max(hi, other.hi));
+}
+
+CRange CRange::meet(CRange other) const{
+	return CRange(std::max(lo, other.lo), std::min(hi, other.hi));
+}
+
+CRange CRange::widen(CRange prev) const{
+	if (empty() || prev.empty()){ return *this; }
+	CRange result = *this;
+	if (lo < prev.lo){ result.lo = INT32_MIN; }
+	if (hi > prev.hi){ result.hi = INT32_MAX; }
+	return result;
+}
+
+CRange CRange::add(CRange a, CRange b){
+	if (a.empty() || b.empty()){ return nothing(); }
+	return CRange(a.lo + b.lo, a.hi + b.hi);
+}
+
+CRange CRange::sub(CRange a, CRange b){
+	if (a.empty() || b.empty()){ return nothing(); }
+	return CRange(a.lo - b.hi, a.hi - b.lo);
+}
+
+CRange CRange::mul(CRange a, CRange b){
+	if (a.empty() || b.empty()){ return nothing(); }
+	int64_t c1 = a.lo * b.lo;
+	int64_t c2 = a.lo * b.hi;
+	int64_t c3 = a.hi * b.lo;
+	int64_t c4 = a.hi * b.hi;
+	return CRange(std::min(std::min(c1, c2), std::min(c3, c4)),
+	  std::max(std::max(c1, c2), std::max(c3, c4)));
+}
+
+CRange CRange::div(CRange a, CRange b){
+	if (a.empty() || b.empty()){ return nothing(); }
+	// Across a zero divisor the quotient can be anything
+	if (b.contains(0)){ return CRange(); }
+	// Otherwise C's division is monotone in each operand
+	int64_t c1 = a.lo / b.lo;
+	int64_t c2 = a.lo / b.hi;
+	int64_t c3 = a.hi / b.lo;
+	int64_t c4 = a.hi / b.hi;
+	return CRange(std::min(std::min(c1, c2), std::min(c3, c4)),
+	  std::max(std::max(c1, c2), std::max(c3, c4)));
+}
+
+CRange CRange::neg(CRange a){
+	if (a.empty()){ return nothing(); }
+	return CRange(-a.hi, -a.lo);
+}
+
+/* A result that does not fit wraps around, so it could be
+   any int */
+static CRange wrapped(CRange exact){
+	if (exact.fits()){ return exact; }
+	return CRange();
+}
+
+/** Ranges of expressions **/
+
+CRange ExpNode::cRange(CGen * gen){
+	return CRange();
+}
+
+CRange IDNode::cRange(CGen * gen){
+	return gen->rangeOf(this);
+}
+
+CRange IntLitNode::cRange(CGen * gen){
+	return CRange(myNum, myNum);
+}
+
+CRange PlusNode::cRange(CGen * gen){
+	return wrapped(CRange::add(myExp1->cRange(gen), myExp2->cRange(gen)));
+}
+
+CRange MinusNode::cRange(CGen * gen){
+	return wrapped(CRange::sub(myExp1->cRange(gen), myExp2->cRange(gen)));
+}
+
+CRange TimesNode::cRange(CGen * gen){
+	return wrapped(CRange::mul(myExp1->cRange(gen), myExp2->cRange(gen)));
+}
+
+CRange DivideNode::cRange(CGen * gen){
+	return wrapped(CRange::div(myExp1->cRange(gen), myExp2->cRange(gen)));
+}
+
+CRange NegNode::cRange(CGen * gen){
+	return wrapped(CRange::neg(myExp->cRange(gen)));
+}
+
+/** Refinement by conditions **/
+
+static std::string negateCompare(std::string op){
+	if (op == "<"){ return ">="; }
+	if (op == "<="){ return ">"; }
+	if (op == ">"){ return "<="; }
+	if (op == ">="){ return "<"; }
+	if (op == "=="){ return "!="; }
+	return "==";
+}
+
+/* x op y is y flip(op) x */
+static std::string flipCompare(std::string op){
+	if (op == "<"){ return ">"; }
+	if (op == "<="){ return ">="; }
+	if (op == ">"){ return "<"; }
+	if (op == ">="){ return "<="; }
+	return op;
+}
+
+/* The values x can take if x op y holds for some y in other */
+static CRange compareBound(CRange x, std::string op, CRange other){
+	if (other.empty()){ return nothing(); }
+	if (op == "<"){ return CRange(INT32_MIN, other.hi - 1); }
+	if (op == "<="){ return CRange(INT32_MIN, other.hi); }
+	if (op == ">"){ return CRange(other.lo + 1, INT32_MAX); }
+	if (op == ">="){ return CRange(other.lo, INT32_MAX); }
+	if (op == "=="){ return other; }
+	// x != v only helps when v is one of x's bounds
+	CRange result = x;
+	if (other.lo == other.hi){
+		if (result.lo == other.lo){ result.lo++; }
+		if (result.hi == other.hi){ result.hi--; }
+	}
+	return result;
+}
+
+void BinaryExpNode::cRefineCompare(CGen * gen, bool truth,
+  std::string op){
+	if (!truth){ op = negateCompare(op); }
+	CRange r1 = myExp1->cRange(gen);
+	CRange r2 = myExp2->cRange(gen);
+	gen->narrowRange(myExp1, compareBound(r1, op, r2));
+	gen->narrowRange(myExp2, compareBound(r2, flipCompare(op), r1));
+}
+
+void EqualsNode::cRefine(CGen * gen, bool truth){
+	cRefineCompare(gen, truth, "==");
+}
+
+void NotEqualsNode::cRefine(CGen * gen, bool truth){
+	cRefineCompare(gen, truth, "!=");
+}
+
+void LessNode::cRefine(CGen * gen, bool truth){
+	cRefineCompare(gen, truth, "<");
+}
+
+void LessEqNode::cRefine(CGen * gen, bool truth){
+	cRefineCompare(gen, truth, "<=");
+}
+
+void GreaterNode::cRefine(CGen * gen, bool truth){
+	cRefineCompare(gen, truth, ">");
+}
+
+void GreaterEqNode::cRefine(CGen * gen, bool truth){
+	cRefineCompare(gen, truth, ">=");
+}
+
+void AndNode::cRefine(CGen * gen, bool truth){
+	// When a && b is false, either one may be the reason
+	if (!truth){ return; }
+	myExp1->cRefine(gen, true);
+	myExp2->cRefine(gen, true);
+}
+
+void OrNode::cRefine(CGen * gen, bool truth){
+	if (truth){ return; }
+	myExp1->cRefine(gen, false);
+	myExp2->cRefine(gen, false);
+}
+
+void NotNode::cRefine(CGen * gen, bool truth){
+	myExp->cRefine(gen, !truth);
+}
+
+} // End namespace a_lang
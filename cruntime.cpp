@@ -0,0 +1,644 @@
+#include "cgen.hpp"
+
+namespace a_lang{
+
+/*
+The runtime for programs produced by the C backend. It is
+pasted verbatim at the top of every generated file, so the
+output is a single self-contained C99 translation unit that
+any C compiler can build (e.g. cc -O2 prog.c -o prog).
+
+Integers wrap on overflow, as they would on the hardware;
+the arithmetic goes through unsigned types so the C
+optimizer cannot assume otherwise.
+
+Console I/O bypasses stdio's per-call overhead. Output is
+collected in one large block that is written when it fills,
+when the program is about to block for input, and at exit.
+Input is read in bulk and ints and bools are parsed straight
+out of the buffer.
+
+A string is a pointer to an immutable record of its bytes,
+length and hash. The compiler lays out each distinct literal
+once, in a constant table, so strings are never measured or
+copied at run time. The empty string is the null handle.
+
+eh? and maybe draw from xoshiro256**, seeded through
+splitmix64. Passing --seed <n> to the compiled program makes
+a run reproducible.
+
+Profiled builds (ac -P) also get a sampling profiler, and
+instrumented builds (ac -I) counters, pasted between the two
+halves of the runtime.
+*/
+static const char * const runtimeHead = R"ART(/* Generated by ac */
+#define _XOPEN_SOURCE 700
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define ART_READ(buf, cap) read(0, (buf), (cap))
+#else
+/* stdio's fread would wait for cap bytes, so a prompt written
+   before a read would go unanswered until then; read up to the
+   end of a line instead, which is all a console has to give. */
+static long art_read_line(char * buf, size_t cap){
+	size_t got = 0;
+	int c;
+	while (got < cap && (c = getchar()) != EOF){
+		buf[got++] = (char)c;
+		if (c == '\n'){ break; }
+	}
+	return (long)got;
+}
+#define ART_READ(buf, cap) art_read_line((buf), (cap))
+#endif
+
+typedef int32_t art_int;
+typedef _Bool art_bool;
+typedef struct {
+	const char * bytes;
+	uint32_t len;
+	uint32_t hash;
+} art_str_rep;
+typedef const art_str_rep * art_str;
+
+/* Hints placed by profile-guided builds (ac -F) */
+#if defined(__GNUC__)
+#define ART_LIKELY(c) __builtin_expect(!!(c), 1)
+#define ART_UNLIKELY(c) __builtin_expect(!!(c), 0)
+#define ART_HOT __attribute__((hot))
+#define ART_COLD __attribute__((cold))
+#else
+#define ART_LIKELY(c) (c)
+#define ART_UNLIKELY(c) (c)
+#define ART_HOT
+#define ART_COLD
+#endif
+#if defined(__clang__)
+#define ART_UNROLL _Pragma("unroll 4")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define ART_UNROLL _Pragma("GCC unroll 4")
+#else
+#define ART_UNROLL
+#endif
+
+#define ART_OUT_CAP (1 << 16)
+#define ART_IN_CAP (1 << 16)
+static char art_out[ART_OUT_CAP];
+static size_t art_out_len;
+static char art_in[ART_IN_CAP];
+static size_t art_in_pos;
+static size_t art_in_len;
+
+static void art_flush(void){
+	if (art_out_len > 0){
+		fwrite(art_out, 1, art_out_len, stdout);
+		fflush(stdout);
+		art_out_len = 0;
+	}
+}
+
+)ART";
+
+/*
+The profiler. Instrumented code keeps a shadow stack of
+function ids and the line of the statement being run. A
+SIGPROF timer samples both every millisecond of CPU time and
+folds the sample into a fixed table keyed by (stack, line),
+so memory use does not grow with run time. At exit the table
+is written out as a flat profile, a call tree, and collapsed
+stacks for flame graph tools.
+*/
+static const char * const profilerSrc = R"ART(#define ART_PROFILE 1
+#include <signal.h>
+#include <sys/time.h>
+
+#define ART_PROF_DEPTH 64
+#define ART_PROF_SLOTS 16384
+
+typedef struct {
+	uint32_t count;
+	int32_t line;
+	int32_t depth;
+	int32_t fns[ART_PROF_DEPTH];
+} art_prof_slot;
+
+/* Filled in by the generated code */
+static const char * art_prof_src;
+static const char * const * art_prof_names;
+static int32_t art_prof_nfns;
+
+static const char * art_prof_out = "aprof";
+/* The innermost frames of the shadow stack, as a ring */
+static volatile int32_t art_prof_fns[ART_PROF_DEPTH];
+static volatile int32_t art_prof_top;
+static volatile int32_t art_prof_line;
+static art_prof_slot art_prof_slots[ART_PROF_SLOTS];
+static volatile uint32_t art_prof_total;
+static volatile uint32_t art_prof_dropped;
+
+/* Returns the caller's line, which the callee hands back
+   to art_prof_leave */
+static inline int32_t art_prof_enter(int32_t fn){
+	int32_t saved = art_prof_line;
+	art_prof_fns[art_prof_top % ART_PROF_DEPTH] = fn;
+	art_prof_top = art_prof_top + 1;
+	return saved;
+}
+
+static inline void art_prof_leave(int32_t saved){
+	art_prof_top = art_prof_top - 1;
+	art_prof_line = saved;
+}
+
+static void art_prof_tick(int sig){
+	int32_t top = art_prof_top;
+	int32_t depth = top < ART_PROF_DEPTH ? top : ART_PROF_DEPTH;
+	int32_t line = art_prof_line;
+	int32_t fns[ART_PROF_DEPTH];
+	uint32_t h = 2166136261u ^ (uint32_t)line;
+	uint32_t probe;
+	int32_t i;
+	(void)sig;
+	/* Outermost first */
+	for (i = 0; i < depth; i++){
+		fns[i] = art_prof_fns[(top - depth + i) % ART_PROF_DEPTH];
+		h = (h ^ (uint32_t)fns[i]) * 16777619u;
+	}
+	for (probe = 0; probe < ART_PROF_SLOTS; probe++){
+		art_prof_slot * slot
+		  = &art_prof_slots[(h + probe) & (ART_PROF_SLOTS - 1)];
+		if (slot->count == 0){
+			slot->line = line;
+			slot->depth = depth;
+			memcpy(slot->fns, fns, sizeof(int32_t) * (size_t)depth);
+			slot->count = 1;
+			art_prof_total = art_prof_total + 1;
+			return;
+		}
+		if (slot->line == line && slot->depth == depth
+		  && memcmp(slot->fns, fns, sizeof(int32_t) * (size_t)depth) == 0){
+			slot->count++;
+			art_prof_total = art_prof_total + 1;
+			return;
+		}
+	}
+	art_prof_dropped = art_prof_dropped + 1;
+}
+
+static void art_prof_start(int argc, char ** argv){
+	struct sigaction action;
+	struct itimerval timer;
+	int i;
+	for (i = 1; i + 1 < argc; i++){
+		if (strcmp(argv[i], "--prof") == 0){ art_prof_out = argv[i + 1]; }
+	}
+	memset(&action, 0, sizeof action);
+	action.sa_handler = art_prof_tick;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGPROF, &action, NULL);
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = 1000;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+static const char * art_prof_name(int32_t fn){
+	if (fn < 0 || fn >= art_prof_nfns){ return "[outside functions]"; }
+	return art_prof_names[fn];
+}
+
+/* The call tree is only built at exit, from the sample table */
+typedef struct {
+	int32_t fn;
+	uint32_t count;
+	int32_t child;
+	int32_t sibling;
+} art_prof_node;
+
+static art_prof_node * art_prof_tree;
+static int32_t art_prof_tree_len;
+
+static int32_t art_prof_child(int32_t parent, int32_t fn){
+	int32_t n;
+	for (n = art_prof_tree[parent].child; n >= 0; n = art_prof_tree[n].sibling){
+		if (art_prof_tree[n].fn == fn){ return n; }
+	}
+	n = art_prof_tree_len++;
+	art_prof_tree[n].fn = fn;
+	art_prof_tree[n].count = 0;
+	art_prof_tree[n].child = -1;
+	art_prof_tree[n].sibling = art_prof_tree[parent].child;
+	art_prof_tree[parent].child = n;
+	return n;
+}
+
+static void art_prof_print_tree(FILE * out, int32_t n, int indent){
+	int32_t c;
+	int32_t best;
+	if (n != 0){
+		fprintf(out, "%*s%6.2f%%  %s\n", indent * 2, "",
+		  100.0 * art_prof_tree[n].count / art_prof_total,
+		  art_prof_name(art_prof_tree[n].fn));
+		indent++;
+	}
+	/* Children, heaviest first. Printed ones are zeroed. */
+	for (;;){
+		best = -1;
+		for (c = art_prof_tree[n].child; c >= 0; c = art_prof_tree[c].sibling){
+			if (art_prof_tree[c].count > 0 && (best < 0
+			  || art_prof_tree[c].count > art_prof_tree[best].count)){
+				best = c;
+			}
+		}
+		if (best < 0){ break; }
+		art_prof_print_tree(out, best, indent);
+		art_prof_tree[best].count = 0;
+	}
+}
+
+static void art_prof_report(void){
+	struct itimerval off;
+	char path[4096];
+	FILE * out;
+	uint32_t * self;
+	uint32_t * total;
+	uint32_t * lines;
+	int32_t maxLine = 0;
+	int32_t s;
+	int32_t i;
+	int32_t j;
+	int32_t best;
+	int32_t used = 0;
+	memset(&off, 0, sizeof off);
+	setitimer(ITIMER_PROF, &off, NULL);
+	if (art_prof_total == 0){ return; }
+
+	/* Index art_prof_nfns collects samples outside any function */
+	self = calloc((size_t)art_prof_nfns + 1, sizeof(uint32_t));
+	total = calloc((size_t)art_prof_nfns + 1, sizeof(uint32_t));
+	for (s = 0; s < ART_PROF_SLOTS; s++){
+		if (art_prof_slots[s].count == 0){ continue; }
+		used++;
+		if (art_prof_slots[s].line > maxLine){ maxLine = art_prof_slots[s].line; }
+	}
+	lines = calloc((size_t)maxLine + 1, sizeof(uint32_t));
+	art_prof_tree = calloc((size_t)used * ART_PROF_DEPTH + 1,
+	  sizeof(art_prof_node));
+	if (self == NULL || total == NULL || lines == NULL || art_prof_tree == NULL){
+		return;
+	}
+	art_prof_tree[0].fn = -1;
+	art_prof_tree[0].child = -1;
+	art_prof_tree_len = 1;
+
+	snprintf(path, sizeof path, "%s.folded", art_prof_out);
+	out = fopen(path, "w");
+	for (s = 0; s < ART_PROF_SLOTS; s++){
+		art_prof_slot * slot = &art_prof_slots[s];
+		int32_t node = 0;
+		if (slot->count == 0){ continue; }
+		lines[slot->line] += slot->count;
+		if (slot->depth == 0){
+			self[art_prof_nfns] += slot->count;
+			total[art_prof_nfns] += slot->count;
+		} else {
+			self[slot->fns[slot->depth - 1]] += slot->count;
+		}
+		for (i = 0; i < slot->depth; i++){
+			/* Count a recursive function once per sample */
+			for (j = 0; j < i && slot->fns[j] != slot->fns[i]; j++){ }
+			if (j == i){ total[slot->fns[i]] += slot->count; }
+			node = art_prof_child(node, slot->fns[i]);
+			art_prof_tree[node].count += slot->count;
+		}
+		if (out != NULL){
+			if (slot->depth == ART_PROF_DEPTH){ fputs("...;", out); }
+			for (i = 0; i < slot->depth; i++){
+				fprintf(out, "%s;", art_prof_name(slot->fns[i]));
+			}
+			if (slot->depth == 0){ fputs("[outside functions];", out); }
+			fprintf(out, "%s:%ld %lu\n", art_prof_src, (long)slot->line,
+			  (unsigned long)slot->count);
+		}
+	}
+	if (out != NULL){ fclose(out); }
+
+	snprintf(path, sizeof path, "%s.txt", art_prof_out);
+	out = fopen(path, "w");
+	if (out == NULL){ return; }
+	fprintf(out, "%lu samples of 1ms of CPU time",
+	  (unsigned long)art_prof_total);
+	if (art_prof_dropped > 0){
+		fprintf(out, " (and %lu dropped, the sample table was full)",
+		  (unsigned long)art_prof_dropped);
+	}
+	fprintf(out, "\n\nFunctions\n   self%%   total%%  name\n");
+	for (;;){
+		best = -1;
+		for (j = 0; j <= art_prof_nfns; j++){
+			if (total[j] > 0 && (best < 0 || self[j] > self[best]
+			  || (self[j] == self[best] && total[j] > total[best]))){
+				best = j;
+			}
+		}
+		if (best < 0){ break; }
+		fprintf(out, "%6.2f%%  %6.2f%%  %s\n",
+		  100.0 * self[best] / art_prof_total,
+		  100.0 * total[best] / art_prof_total, art_prof_name(best));
+		total[best] = 0;
+	}
+	fprintf(out, "\nLines\n   self%%  line\n");
+	for (;;){
+		best = -1;
+		for (j = 0; j <= maxLine; j++){
+			if (lines[j] > 0 && (best < 0 || lines[j] > lines[best])){ best = j; }
+		}
+		if (best < 0){ break; }
+		fprintf(out, "%6.2f%%  %s:%ld\n", 100.0 * lines[best] / art_prof_total,
+		  art_prof_src, (long)best);
+		lines[best] = 0;
+	}
+	fprintf(out, "\nCall tree\n");
+	art_prof_print_tree(out, 0, 0);
+	fclose(out);
+}
+
+)ART";
+
+/*
+Counters for profile-guided builds (ac -I). Each branch, call
+site and field has a slot; at exit the slots are written as
+"key count" lines for ac -F to read back.
+*/
+static const char * const countsSrc = R"ART(#define ART_COUNTS 1
+
+/* Filled in by the generated code */
+static uint64_t * art_counts;
+static const char * const * art_count_keys;
+static int32_t art_count_nkeys;
+
+static const char * art_counts_out = "aprof.counts";
+
+/* A branch owns two slots: taken, then not taken */
+static inline art_bool art_count_branch(art_bool cond, int32_t slot){
+	art_counts[cond ? slot : slot + 1]++;
+	return cond;
+}
+
+/* Count a use of a field and pass its address through. A call
+   (unlike a bare ++) is sequenced, so x = x + 1 is defined. */
+static inline void * art_count_use(int32_t slot, void * field){
+	art_counts[slot]++;
+	return field;
+}
+
+static void art_counts_start(int argc, char ** argv){
+	int i;
+	for (i = 1; i + 1 < argc; i++){
+		if (strcmp(argv[i], "--counts") == 0){ art_counts_out = argv[i + 1]; }
+	}
+}
+
+static void art_counts_report(void){
+	FILE * out = fopen(art_counts_out, "w");
+	int32_t i;
+	if (out == NULL){ return; }
+	for (i = 0; i < art_count_nkeys; i++){
+		fprintf(out, "%s %llu\n", art_count_keys[i],
+		  (unsigned long long)art_counts[i]);
+	}
+	fclose(out);
+}
+
+)ART";
+
+static const char * const runtimeTail = R"ART(static void art_fail(const char * msg){
+	art_flush();
+#ifdef ART_PROFILE
+	art_prof_report();
+#endif
+#ifdef ART_COUNTS
+	art_counts_report();
+#endif
+	fprintf(stderr, "%s\n", msg);
+	exit(1);
+}
+
+static inline art_int art_add(art_int a, art_int b){
+	return (art_int)((uint32_t)a + (uint32_t)b);
+}
+
+static inline art_int art_sub(art_int a, art_int b){
+	return (art_int)((uint32_t)a - (uint32_t)b);
+}
+
+static inline art_int art_mul(art_int a, art_int b){
+	return (art_int)((uint32_t)a * (uint32_t)b);
+}
+
+static inline art_int art_neg(art_int a){
+	return (art_int)(0u - (uint32_t)a);
+}
+
+static inline art_int art_div(art_int a, art_int b){
+	if (b == 0){ art_fail("Division by zero"); }
+	if (b == -1){ return art_neg(a); }
+	return a / b;
+}
+
+static uint64_t art_rng[4];
+
+static inline uint64_t art_rotl(uint64_t x, int k){
+	return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t art_rand(void){
+	uint64_t result = art_rotl(art_rng[1] * 5, 7) * 9;
+	uint64_t t = art_rng[1] << 17;
+	art_rng[2] ^= art_rng[0];
+	art_rng[3] ^= art_rng[1];
+	art_rng[1] ^= art_rng[2];
+	art_rng[0] ^= art_rng[3];
+	art_rng[2] ^= t;
+	art_rng[3] = art_rotl(art_rng[3], 45);
+	return result;
+}
+
+static void art_seed(uint64_t seed){
+	int i;
+	for (i = 0; i < 4; i++){
+		uint64_t z = (seed += UINT64_C(0x9E3779B97F4A7C15));
+		z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+		z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+		art_rng[i] = z ^ (z >> 31);
+	}
+}
+
+static inline art_bool art_eh(void){
+	return (art_bool)(art_rand() >> 63);
+}
+
+/* Branch-free c ? a : b, for maybe statements whose operands
+   are safe to evaluate unconditionally */
+static inline art_int art_select(art_bool c, art_int a, art_int b){
+	uint32_t mask = 0u - (uint32_t)c;
+	return (art_int)(((uint32_t)a & mask) | ((uint32_t)b & ~mask));
+}
+
+static void art_put_bytes(const char * s, size_t n){
+	if (n > ART_OUT_CAP - art_out_len){
+		art_flush();
+		if (n > ART_OUT_CAP){
+			fwrite(s, 1, n, stdout);
+			return;
+		}
+	}
+	memcpy(art_out + art_out_len, s, n);
+	art_out_len += n;
+}
+
+static inline void art_put_int(art_int v){
+	char digits[12];
+	char * p = digits + sizeof digits;
+	uint32_t u = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+	do {
+		*--p = (char)('0' + u % 10);
+		u /= 10;
+	} while (u != 0);
+	if (v < 0){ *--p = '-'; }
+	art_put_bytes(p, (size_t)(digits + sizeof digits - p));
+}
+
+static inline void art_put_bool(art_bool v){
+	if (v){ art_put_bytes("true", 4); }
+	else { art_put_bytes("false", 5); }
+}
+
+static inline void art_put_str(art_str s){
+	if (s != NULL){ art_put_bytes(s->bytes, s->len); }
+}
+
+/* The next input byte, or -1 at end of input. Only blocks
+   (and so only flushes pending output) when the buffer is
+   empty. */
+static inline int art_in_peek(void){
+	if (art_in_pos == art_in_len){
+		long got;
+		art_flush();
+		got = ART_READ(art_in, ART_IN_CAP);
+		if (got <= 0){ return -1; }
+		art_in_pos = 0;
+		art_in_len = (size_t)got;
+	}
+	return (unsigned char)art_in[art_in_pos];
+}
+
+static void art_in_skip_space(void){
+	int c = art_in_peek();
+	while (c == ' ' || c == '\t' || c == '\n' || c == '\r'){
+		art_in_pos++;
+		c = art_in_peek();
+	}
+}
+
+static inline art_int art_get_int(void){
+	uint32_t v = 0;
+	int neg = 0;
+	int c;
+	art_in_skip_space();
+	c = art_in_peek();
+	if (c == '-' || c == '+'){
+		neg = c == '-';
+		art_in_pos++;
+		c = art_in_peek();
+	}
+	if (c < '0' || c > '9'){
+		art_fail("Expected an int on the console");
+	}
+	while (c >= '0' && c <= '9'){
+		v = v * 10u + (uint32_t)(c - '0');
+		art_in_pos++;
+		c = art_in_peek();
+	}
+	return (art_int)(neg ? 0u - v : v);
+}
+
+static inline art_bool art_get_bool(void){
+	char word[6];
+	size_t n = 0;
+	int c;
+	art_in_skip_space();
+	c = art_in_peek();
+	while (c > ' ' && n < sizeof word - 1){
+		word[n++] = (char)c;
+		art_in_pos++;
+		c = art_in_peek();
+	}
+	word[n] = '\0';
+	if (c <= ' '){
+		if (strcmp(word, "true") == 0 || strcmp(word, "1") == 0){
+			return 1;
+		}
+		if (strcmp(word, "false") == 0 || strcmp(word, "0") == 0){
+			return 0;
+		}
+	}
+	art_fail("Expected a bool on the console");
+	return 0;
+}
+
+static void art_init(int argc, char ** argv){
+	/* time() alone would give programs started in the same
+	   second the same sequence */
+#if defined(__unix__) || defined(__APPLE__)
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32)
+	  ^ ((uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec);
+#else
+	uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32);
+#endif
+	int i;
+	for (i = 1; i + 1 < argc; i++){
+		if (strcmp(argv[i], "--seed") == 0){
+			seed = (uint64_t)strtoull(argv[i + 1], NULL, 0);
+		}
+	}
+	art_seed(seed);
+#ifdef ART_PROFILE
+	art_prof_start(argc, argv);
+#endif
+#ifdef ART_COUNTS
+	art_counts_start(argc, argv);
+#endif
+}
+
+static void art_exit(void){
+	art_flush();
+#ifdef ART_PROFILE
+	art_prof_report();
+#endif
+#ifdef ART_COUNTS
+	art_counts_report();
+#endif
+}
+
+)ART";
+
+void CGen::emitRuntime(std::ostream& out, bool profile, bool count){
+	// Once per program, however many modules include it
+	out << "#ifndef ART_RUNTIME\n#define ART_RUNTIME\n";
+	out << runtimeHead;
+	if (profile){ out << profilerSrc; }
+	if (count){ out << countsSrc; }
+	out << runtimeTail;
+	out << "#endif\n";
+}
+
+} // End namespace a_lang
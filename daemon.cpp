@@ -0,0 +1,254 @@
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "daemon.hpp"
+#include "arena.hpp"
+#include "watch.hpp"
+
+namespace a_lang{
+
+/*
+The compile server. A request is the client's working
+directory followed by its command line, each ending in a NUL,
+after which the client shuts down its side of the connection.
+The reply is a line "<exit code> <stdout length>", then what
+the compiler wrote to stdout, then what it wrote to stderr.
+
+The daemon runs the requests itself, one at a time, so each
+finds the process warm: no exec, dynamic linking or page
+faults on every call. The compiler reports every error by
+returning, and a request parses into an arena of its own that
+is freed when it is done, so the daemon does not grow. If a
+request crashes the daemon anyway, its client gets no reply
+and compiles for itself.
+
+What a request parses is kept for the next, as a watch keeps it
+(see watchedParse): compiling a file again parses only the
+declarations that changed since. The parses of keptFiles files
+are kept, the least recently compiled going first, which bounds
+what the daemon holds. Imported interfaces are read afresh by
+each request, since their declarations are placed at the
+importer's import, and they are small.
+
+Since requests are served one at a time, a client that stalls
+partway through sending one would hold up every client after
+it. The daemon gives a client requestTimeout to send its
+request and to take the reply, and otherwise drops it.
+
+A command line that reads stdin is not sent: the client runs
+it, rather than copying a stream that may be any length. Nor is
+one that runs the program (-r), which may read the console too.
+*/
+
+static bool writeAll(int fd, const std::string& data){
+	size_t done = 0;
+	while (done < data.size()){
+		ssize_t n = write(fd, data.data() + done, data.size() - done);
+		if (n < 0 && errno == EINTR){ continue; }
+		if (n <= 0){ return false; }
+		done += static_cast<size_t>(n);
+	}
+	return true;
+}
+
+static std::string readAll(int fd){
+	std::string data;
+	char buf[65536];
+	for (;;){
+		ssize_t n = read(fd, buf, sizeof buf);
+		if (n < 0 && errno == EINTR){ continue; }
+		if (n <= 0){ return data; }
+		data.append(buf, static_cast<size_t>(n));
+	}
+}
+
+/* How many files' parses are kept between requests */
+static const size_t keptFiles = 64;
+
+/* Seconds a client has to send its request, or take its reply */
+static const int requestTimeout = 5;
+
+/* Read a request: everything until the client shuts down its
+   side. False if that takes longer than requestTimeout, or the
+   connection fails first. */
+static bool readRequest(int fd, std::string& data){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long long deadline = now.tv_sec * 1000LL + now.tv_nsec / 1000000
+	  + requestTimeout * 1000LL;
+	char buf[65536];
+	for (;;){
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long long left = deadline
+		  - (now.tv_sec * 1000LL + now.tv_nsec / 1000000);
+		if (left <= 0){ return false; }
+		struct pollfd ready = { fd, POLLIN, 0 };
+		int polled = poll(&ready, 1, static_cast<int>(left));
+		if (polled < 0 && errno == EINTR){ continue; }
+		if (polled <= 0){ return false; }
+		ssize_t n = read(fd, buf, sizeof buf);
+		if (n < 0 && errno == EINTR){ continue; }
+		if (n < 0){ return false; }
+		if (n == 0){ return true; }
+		data.append(buf, static_cast<size_t>(n));
+	}
+}
+
+static bool socketAddress(const char * path, struct sockaddr_un& addr){
+	memset(&addr, 0, sizeof addr);
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof addr.sun_path){ return false; }
+	strcpy(addr.sun_path, path);
+	return true;
+}
+
+/* Run one request and build the reply */
+static std::string runRequest(const std::string& request,
+  CompileFn compile){
+	std::vector<std::string> fields;
+	size_t start = 0;
+	while (start < request.size()){
+		size_t end = request.find('\0', start);
+		if (end == std::string::npos){ end = request.size(); }
+		fields.push_back(request.substr(start, end - start));
+		start = end + 1;
+	}
+	if (fields.empty()){ return "1 0\nEmpty request\n"; }
+
+	int home = open(".", O_RDONLY | O_DIRECTORY);
+	if (home < 0){ return "1 0\nCannot find the daemon's directory\n"; }
+	std::stringstream out;
+	std::stringstream err;
+	std::streambuf * realOut = std::cout.rdbuf(out.rdbuf());
+	std::streambuf * realErr = std::cerr.rdbuf(err.rdbuf());
+	int code = 1;
+	if (chdir(fields[0].c_str()) != 0){
+		std::cerr << "Bad working directory " << fields[0] << "\n";
+	} else {
+		std::vector<const char *> argv;
+		argv.push_back("ac");
+		for (size_t k = 1; k < fields.size(); k++){
+			argv.push_back(fields[k].c_str());
+		}
+		argv.push_back(nullptr);
+		try {
+			AstArena arena;
+			AstArena::Scope scope(&arena);
+			code = compile(static_cast<int>(argv.size() - 1), argv.data());
+		} catch (std::exception& e){
+			std::cerr << "ac failed: " << e.what() << "\n";
+			code = 1;
+		}
+	}
+	std::cout.rdbuf(realOut);
+	std::cerr.rdbuf(realErr);
+	if (fchdir(home) != 0){
+		// Relative paths in later requests would go astray
+		std::cerr << "Cannot return to the daemon's directory\n";
+		exit(1);
+	}
+	close(home);
+	return std::to_string(code) + " " + std::to_string(out.str().size())
+	  + "\n" + out.str() + err.str();
+}
+
+int serveDaemon(const char * socketPath, CompileFn compile){
+	struct sockaddr_un addr;
+	if (!socketAddress(socketPath, addr)){
+		std::cerr << "Socket path too long: " << socketPath << "\n";
+		return 1;
+	}
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	// A socket file left by an earlier daemon would block bind
+	unlink(socketPath);
+	if (listener < 0
+	  || bind(listener, reinterpret_cast<struct sockaddr *>(&addr),
+	    sizeof addr) != 0
+	  || listen(listener, SOMAXCONN) != 0){
+		std::cerr << "Cannot listen on " << socketPath << ": "
+		  << strerror(errno) << "\n";
+		return 1;
+	}
+
+	// A client that hangs up early must not take the daemon down
+	signal(SIGPIPE, SIG_IGN);
+	keepParses(keptFiles);
+	for (;;){
+		int conn = accept(listener, nullptr, nullptr);
+		if (conn < 0){
+			if (errno == EINTR || errno == ECONNABORTED){ continue; }
+			std::cerr << "accept: " << strerror(errno) << "\n";
+			return 1;
+		}
+		// A reply bigger than the socket's buffer blocks until
+		// the client reads it
+		struct timeval timeout = { requestTimeout, 0 };
+		setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+		std::string request;
+		if (readRequest(conn, request)){
+			writeAll(conn, runRequest(request, compile));
+		}
+		close(conn);
+	}
+}
+
+bool forwardToDaemon(const char * socketPath, int argc,
+  const char ** argv, int& exitCode){
+	for (int k = 0; k < argc; k++){
+		if (strcmp(argv[k], "-") == 0 || strcmp(argv[k], "-r") == 0){
+			return false;
+		}
+		if (strcmp(argv[k], "--") == 0){ break; }
+	}
+	struct sockaddr_un addr;
+	if (!socketAddress(socketPath, addr)){ return false; }
+	int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (conn < 0){ return false; }
+	if (connect(conn, reinterpret_cast<struct sockaddr *>(&addr),
+	  sizeof addr) != 0){
+		close(conn);
+		return false;
+	}
+
+	std::vector<char> cwd(PATH_MAX);
+	if (getcwd(cwd.data(), cwd.size()) == nullptr){
+		close(conn);
+		return false;
+	}
+	std::string request = cwd.data();
+	request += '\0';
+	for (int k = 0; k < argc; k++){
+		request += argv[k];
+		request += '\0';
+	}
+	signal(SIGPIPE, SIG_IGN);
+	bool sent = writeAll(conn, request);
+	shutdown(conn, SHUT_WR);
+	std::string reply = sent ? readAll(conn) : "";
+	close(conn);
+
+	size_t newline = reply.find('\n');
+	if (newline == std::string::npos){ return false; }
+	std::istringstream header(reply.substr(0, newline));
+	size_t outLen = 0;
+	if (!(header >> exitCode >> outLen)){ return false; }
+	std::cout << reply.substr(newline + 1, outLen);
+	std::cerr << reply.substr(newline + 1 + outLen);
+	return true;
+}
+
+}
@@ -0,0 +1,26 @@
+#ifndef A_LANG_DAEMON_HPP
+#define A_LANG_DAEMON_HPP
+
+namespace a_lang{
+
+/** A run of the compiler on a command line, returning the
+ * exit code. It never exits, so one process can run many. **/
+typedef int (*CompileFn)(int argc, const char ** argv);
+
+/** Serve compile requests on the Unix socket at socketPath
+ * until killed, one at a time, in this process, each with an
+ * arena of its own (see arena.hpp) that is freed after it.
+ * What the requests parse is kept between them (see
+ * keepParses). **/
+int serveDaemon(const char * socketPath, CompileFn compile);
+
+/** Forward a command line to the daemon at socketPath, relay
+ * its output and set exitCode. Returns false, having done
+ * nothing, if no daemon is listening, or if the command line
+ * reads stdin ("-" or -r), which the daemon cannot. **/
+bool forwardToDaemon(const char * socketPath, int argc,
+  const char ** argv, int& exitCode);
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 #define TODO(x) throw new ToDoError(CODELOC #x);
 
 #include <iostream>
+#include <vector>
 #include "position.hpp"
 
 namespace a_lang{
@@ -50,10 +51,24 @@ private:
    a specific output format. */
 class Report{
 public:
+	/* An error as collected by a tool (see collector()) */
+	class Diagnostic{
+	public:
+		Diagnostic(const Position * posIn, std::string msgIn)
+		: pos(*posIn), msg(msgIn){ }
+		Position pos;
+		std::string msg;
+	};
+
 	static void fatal(
 		const Position * pos,
 		const char * msg
 	){
+		count()++;
+		if (collector() != nullptr){
+			collector()->push_back(Diagnostic(pos, msg));
+			return;
+		}
 		std::cerr << "FATAL " 
 		<< pos->span()
 		<< ": " 
@@ -66,6 +81,19 @@ public:
 	){
 		fatal(pos,msg.c_str());
 	}
+
+	/* How many errors this thread has reported so far */
+	static size_t& count(){
+		static thread_local size_t reported = 0;
+		return reported;
+	}
+
+	/* While this is set, errors (syntax errors included) on
+	   this thread are added to it instead of being printed */
+	static std::vector<Diagnostic> *& collector(){
+		static thread_local std::vector<Diagnostic> * diagnostics = nullptr;
+		return diagnostics;
+	}
 };
 
 }
@@ -398,26 +398,46 @@ namespace a_lang {
     /// An auxiliary type to compute the largest semantic type.
     union union_type
     {
+      // callExp
+      char dummy1[sizeof (a_lang::CallExpNode *)];
+
+      // classTypeDecl
+      char dummy2[sizeof (a_lang::ClassDefnNode *)];
+
       // decl
-      char dummy1[sizeof (a_lang::DeclNode *)];
+      char dummy3[sizeof (a_lang::DeclNode *)];
+
+      // exp
+      // term
+      char dummy4[sizeof (a_lang::ExpNode *)];
+
+      // fnDecl
+      char dummy5[sizeof (a_lang::FnDeclNode *)];
+
+      // formalDecl
+      char dummy6[sizeof (a_lang::FormalDeclNode *)];
 
       // name
-      char dummy2[sizeof (a_lang::IDNode *)];
+      char dummy7[sizeof (a_lang::IDNode *)];
 
       // ID
-      char dummy3[sizeof (a_lang::IDToken *)];
+      char dummy8[sizeof (a_lang::IDToken *)];
 
       // INTLITERAL
-      char dummy4[sizeof (a_lang::IntLitToken *)];
+      char dummy9[sizeof (a_lang::IntLitToken *)];
 
       // loc
-      char dummy5[sizeof (a_lang::LocNode *)];
+      char dummy10[sizeof (a_lang::LocNode *)];
 
       // program
-      char dummy6[sizeof (a_lang::ProgramNode *)];
+      char dummy11[sizeof (a_lang::ProgramNode *)];
+
+      // blockStmt
+      // stmt
+      char dummy12[sizeof (a_lang::StmtNode *)];
 
       // STRINGLITERAL
-      char dummy7[sizeof (a_lang::StrToken *)];
+      char dummy13[sizeof (a_lang::StrToken *)];
 
       // AND
       // ASSIGN
@@ -437,6 +457,7 @@ namespace a_lang {
       // IF
       // INT
       // IMMUTABLE
+      // IMPORT
       // LCURLY
       // LESS
       // LESSEQ
@@ -461,18 +482,32 @@ namespace a_lang {
       // TRUE
       // VOID
       // WHILE
-      char dummy8[sizeof (a_lang::Token *)];
+      char dummy14[sizeof (a_lang::Token *)];
 
       // type
       // datatype
       // primType
-      char dummy9[sizeof (a_lang::TypeNode *)];
+      char dummy15[sizeof (a_lang::TypeNode *)];
 
       // varDecl
-      char dummy10[sizeof (a_lang::VarDeclNode *)];
+      char dummy16[sizeof (a_lang::VarDeclNode *)];
 
       // globals
-      char dummy11[sizeof (std::list<a_lang::DeclNode *> *)];
+      // classBody
+      char dummy17[sizeof (std::list<a_lang::DeclNode *> *)];
+
+      // actualsList
+      char dummy18[sizeof (std::list<a_lang::ExpNode *> *)];
+
+      // maybeFormals
+      // formalList
+      char dummy19[sizeof (std::list<a_lang::FormalDeclNode *> *)];
+
+      // imports
+      char dummy20[sizeof (std::list<a_lang::ImportNode *> *)];
+
+      // stmtList
+      char dummy21[sizeof (std::list<a_lang::StmtNode *> *)];
     };
 
     /// The size of the largest semantic type.
@@ -536,31 +571,32 @@ namespace a_lang {
     INT = 275,                     // INT
     INTLITERAL = 276,              // INTLITERAL
     IMMUTABLE = 277,               // IMMUTABLE
-    LCURLY = 278,                  // LCURLY
-    LESS = 279,                    // LESS
-    LESSEQ = 280,                  // LESSEQ
-    LPAREN = 281,                  // LPAREN
-    MAYBE = 282,                   // MAYBE
-    MEANS = 283,                   // MEANS
-    NOT = 284,                     // NOT
-    NOTEQUALS = 285,               // NOTEQUALS
-    OR = 286,                      // OR
-    OTHERWISE = 287,               // OTHERWISE
-    CROSS = 288,                   // CROSS
-    POSTDEC = 289,                 // POSTDEC
-    POSTINC = 290,                 // POSTINC
-    RETURN = 291,                  // RETURN
-    RCURLY = 292,                  // RCURLY
-    REF = 293,                     // REF
-    RPAREN = 294,                  // RPAREN
-    SEMICOL = 295,                 // SEMICOL
-    SLASH = 296,                   // SLASH
-    STAR = 297,                    // STAR
-    STRINGLITERAL = 298,           // STRINGLITERAL
-    TOCONSOLE = 299,               // TOCONSOLE
-    TRUE = 300,                    // TRUE
-    VOID = 301,                    // VOID
-    WHILE = 302                    // WHILE
+    IMPORT = 278,                  // IMPORT
+    LCURLY = 279,                  // LCURLY
+    LESS = 280,                    // LESS
+    LESSEQ = 281,                  // LESSEQ
+    LPAREN = 282,                  // LPAREN
+    MAYBE = 283,                   // MAYBE
+    MEANS = 284,                   // MEANS
+    NOT = 285,                     // NOT
+    NOTEQUALS = 286,               // NOTEQUALS
+    OR = 287,                      // OR
+    OTHERWISE = 288,               // OTHERWISE
+    CROSS = 289,                   // CROSS
+    POSTDEC = 290,                 // POSTDEC
+    POSTINC = 291,                 // POSTINC
+    RETURN = 292,                  // RETURN
+    RCURLY = 293,                  // RCURLY
+    REF = 294,                     // REF
+    RPAREN = 295,                  // RPAREN
+    SEMICOL = 296,                 // SEMICOL
+    SLASH = 297,                   // SLASH
+    STAR = 298,                    // STAR
+    STRINGLITERAL = 299,           // STRINGLITERAL
+    TOCONSOLE = 300,               // TOCONSOLE
+    TRUE = 301,                    // TRUE
+    VOID = 302,                    // VOID
+    WHILE = 303                    // WHILE
       };
       /// Backward compatibility alias (Bison 3.6).
       typedef token_kind_type yytokentype;
@@ -577,7 +613,7 @@ namespace a_lang {
     {
       enum symbol_kind_type
       {
-        YYNTOKENS = 48, ///< Number of tokens.
+        YYNTOKENS = 49, ///< Number of tokens.
         S_YYEMPTY = -2,
         S_YYEOF = 0,                             // "end file"
         S_YYerror = 1,                           // error
@@ -602,54 +638,56 @@ namespace a_lang {
         S_INT = 20,                              // INT
         S_INTLITERAL = 21,                       // INTLITERAL
         S_IMMUTABLE = 22,                        // IMMUTABLE
-        S_LCURLY = 23,                           // LCURLY
-        S_LESS = 24,                             // LESS
-        S_LESSEQ = 25,                           // LESSEQ
-        S_LPAREN = 26,                           // LPAREN
-        S_MAYBE = 27,                            // MAYBE
-        S_MEANS = 28,                            // MEANS
-        S_NOT = 29,                              // NOT
-        S_NOTEQUALS = 30,                        // NOTEQUALS
-        S_OR = 31,                               // OR
-        S_OTHERWISE = 32,                        // OTHERWISE
-        S_CROSS = 33,                            // CROSS
-        S_POSTDEC = 34,                          // POSTDEC
-        S_POSTINC = 35,                          // POSTINC
-        S_RETURN = 36,                           // RETURN
-        S_RCURLY = 37,                           // RCURLY
-        S_REF = 38,                              // REF
-        S_RPAREN = 39,                           // RPAREN
-        S_SEMICOL = 40,                          // SEMICOL
-        S_SLASH = 41,                            // SLASH
-        S_STAR = 42,                             // STAR
-        S_STRINGLITERAL = 43,                    // STRINGLITERAL
-        S_TOCONSOLE = 44,                        // TOCONSOLE
-        S_TRUE = 45,                             // TRUE
-        S_VOID = 46,                             // VOID
-        S_WHILE = 47,                            // WHILE
-        S_YYACCEPT = 48,                         // $accept
-        S_program = 49,                          // program
-        S_globals = 50,                          // globals
-        S_decl = 51,                             // decl
-        S_varDecl = 52,                          // varDecl
-        S_type = 53,                             // type
-        S_datatype = 54,                         // datatype
-        S_primType = 55,                         // primType
-        S_classTypeDecl = 56,                    // classTypeDecl
-        S_classBody = 57,                        // classBody
-        S_fnDecl = 58,                           // fnDecl
-        S_maybeFormals = 59,                     // maybeFormals
-        S_formalList = 60,                       // formalList
-        S_formalDecl = 61,                       // formalDecl
-        S_stmtList = 62,                         // stmtList
-        S_blockStmt = 63,                        // blockStmt
-        S_stmt = 64,                             // stmt
-        S_exp = 65,                              // exp
-        S_callExp = 66,                          // callExp
-        S_actualList = 67,                       // actualList
-        S_term = 68,                             // term
-        S_loc = 69,                              // loc
-        S_name = 70                              // name
+        S_IMPORT = 23,                           // IMPORT
+        S_LCURLY = 24,                           // LCURLY
+        S_LESS = 25,                             // LESS
+        S_LESSEQ = 26,                           // LESSEQ
+        S_LPAREN = 27,                           // LPAREN
+        S_MAYBE = 28,                            // MAYBE
+        S_MEANS = 29,                            // MEANS
+        S_NOT = 30,                              // NOT
+        S_NOTEQUALS = 31,                        // NOTEQUALS
+        S_OR = 32,                               // OR
+        S_OTHERWISE = 33,                        // OTHERWISE
+        S_CROSS = 34,                            // CROSS
+        S_POSTDEC = 35,                          // POSTDEC
+        S_POSTINC = 36,                          // POSTINC
+        S_RETURN = 37,                           // RETURN
+        S_RCURLY = 38,                           // RCURLY
+        S_REF = 39,                              // REF
+        S_RPAREN = 40,                           // RPAREN
+        S_SEMICOL = 41,                          // SEMICOL
+        S_SLASH = 42,                            // SLASH
+        S_STAR = 43,                             // STAR
+        S_STRINGLITERAL = 44,                    // STRINGLITERAL
+        S_TOCONSOLE = 45,                        // TOCONSOLE
+        S_TRUE = 46,                             // TRUE
+        S_VOID = 47,                             // VOID
+        S_WHILE = 48,                            // WHILE
+        S_YYACCEPT = 49,                         // $accept
+        S_program = 50,                          // program
+        S_imports = 51,                          // imports
+        S_globals = 52,                          // globals
+        S_decl = 53,                             // decl
+        S_varDecl = 54,                          // varDecl
+        S_type = 55,                             // type
+        S_datatype = 56,                         // datatype
+        S_primType = 57,                         // primType
+        S_classTypeDecl = 58,                    // classTypeDecl
+        S_classBody = 59,                        // classBody
+        S_fnDecl = 60,                           // fnDecl
+        S_maybeFormals = 61,                     // maybeFormals
+        S_formalList = 62,                       // formalList
+        S_formalDecl = 63,                       // formalDecl
+        S_stmtList = 64,                         // stmtList
+        S_blockStmt = 65,                        // blockStmt
+        S_stmt = 66,                             // stmt
+        S_exp = 67,                              // exp
+        S_callExp = 68,                          // callExp
+        S_actualsList = 69,                      // actualsList
+        S_term = 70,                             // term
+        S_loc = 71,                              // loc
+        S_name = 72                              // name
       };
     };
 
@@ -684,10 +722,31 @@ namespace a_lang {
       {
         switch (this->kind ())
     {
+      case symbol_kind::S_callExp: // callExp
+        value.move< a_lang::CallExpNode * > (std::move (that.value));
+        break;
+
+      case symbol_kind::S_classTypeDecl: // classTypeDecl
+        value.move< a_lang::ClassDefnNode * > (std::move (that.value));
+        break;
+
       case symbol_kind::S_decl: // decl
         value.move< a_lang::DeclNode * > (std::move (that.value));
         break;
 
+      case symbol_kind::S_exp: // exp
+      case symbol_kind::S_term: // term
+        value.move< a_lang::ExpNode * > (std::move (that.value));
+        break;
+
+      case symbol_kind::S_fnDecl: // fnDecl
+        value.move< a_lang::FnDeclNode * > (std::move (that.value));
+        break;
+
+      case symbol_kind::S_formalDecl: // formalDecl
+        value.move< a_lang::FormalDeclNode * > (std::move (that.value));
+        break;
+
       case symbol_kind::S_name: // name
         value.move< a_lang::IDNode * > (std::move (that.value));
         break;
@@ -708,6 +767,11 @@ namespace a_lang {
         value.move< a_lang::ProgramNode * > (std::move (that.value));
         break;
 
+      case symbol_kind::S_blockStmt: // blockStmt
+      case symbol_kind::S_stmt: // stmt
+        value.move< a_lang::StmtNode * > (std::move (that.value));
+        break;
+
       case symbol_kind::S_STRINGLITERAL: // STRINGLITERAL
         value.move< a_lang::StrToken * > (std::move (that.value));
         break;
@@ -730,6 +794,7 @@ namespace a_lang {
       case symbol_kind::S_IF: // IF
       case symbol_kind::S_INT: // INT
       case symbol_kind::S_IMMUTABLE: // IMMUTABLE
+      case symbol_kind::S_IMPORT: // IMPORT
       case symbol_kind::S_LCURLY: // LCURLY
       case symbol_kind::S_LESS: // LESS
       case symbol_kind::S_LESSEQ: // LESSEQ
@@ -768,9 +833,27 @@ namespace a_lang {
         break;
 
       case symbol_kind::S_globals: // globals
+      case symbol_kind::S_classBody: // classBody
         value.move< std::list<a_lang::DeclNode *> * > (std::move (that.value));
         break;
 
+      case symbol_kind::S_actualsList: // actualsList
+        value.move< std::list<a_lang::ExpNode *> * > (std::move (that.value));
+        break;
+
+      case symbol_kind::S_maybeFormals: // maybeFormals
+      case symbol_kind::S_formalList: // formalList
+        value.move< std::list<a_lang::FormalDeclNode *> * > (std::move (that.value));
+        break;
+
+      case symbol_kind::S_imports: // imports
+        value.move< std::list<a_lang::ImportNode *> * > (std::move (that.value));
+        break;
+
+      case symbol_kind::S_stmtList: // stmtList
+        value.move< std::list<a_lang::StmtNode *> * > (std::move (that.value));
+        break;
+
       default:
         break;
     }
@@ -792,6 +875,30 @@ namespace a_lang {
       {}
 #endif
 
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, a_lang::CallExpNode *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const a_lang::CallExpNode *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, a_lang::ClassDefnNode *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const a_lang::ClassDefnNode *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
 #if 201103L <= YY_CPLUSPLUS
       basic_symbol (typename Base::kind_type t, a_lang::DeclNode *&& v)
         : Base (t)
@@ -804,6 +911,42 @@ namespace a_lang {
       {}
 #endif
 
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, a_lang::ExpNode *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const a_lang::ExpNode *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, a_lang::FnDeclNode *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const a_lang::FnDeclNode *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, a_lang::FormalDeclNode *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const a_lang::FormalDeclNode *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
 #if 201103L <= YY_CPLUSPLUS
       basic_symbol (typename Base::kind_type t, a_lang::IDNode *&& v)
         : Base (t)
@@ -864,6 +1007,18 @@ namespace a_lang {
       {}
 #endif
 
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, a_lang::StmtNode *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const a_lang::StmtNode *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
 #if 201103L <= YY_CPLUSPLUS
       basic_symbol (typename Base::kind_type t, a_lang::StrToken *&& v)
         : Base (t)
@@ -924,6 +1079,54 @@ namespace a_lang {
       {}
 #endif
 
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, std::list<a_lang::ExpNode *> *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const std::list<a_lang::ExpNode *> *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, std::list<a_lang::FormalDeclNode *> *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const std::list<a_lang::FormalDeclNode *> *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, std::list<a_lang::ImportNode *> *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const std::list<a_lang::ImportNode *> *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
+#if 201103L <= YY_CPLUSPLUS
+      basic_symbol (typename Base::kind_type t, std::list<a_lang::StmtNode *> *&& v)
+        : Base (t)
+        , value (std::move (v))
+      {}
+#else
+      basic_symbol (typename Base::kind_type t, const std::list<a_lang::StmtNode *> *& v)
+        : Base (t)
+        , value (v)
+      {}
+#endif
+
       /// Destroy the symbol.
       ~basic_symbol ()
       {
@@ -948,10 +1151,31 @@ namespace a_lang {
         // Value type destructor.
 switch (yykind)
     {
+      case symbol_kind::S_callExp: // callExp
+        value.template destroy< a_lang::CallExpNode * > ();
+        break;
+
+      case symbol_kind::S_classTypeDecl: // classTypeDecl
+        value.template destroy< a_lang::ClassDefnNode * > ();
+        break;
+
       case symbol_kind::S_decl: // decl
         value.template destroy< a_lang::DeclNode * > ();
         break;
 
+      case symbol_kind::S_exp: // exp
+      case symbol_kind::S_term: // term
+        value.template destroy< a_lang::ExpNode * > ();
+        break;
+
+      case symbol_kind::S_fnDecl: // fnDecl
+        value.template destroy< a_lang::FnDeclNode * > ();
+        break;
+
+      case symbol_kind::S_formalDecl: // formalDecl
+        value.template destroy< a_lang::FormalDeclNode * > ();
+        break;
+
       case symbol_kind::S_name: // name
         value.template destroy< a_lang::IDNode * > ();
         break;
@@ -972,6 +1196,11 @@ switch (yykind)
         value.template destroy< a_lang::ProgramNode * > ();
         break;
 
+      case symbol_kind::S_blockStmt: // blockStmt
+      case symbol_kind::S_stmt: // stmt
+        value.template destroy< a_lang::StmtNode * > ();
+        break;
+
       case symbol_kind::S_STRINGLITERAL: // STRINGLITERAL
         value.template destroy< a_lang::StrToken * > ();
         break;
@@ -994,6 +1223,7 @@ switch (yykind)
       case symbol_kind::S_IF: // IF
       case symbol_kind::S_INT: // INT
       case symbol_kind::S_IMMUTABLE: // IMMUTABLE
+      case symbol_kind::S_IMPORT: // IMPORT
       case symbol_kind::S_LCURLY: // LCURLY
       case symbol_kind::S_LESS: // LESS
       case symbol_kind::S_LESSEQ: // LESSEQ
@@ -1032,9 +1262,27 @@ switch (yykind)
         break;
 
       case symbol_kind::S_globals: // globals
+      case symbol_kind::S_classBody: // classBody
         value.template destroy< std::list<a_lang::DeclNode *> * > ();
         break;
 
+      case symbol_kind::S_actualsList: // actualsList
+        value.template destroy< std::list<a_lang::ExpNode *> * > ();
+        break;
+
+      case symbol_kind::S_maybeFormals: // maybeFormals
+      case symbol_kind::S_formalList: // formalList
+        value.template destroy< std::list<a_lang::FormalDeclNode *> * > ();
+        break;
+
+      case symbol_kind::S_imports: // imports
+        value.template destroy< std::list<a_lang::ImportNode *> * > ();
+        break;
+
+      case symbol_kind::S_stmtList: // stmtList
+        value.template destroy< std::list<a_lang::StmtNode *> * > ();
+        break;
+
       default:
         break;
     }
@@ -1552,6 +1800,21 @@ switch (yykind)
         return symbol_type (token::IMMUTABLE, v);
       }
 #endif
+#if 201103L <= YY_CPLUSPLUS
+      static
+      symbol_type
+      make_IMPORT (a_lang::Token * v)
+      {
+        return symbol_type (token::IMPORT, std::move (v));
+      }
+#else
+      static
+      symbol_type
+      make_IMPORT (const a_lang::Token *& v)
+      {
+        return symbol_type (token::IMPORT, v);
+      }
+#endif
 #if 201103L <= YY_CPLUSPLUS
       static
       symbol_type
@@ -2255,8 +2518,8 @@ switch (yykind)
     /// Constants.
     enum
     {
-      yylast_ = 459,     ///< Last index in yytable_.
-      yynnts_ = 23,  ///< Number of nonterminal symbols.
+      yylast_ = 411,     ///< Last index in yytable_.
+      yynnts_ = 24,  ///< Number of nonterminal symbols.
       yyfinal_ = 3 ///< Termination state number.
     };
 
@@ -2270,7 +2533,7 @@ switch (yykind)
 
 #line 5 "a.yy"
 } // a_lang
-#line 2274 "frontend.hh"
+#line 2537 "frontend.hh"
 
 
 
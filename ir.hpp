@@ -0,0 +1,312 @@
+#ifndef A_LANG_IR_HPP
+#define A_LANG_IR_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+#include "cgen.hpp"
+
+namespace a_lang{
+
+/** A virtual register of an IrFunction, numbered from 0, or
+ * -1 for none. Registers are variables rather than SSA values:
+ * one may be assigned more than once. **/
+typedef int IrReg;
+
+/** What an IrInstr does. Ints are 32 bits and wrap; bools
+ * are ints holding 0 or 1. Addresses and strings are wide (64
+ * bit) registers. **/
+enum class IrOp : int {
+	CONST,  // dst = imm
+	COPY,   // dst = a
+	ADD,    // dst = a + b, and so on for ints
+	SUB,
+	MUL,
+	DIV,    // dst = a / b, truncated; b is never 0 or -1
+	NEG,    // dst = -a
+	NOT,    // dst = !a, for a bool
+	EQ,     // dst = a == b, and so on, for ints or bools
+	NE,
+	LT,
+	LE,
+	GT,
+	GE,
+	ARG,    // dst = argument imm; only before other code
+	SLOT,   // dst = the address of frame slot imm
+	GLOBAL, // dst = the address of global sym
+	STR,    // dst = the handle of string constant imm
+	OFFSET, // dst = address a + imm
+	LOAD,   // dst = the size bytes at a + imm
+	STORE,  // the size bytes at a + imm = b
+	ZERO,   // clear the imm bytes at a
+	MOVE,   // copy the imm bytes at b to a
+	CALL,   // dst = sym(args), or no dst for a void call
+	LABEL,  // label imm is here
+	JUMP,   // go to label imm
+	BRANCH, // go to label imm if a, else to label imm2
+	RET,    // return a, or nothing if a is -1
+};
+
+/** One three-address instruction **/
+class IrInstr{
+public:
+	IrInstr(IrOp opIn) : op(opIn), dst(-1), a(-1), b(-1), imm(0), imm2(0),
+	  size(0){ }
+	/** Whether the instruction ends a basic block **/
+	bool isJump() const {
+		return op == IrOp::JUMP || op == IrOp::BRANCH || op == IrOp::RET;
+	}
+	IrOp op;
+	IrReg dst;
+	IrReg a;
+	IrReg b;
+	int64_t imm;
+	int64_t imm2;
+	/** Bytes loaded or stored: 1 (bool), 4 (int) or 8 **/
+	int size;
+	std::string sym;
+	std::vector<IrReg> args;
+};
+
+/** A block of memory in a function's frame, for an object or a
+ * local whose address is taken **/
+class IrSlot{
+public:
+	IrSlot(int sizeIn, int alignIn) : size(sizeIn), align(alignIn){ }
+	int size;
+	int align;
+};
+
+/** A function in the IR, with its arguments in order: where a
+ * custom object is returned, the address to return it at comes
+ * first, then a method's object, then the parameters. Objects
+ * are passed as the address of a copy the callee may change. **/
+class IrFunction{
+public:
+	IrFunction(std::string nameIn, int paramsIn)
+	: name(nameIn), params(paramsIn), labels(0){ }
+	IrReg newReg(bool isWide){
+		wide.push_back(isWide);
+		return static_cast<IrReg>(wide.size() - 1);
+	}
+	int newLabel(){ return labels++; }
+	int newSlot(int size, int align){
+		slots.push_back(IrSlot(size, align));
+		return static_cast<int>(slots.size() - 1);
+	}
+	IrInstr& add(IrInstr instr){
+		code.push_back(instr);
+		return code.back();
+	}
+	/** The symbol it is called by **/
+	std::string name;
+	int params;
+	/** Whether each register is wide **/
+	std::vector<bool> wide;
+	std::vector<IrSlot> slots;
+	int labels;
+	std::vector<IrInstr> code;
+};
+
+/** A global variable: zeroed storage named sym **/
+class IrGlobal{
+public:
+	IrGlobal(std::string symIn, int sizeIn, int alignIn)
+	: sym(symIn), size(sizeIn), align(alignIn){ }
+	std::string sym;
+	int size;
+	int align;
+};
+
+/** A whole program in the IR. It is entered by calling
+ * "main" with C's argc and argv. **/
+class IrProgram{
+public:
+	std::list<IrFunction> functions;
+	std::vector<IrGlobal> globals;
+	/** The string constants, by number **/
+	std::vector<std::string> strings;
+};
+
+/** The runtime functions that IR code calls. Each is a plain
+ * function of its arguments, as its comment shows. **/
+namespace IrRuntime{
+	/** art_init(argc, argv): read --seed, set up I/O **/
+	extern const char * const init;
+	/** art_exit(): flush output **/
+	extern const char * const exit;
+	/** art_put_int(int), art_put_bool(bool), art_put_str(str) **/
+	extern const char * const putInt;
+	extern const char * const putBool;
+	extern const char * const putStr;
+	/** int art_get_int(), bool art_get_bool() **/
+	extern const char * const getInt;
+	extern const char * const getBool;
+	/** bool art_eh(): a random bool **/
+	extern const char * const eh;
+	/** art_div_zero(): fail with "Division by zero" **/
+	extern const char * const divZero;
+}
+
+/** Where an int, bool, string or address is: in a register, or
+ * in memory at an address plus an offset. size is for memory. **/
+class IrPlace{
+public:
+	IrPlace() : reg(-1), addr(-1), offset(0), type(CType::VOID){ }
+	static IrPlace inReg(IrReg reg, CType type){
+		IrPlace place;
+		place.reg = reg;
+		place.type = type;
+		return place;
+	}
+	static IrPlace inMemory(IrReg addr, int64_t offset, CType type){
+		IrPlace place;
+		place.addr = addr;
+		place.offset = offset;
+		place.type = type;
+		return place;
+	}
+	IrReg reg;
+	IrReg addr;
+	int64_t offset;
+	/** The type of what is there; never a reference **/
+	CType type;
+};
+
+/** The result of an expression. An object is given by its
+ * address, which the consumer copies from if it keeps it. **/
+class IrValue{
+public:
+	IrValue(IrReg regIn, CType typeIn) : reg(regIn), type(typeIn){ }
+	IrReg reg;
+	CType type;
+};
+
+/** Field offsets of a custom type, laid out as C would **/
+class IrLayout{
+public:
+	IrLayout() : size(0), align(1){ }
+	std::map<std::string, int> offsets;
+	int size;
+	int align;
+};
+
+/** \class IrGen
+* State threaded through lowering (see lower.cpp). Types,
+* globals, functions and custom types are resolved by the
+* C backend's CGen, which has already checked the program; the
+* locals of the function being lowered are IrGen's own.
+**/
+class IrGen{
+public:
+	IrGen(CGen * cgen, IrProgram& program, std::string module);
+	CGen * cgen(){ return myCGen; }
+	IrFunction * fn(){ return myFn; }
+	std::string module(){ return myModule; }
+	IrProgram& program(){ return myProgram; }
+
+	/** Start lowering into a new function of the program, or into
+	 * scratch, which is thrown away **/
+	IrFunction * startFn(std::string name, int params, bool scratch);
+	/** Continue lowering into fn until endFn **/
+	void resumeFn(IrFunction * fn){ mySaved.push_back(myFn); myFn = fn; }
+	void endFn();
+	/** The function that initializes globals, run before main **/
+	IrFunction * initFn(){ return myInitFn; }
+
+	/* Emitting instructions into the current function */
+	IrReg constant(int64_t value, bool wide);
+	IrReg unary(IrOp op, IrReg a);
+	IrReg binary(IrOp op, IrReg a, IrReg b);
+	IrReg arg(int index, bool wide);
+	IrReg slot(int size, int align);
+	IrReg global(std::string sym);
+	IrReg offset(IrReg addr, int64_t offset);
+	IrReg load(IrReg addr, int64_t offset, int size, bool wide);
+	void store(IrReg addr, int64_t offset, IrReg value, int size);
+	void zero(IrReg addr, int size);
+	void move(IrReg dst, IrReg src, int size);
+	/** Call sym; resultWide is ignored without a result **/
+	IrReg call(std::string sym, std::vector<IrReg> args, bool result,
+	  bool resultWide);
+	void copy(IrReg dst, IrReg src);
+	void label(int label);
+	void jump(int label);
+	void branch(IrReg cond, int ifTrue, int ifFalse);
+	void ret(IrReg value);
+
+	/* Types */
+	static bool isObject(CType type){
+		return type.kind == CType::CLASS && !type.ref;
+	}
+	/** Whether values of type are held in wide registers **/
+	static bool isWide(CType type){
+		return type.ref || type.kind == CType::STR || isObject(type);
+	}
+	int sizeOf(CType type);
+	int alignOf(CType type);
+	const IrLayout& layout(CClass * cls);
+
+	/* Places and values */
+	IrValue read(IrPlace place);
+	void write(IrPlace place, IrValue value);
+	/** The address of a place in memory. A local in a register
+	 * has none: it is marked as escaping, which only happens
+	 * while the function is lowered to find those locals. **/
+	IrReg addressOf(IrPlace place, LocNode * loc);
+	/** A value bound to a formal (or local, field or result) of
+	 * type formal: a reference binds to the storage of arg, or
+	 * of a temporary, and an object is copied **/
+	IrReg bindArg(ExpNode * arg, CType formal);
+	/** As CGen::emitStorage: the address of exp's storage if it
+	 * has any, setting bound, and otherwise its value **/
+	IrValue lowerStorage(ExpNode * exp, bool& bound);
+
+	/* Locals of the function being lowered */
+	void enterScope();
+	void leaveScope();
+	/** Declare a local: a scalar is in a register unless its
+	 * address is taken, an object in a frame slot, and a
+	 * reference (or object parameter) is the address in reg **/
+	IrPlace declareLocal(std::string name, CType type, IrReg reg);
+	/** Where a variable in scope is: a local, a field of the
+	 * object a method runs on, or a global **/
+	IrPlace lookupVar(IDNode * id);
+	void escape(std::string name){ myEscaped.insert(name); }
+	void clearEscapes(){ myEscaped.clear(); }
+
+	/* The function being lowered */
+	void enterClass(CClass * cls);
+	void leaveClass();
+	CClass * currentClass(){ return myClass; }
+	void setSelf(IrReg self){ mySelf = self; }
+	IrReg self(){ return mySelf; }
+	void setRet(CType type, IrReg addr){ myRetType = type; myRetAddr = addr; }
+	CType retType(){ return myRetType; }
+	IrReg retAddr(){ return myRetAddr; }
+	bool scratch(){ return myScratch; }
+private:
+	CGen * myCGen;
+	IrProgram& myProgram;
+	std::string myModule;
+	IrFunction * myFn;
+	std::vector<IrFunction *> mySaved;
+	IrFunction myScratchFn;
+	bool myScratch;
+	IrFunction * myInitFn;
+	std::map<std::string, IrLayout> myLayouts;
+	std::list<std::map<std::string, IrPlace>> myScopes;
+	std::set<std::string> myEscaped;
+	CClass * myClass;
+	IrReg mySelf;
+	CType myRetType;
+	IrReg myRetAddr;
+};
+
+}
+
+#endif
@@ -0,0 +1,387 @@
+#include <cstring>
+#include <map>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "jit.hpp"
+#include "errors.hpp"
+
+namespace a_lang{
+
+/*
+The JIT (ac -r): the native backend's instructions, encoded as
+machine code into pages of this process rather than written out
+as assembler source, so a program is compiled and run with no
+assembler, linker or temporary file.
+
+Every function is encoded on its own, with jumps to its labels
+resolved as it is. The functions are then laid out one after
+another, followed by a call stub for each runtime function they
+call (see jruntime.cpp), which jumps to its absolute address
+through r11: ac's own code may be too far away for a call's 32
+bit displacement. Data (string constants and globals) follows on
+pages of its own. Calls and references to symbols are patched
+once everything has an address; the code pages are then made
+executable, and no longer writable, before main is called.
+*/
+
+typedef X64Instr I;
+typedef X64Operand O;
+
+static bool fits8(int64_t value){ return value >= -128 && value <= 127; }
+static bool fits32(int64_t value){
+	return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+class X64Encoder{
+public:
+	X64Code run(const std::vector<X64Instr>& code);
+private:
+	void byte(int value){
+		myCode.bytes.push_back(static_cast<uint8_t>(value));
+	}
+	/* value, little endian, in size bytes */
+	void word(int64_t value, int size){
+		for (int k = 0; k < size; k++){
+			byte(static_cast<int>((static_cast<uint64_t>(value) >> (8 * k)) & 0xff));
+		}
+	}
+	void withModRM(std::vector<int> opcode, int size, int reg, bool isReg,
+	  const O& rm, int immSize, int64_t imm);
+	void modrm(std::vector<int> opcode, int size, int reg, const O& rm){
+		withModRM(opcode, size, reg, true, rm, 0, 0);
+	}
+	void withExt(std::vector<int> opcode, int size, int ext, const O& rm,
+	  int immSize = 0, int64_t imm = 0){
+		withModRM(opcode, size, ext, false, rm, immSize, imm);
+	}
+	void plusReg(int opcode, int reg, bool wide);
+	void jump(std::vector<int> opcode, int label);
+	void mov(const X64Instr& instr);
+	void alu(int ext, const X64Instr& instr);
+	void encode(const X64Instr& instr);
+
+	X64Code myCode;
+	std::map<int, size_t> myLabels;
+	/* Where each jump's displacement is, and its label */
+	std::vector<std::pair<size_t, int>> myJumps;
+};
+
+/* opcode, with a ModRM byte holding reg (a register where isReg,
+   else an opcode extension) and the register or memory operand
+   rm, then an immediate of immSize bytes. Byte registers 4 to 7
+   are spl to dil only with a REX prefix. */
+void X64Encoder::withModRM(std::vector<int> opcode, int size, int reg,
+  bool isReg, const O& rm, int immSize, int64_t imm){
+	bool based = rm.kind == O::REG || rm.kind == O::MEM;
+	int rex = 0x40 | (size == 8 ? 8 : 0) | (reg >= 8 ? 4 : 0)
+	  | (based && rm.reg >= 8 ? 1 : 0);
+	bool byteRegs = size == 1 && ((isReg && reg >= 4 && reg < 8)
+	  || (rm.kind == O::REG && rm.reg >= 4 && rm.reg < 8));
+	if (rex != 0x40 || byteRegs){ byte(rex); }
+	for (int op : opcode){ byte(op); }
+
+	int field = (reg & 7) << 3;
+	switch (rm.kind){
+	case O::REG:
+		byte(0xc0 | field | (rm.reg & 7));
+		break;
+	case O::MEM: {
+		int base = rm.reg & 7;
+		if (!fits32(rm.disp)){ throw new InternalError("Displacement too large"); }
+		// rbp and r13 as a base always take a displacement
+		int mod = rm.disp == 0 && base != RBP ? 0 : fits8(rm.disp) ? 1 : 2;
+		byte((mod << 6) | field | base);
+		// As do rsp and r12 an index byte
+		if (base == RSP){ byte(0x24); }
+		if (mod != 0){ word(rm.disp, mod == 1 ? 1 : 4); }
+		break;
+	}
+	case O::SYM:
+		byte(field | 5);
+		myCode.relocs.push_back(X64Reloc(myCode.bytes.size(), 0, rm.sym));
+		word(0, 4);
+		break;
+	default:
+		throw new InternalError("Bad operand");
+	}
+	if (immSize != 0){ word(imm, immSize); }
+}
+
+/* opcode plus a register, as push, pop and movabs are */
+void X64Encoder::plusReg(int opcode, int reg, bool wide){
+	int rex = 0x40 | (wide ? 8 : 0) | (reg >= 8 ? 1 : 0);
+	if (rex != 0x40){ byte(rex); }
+	byte(opcode + (reg & 7));
+}
+
+void X64Encoder::jump(std::vector<int> opcode, int label){
+	for (int op : opcode){ byte(op); }
+	myJumps.push_back(std::make_pair(myCode.bytes.size(), label));
+	word(0, 4);
+}
+
+void X64Encoder::mov(const X64Instr& instr){
+	const O& src = instr.src;
+	const O& dst = instr.dst;
+	int size = instr.size;
+	if (src.kind == O::IMM){
+		if (dst.kind == O::REG && size == 8 && !fits32(src.disp)){
+			plusReg(0xb8, dst.reg, true);
+			word(src.disp, 8);
+		} else if (size == 8 && !fits32(src.disp)){
+			throw new InternalError("Immediate too large");
+		} else {
+			withExt({ size == 1 ? 0xc6 : 0xc7 }, size, 0, dst,
+			  size == 1 ? 1 : 4, src.disp);
+		}
+	} else if (src.kind == O::REG){
+		modrm({ size == 1 ? 0x88 : 0x89 }, size, src.reg, dst);
+	} else if (dst.kind == O::REG){
+		modrm({ size == 1 ? 0x8a : 0x8b }, size, dst.reg, src);
+	} else {
+		throw new InternalError("Bad operands to mov");
+	}
+}
+
+/* add, sub, xor or cmp, whose opcodes are ext * 8 plus the form */
+void X64Encoder::alu(int ext, const X64Instr& instr){
+	const O& src = instr.src;
+	const O& dst = instr.dst;
+	int size = instr.size;
+	bool isByte = size == 1;
+	if (src.kind == O::IMM){
+		if (size == 8 && !fits32(src.disp)){
+			throw new InternalError("Immediate too large");
+		}
+		if (isByte){
+			withExt({ 0x80 }, size, ext, dst, 1, src.disp);
+		} else if (fits8(src.disp)){
+			withExt({ 0x83 }, size, ext, dst, 1, src.disp);
+		} else {
+			withExt({ 0x81 }, size, ext, dst, 4, src.disp);
+		}
+	} else if (src.kind == O::REG){
+		modrm({ ext * 8 + (isByte ? 0 : 1) }, size, src.reg, dst);
+	} else if (dst.kind == O::REG){
+		modrm({ ext * 8 + (isByte ? 2 : 3) }, size, dst.reg, src);
+	} else {
+		throw new InternalError("Bad operands to an arithmetic instruction");
+	}
+}
+
+void X64Encoder::encode(const X64Instr& instr){
+	const O& src = instr.src;
+	const O& dst = instr.dst;
+	int size = instr.size;
+	switch (instr.op){
+	case I::MOV: mov(instr); break;
+	case I::MOVZB:
+		// Only the source is a byte register
+		withModRM({ 0x0f, 0xb6 }, 1, dst.reg, false, src, 0, 0);
+		break;
+	case I::LEA: modrm({ 0x8d }, 8, dst.reg, src); break;
+	case I::ADD: alu(0, instr); break;
+	case I::SUB: alu(5, instr); break;
+	case I::XOR: alu(6, instr); break;
+	case I::CMP: alu(7, instr); break;
+	case I::IMUL:
+		if (src.kind == O::IMM){
+			if (fits8(src.disp)){
+				withModRM({ 0x6b }, size, dst.reg, true, dst, 1, src.disp);
+			} else {
+				withModRM({ 0x69 }, size, dst.reg, true, dst, 4, src.disp);
+			}
+		} else {
+			modrm({ 0x0f, 0xaf }, size, dst.reg, src);
+		}
+		break;
+	case I::TEST:
+		if (src.kind == O::IMM){
+			withExt({ size == 1 ? 0xf6 : 0xf7 }, size, 0, dst,
+			  size == 1 ? 1 : 4, src.disp);
+		} else {
+			modrm({ size == 1 ? 0x84 : 0x85 }, size, src.reg, dst);
+		}
+		break;
+	case I::NEG: withExt({ size == 1 ? 0xf6 : 0xf7 }, size, 3, dst); break;
+	case I::IDIV: withExt({ size == 1 ? 0xf6 : 0xf7 }, size, 7, src); break;
+	case I::CLTD:
+		if (size == 8){ byte(0x48); }
+		byte(0x99);
+		break;
+	case I::SETCC: withExt({ 0x0f, 0x90 + instr.cond }, 1, 0, dst); break;
+	case I::JMP: jump({ 0xe9 }, instr.label); break;
+	case I::JCC: jump({ 0x0f, 0x80 + instr.cond }, instr.label); break;
+	case I::CALL:
+		byte(0xe8);
+		myCode.relocs.push_back(X64Reloc(myCode.bytes.size(), 0, instr.sym));
+		word(0, 4);
+		break;
+	case I::RET: byte(0xc3); break;
+	case I::LEAVE: byte(0xc9); break;
+	case I::PUSH:
+		if (src.kind == O::REG){
+			plusReg(0x50, src.reg, false);
+		} else if (src.kind == O::IMM){
+			if (!fits32(src.disp)){ throw new InternalError("Immediate too large"); }
+			byte(0x68);
+			word(src.disp, 4);
+		} else {
+			// Pushes are 8 bytes without REX.W
+			withExt({ 0xff }, 4, 6, src);
+		}
+		break;
+	case I::POP: plusReg(0x58, dst.reg, false); break;
+	case I::LABEL: myLabels[instr.label] = myCode.bytes.size(); break;
+	}
+}
+
+X64Code X64Encoder::run(const std::vector<X64Instr>& code){
+	for (auto& instr : code){
+		size_t relocs = myCode.relocs.size();
+		encode(instr);
+		// A symbol's displacement is from the instruction's end
+		for (size_t k = relocs; k < myCode.relocs.size(); k++){
+			myCode.relocs[k].end = myCode.bytes.size();
+		}
+	}
+	for (auto& jump : myJumps){
+		auto label = myLabels.find(jump.second);
+		if (label == myLabels.end()){ throw new InternalError("No such label"); }
+		int64_t disp = static_cast<int64_t>(label->second)
+		  - static_cast<int64_t>(jump.first + 4);
+		for (int k = 0; k < 4; k++){
+			myCode.bytes[jump.first + static_cast<size_t>(k)] = static_cast<uint8_t>(
+			  (static_cast<uint64_t>(disp) >> (8 * k)) & 0xff);
+		}
+	}
+	return myCode;
+}
+
+X64Code encodeX64(const std::vector<X64Instr>& code){
+	return X64Encoder().run(code);
+}
+
+static size_t alignUp(size_t value, size_t align){
+	return (value + align - 1) / align * align;
+}
+
+/* Machine code and data laid out, relative to the start of the
+   mapping, which is mapped at base */
+class JitImage{
+public:
+	JitImage() : base(nullptr), codeSize(0), size(0){ }
+	~JitImage(){
+		if (base != nullptr){ munmap(base, size); }
+	}
+	JitImage(const JitImage&) = delete;
+	JitImage& operator=(const JitImage&) = delete;
+	uint8_t * base;
+	size_t codeSize;
+	size_t size;
+	std::vector<uint8_t> code;
+	std::vector<X64Reloc> relocs;
+	std::map<std::string, size_t> syms;
+};
+
+int runJit(const IrProgram& program, const std::vector<std::string>& args){
+	JitImage image;
+	for (auto& fn : program.functions){
+		image.code.resize(alignUp(image.code.size(), 16), 0xcc);
+		size_t start = image.code.size();
+		image.syms[fn.name] = start;
+		X64Code code = encodeX64(compileX64(fn));
+		image.code.insert(image.code.end(), code.bytes.begin(), code.bytes.end());
+		for (auto& reloc : code.relocs){
+			image.relocs.push_back(X64Reloc(start + reloc.at,
+			  start + reloc.end, reloc.sym));
+		}
+	}
+
+	// Data, from the start of the data pages
+	std::map<std::string, size_t> dataSyms;
+	std::vector<std::pair<size_t, std::string>> strings;
+	size_t data = 0;
+	for (size_t k = 0; k < program.strings.size(); k++){
+		dataSyms[x64StringSym(static_cast<int64_t>(k))] = data;
+		strings.push_back(std::make_pair(data + 16, program.strings[k]));
+		data = alignUp(data + 16 + program.strings[k].size(), 8);
+	}
+	for (auto& global : program.globals){
+		data = alignUp(data, static_cast<size_t>(global.align));
+		dataSyms[global.sym] = data;
+		data += static_cast<size_t>(global.size);
+	}
+
+	// A stub for each runtime function called: movabs $addr, %r11;
+	// jmp *%r11
+	for (auto& reloc : image.relocs){
+		if (image.syms.count(reloc.sym) != 0
+		  || dataSyms.count(reloc.sym) != 0){
+			continue;
+		}
+		uintptr_t addr = jitRuntimeSym(reloc.sym);
+		if (addr == 0){
+			std::string msg = "No symbol " + reloc.sym;
+			throw new InternalError(msg.c_str());
+		}
+		image.code.resize(alignUp(image.code.size(), 16), 0xcc);
+		image.syms[reloc.sym] = image.code.size();
+		uint8_t stub[] = { 0x49, 0xbb, 0, 0, 0, 0, 0, 0, 0, 0, 0x41, 0xff, 0xe3 };
+		for (size_t k = 0; k < 8; k++){
+			stub[2 + k] = static_cast<uint8_t>((addr >> (8 * k)) & 0xff);
+		}
+		image.code.insert(image.code.end(), stub, stub + sizeof stub);
+	}
+
+	size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	image.codeSize = alignUp(image.code.size(), page);
+	image.size = image.codeSize + alignUp(data, page);
+	void * mapped = mmap(nullptr, image.size, PROT_READ | PROT_WRITE,
+	  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapped == MAP_FAILED){ throw new InternalError("Cannot map JIT memory"); }
+	image.base = static_cast<uint8_t *>(mapped);
+	memcpy(image.base, image.code.data(), image.code.size());
+	for (auto& sym : dataSyms){
+		image.syms[sym.first] = image.codeSize + sym.second;
+	}
+
+	// Strings are laid out as the native runtime's, and globals
+	// start zeroed, as the mapping is
+	for (auto& str : strings){
+		uint8_t * bytes = image.base + image.codeSize + str.first;
+		memcpy(bytes, str.second.data(), str.second.size());
+		uint32_t hash = 2166136261u;
+		for (char c : str.second){
+			hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+		}
+		uint64_t addr = reinterpret_cast<uintptr_t>(bytes);
+		uint32_t len = static_cast<uint32_t>(str.second.size());
+		memcpy(bytes - 16, &addr, 8);
+		memcpy(bytes - 8, &len, 4);
+		memcpy(bytes - 4, &hash, 4);
+	}
+
+	for (auto& reloc : image.relocs){
+		auto target = image.syms.find(reloc.sym);
+		if (target == image.syms.end()){
+			std::string msg = "No symbol " + reloc.sym;
+			throw new InternalError(msg.c_str());
+		}
+		int64_t disp = static_cast<int64_t>(target->second)
+		  - static_cast<int64_t>(reloc.end);
+		if (!fits32(disp)){ throw new InternalError("JIT image too large"); }
+		int32_t field = static_cast<int32_t>(disp);
+		memcpy(image.base + reloc.at, &field, 4);
+	}
+
+	if (mprotect(image.base, image.codeSize, PROT_READ | PROT_EXEC) != 0){
+		throw new InternalError("Cannot make JIT code executable");
+	}
+	auto entry = image.syms.find("main");
+	if (entry == image.syms.end()){ throw new InternalError("No main function"); }
+	return jitRunMain(reinterpret_cast<uintptr_t>(image.base + entry->second),
+	  args);
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef A_LANG_JIT_HPP
+#define A_LANG_JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+#include "x64.hpp"
+
+namespace a_lang{
+
+/** A 32 bit field at at, to hold the address of sym relative to
+ * the end of its instruction, end **/
+class X64Reloc{
+public:
+	X64Reloc(size_t atIn, size_t endIn, std::string symIn)
+	: at(atIn), end(endIn), sym(symIn){ }
+	size_t at;
+	size_t end;
+	std::string sym;
+};
+
+/** Machine code for a function, with the symbols it refers to
+ * left to be filled in **/
+class X64Code{
+public:
+	std::vector<uint8_t> bytes;
+	std::vector<X64Reloc> relocs;
+};
+
+/** Encode code (as selectX64 makes it) as machine code. Jumps
+ * to its labels are resolved; calls and symbol operands are
+ * left as relocations. **/
+X64Code encodeX64(const std::vector<X64Instr>& code);
+
+/** Compile program to machine code in memory and run it, as its
+ * executable would be run with args (args[0] naming it), without
+ * leaving this process. Returns its exit code. **/
+int runJit(const IrProgram& program, const std::vector<std::string>& args);
+
+/** The address of the JIT runtime's function sym (see
+ * jruntime.cpp), or 0 if there is none **/
+uintptr_t jitRuntimeSym(const std::string& sym);
+
+/** Call the main function of a JIT compiled program at entry
+ * with args, on a fresh runtime, and return its exit code. A
+ * program that fails returns 1 here rather than exiting. **/
+int jitRunMain(uintptr_t entry, const std::vector<std::string>& args);
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include <csetjmp>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <unistd.h>
+#include "jit.hpp"
+
+namespace a_lang{
+
+/*
+The runtime for programs run by the JIT (ac -r): the native
+runtime (see nruntime.cpp) once more, as functions of ac itself
+that JIT code calls through stubs. It behaves as that one does,
+down to the PRNG's sequence for a given --seed, with two
+differences that come of sharing a process with ac. Output goes
+to std::cout and input is read from std::cin a line at a time,
+so each goes wherever ac's does. A program that fails returns
+from jitRunMain rather than exiting, and each run starts with
+the runtime's state afresh, so ac (under --watch, say) can run
+one program after another.
+*/
+
+/* A string, as the native backend lays it out */
+class JitStr{
+public:
+	const char * bytes;
+	uint32_t len;
+	uint32_t hash;
+};
+
+static const size_t outCap = 1 << 16;
+static const size_t inCap = 1 << 16;
+static char outBuf[outCap];
+static size_t outLen;
+static char inBuf[inCap];
+static size_t inPos;
+static size_t inLen;
+static uint64_t rng[4];
+static jmp_buf * failed;
+
+static void flushOut(){
+	if (outLen > 0){
+		std::cout.write(outBuf, static_cast<std::streamsize>(outLen));
+		std::cout.flush();
+		outLen = 0;
+	}
+}
+
+static void putBytes(const char * bytes, size_t len){
+	if (len > outCap - outLen){
+		flushOut();
+		if (len > outCap){
+			std::cout.write(bytes, static_cast<std::streamsize>(len));
+			std::cout.flush();
+			return;
+		}
+	}
+	memcpy(outBuf + outLen, bytes, len);
+	outLen += len;
+}
+
+/* Flush, then report msg and return from jitRunMain with 1 */
+static void fail(const char * msg){
+	flushOut();
+	std::cerr << msg;
+	std::cerr.flush();
+	longjmp(*failed, 1);
+}
+
+/* The next input byte, or -1 at end of input. Only blocks (and
+   so only flushes pending output) when the buffer is empty. */
+static int inPeek(){
+	if (inPos == inLen){
+		flushOut();
+		inPos = 0;
+		inLen = 0;
+		char c;
+		while (inLen < inCap && std::cin.get(c)){
+			inBuf[inLen++] = c;
+			if (c == '\n'){ break; }
+		}
+		if (inLen == 0){ return -1; }
+	}
+	return static_cast<unsigned char>(inBuf[inPos]);
+}
+
+static void inSkipSpace(){
+	for (int c = inPeek(); c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	  c = inPeek()){
+		inPos++;
+	}
+}
+
+static void jitInit(int32_t argc, char ** argv){
+	// As the other runtimes mix it, so that runs started in the
+	// same second differ
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t seed = static_cast<uint64_t>(time(nullptr))
+	  ^ (static_cast<uint64_t>(getpid()) << 32)
+	  ^ (static_cast<uint64_t>(now.tv_sec) * 1000000000u
+	    + static_cast<uint64_t>(now.tv_nsec));
+	for (int32_t k = 1; k + 1 < argc; k++){
+		if (strcmp(argv[k], "--seed") == 0){
+			seed = strtoull(argv[k + 1], nullptr, 0);
+		}
+	}
+	// splitmix64, as the other runtimes seed xoshiro256**
+	for (size_t k = 0; k < 4; k++){
+		seed += 0x9E3779B97F4A7C15ull;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		rng[k] = z ^ (z >> 31);
+	}
+}
+
+static void jitExit(){
+	flushOut();
+}
+
+static void jitPutInt(int32_t value){
+	char digits[16];
+	char * end = digits + sizeof digits;
+	char * start = end;
+	uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value)
+	  : static_cast<uint32_t>(value);
+	do {
+		*--start = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	if (value < 0){ *--start = '-'; }
+	putBytes(start, static_cast<size_t>(end - start));
+}
+
+static void jitPutBool(int32_t value){
+	if (value != 0){
+		putBytes("true", 4);
+	} else {
+		putBytes("false", 5);
+	}
+}
+
+/* The empty string is the null handle */
+static void jitPutStr(const JitStr * str){
+	if (str != nullptr){ putBytes(str->bytes, str->len); }
+}
+
+static int32_t jitGetInt(){
+	inSkipSpace();
+	bool negative = false;
+	int c = inPeek();
+	if (c == '-' || c == '+'){
+		negative = c == '-';
+		inPos++;
+		c = inPeek();
+	}
+	if (c < '0' || c > '9'){ fail("Expected an int on the console\n"); }
+	uint32_t value = 0;
+	for (; c >= '0' && c <= '9'; c = inPeek()){
+		value = value * 10 + static_cast<uint32_t>(c - '0');
+		inPos++;
+	}
+	return static_cast<int32_t>(negative ? 0u - value : value);
+}
+
+static int32_t jitGetBool(){
+	inSkipSpace();
+	char word[5];
+	size_t len = 0;
+	int c = inPeek();
+	for (; c > ' ' && len < sizeof word; c = inPeek()){
+		word[len++] = static_cast<char>(c);
+		inPos++;
+	}
+	if (c <= ' '){
+		if (len == 1 && word[0] == '1'){ return 1; }
+		if (len == 1 && word[0] == '0'){ return 0; }
+		if (len == 4 && memcmp(word, "true", 4) == 0){ return 1; }
+		if (len == 5 && memcmp(word, "false", 5) == 0){ return 0; }
+	}
+	fail("Expected a bool on the console\n");
+	return 0;
+}
+
+/* xoshiro256**; the top bit of each draw is a random bool */
+static int32_t jitEh(){
+	uint64_t mixed = rng[1] * 5;
+	uint64_t result = ((mixed << 7) | (mixed >> 57)) * 9;
+	uint64_t shifted = rng[1] << 17;
+	rng[2] ^= rng[0];
+	rng[3] ^= rng[1];
+	rng[1] ^= rng[2];
+	rng[0] ^= rng[3];
+	rng[2] ^= shifted;
+	rng[3] = (rng[3] << 45) | (rng[3] >> 19);
+	return static_cast<int32_t>(result >> 63);
+}
+
+static void jitDivZero(){
+	fail("Division by zero\n");
+}
+
+uintptr_t jitRuntimeSym(const std::string& sym){
+	if (sym == IrRuntime::init){ return reinterpret_cast<uintptr_t>(&jitInit); }
+	if (sym == IrRuntime::exit){ return reinterpret_cast<uintptr_t>(&jitExit); }
+	if (sym == IrRuntime::putInt){ return reinterpret_cast<uintptr_t>(&jitPutInt); }
+	if (sym == IrRuntime::putBool){ return reinterpret_cast<uintptr_t>(&jitPutBool); }
+	if (sym == IrRuntime::putStr){ return reinterpret_cast<uintptr_t>(&jitPutStr); }
+	if (sym == IrRuntime::getInt){ return reinterpret_cast<uintptr_t>(&jitGetInt); }
+	if (sym == IrRuntime::getBool){ return reinterpret_cast<uintptr_t>(&jitGetBool); }
+	if (sym == IrRuntime::eh){ return reinterpret_cast<uintptr_t>(&jitEh); }
+	if (sym == IrRuntime::divZero){ return reinterpret_cast<uintptr_t>(&jitDivZero); }
+	return 0;
+}
+
+int jitRunMain(uintptr_t entry, const std::vector<std::string>& args){
+	outLen = 0;
+	inPos = 0;
+	inLen = 0;
+	std::cin.clear();
+	std::vector<std::vector<char>> storage;
+	for (auto& arg : args){
+		storage.push_back(std::vector<char>(arg.begin(), arg.end()));
+		storage.back().push_back('\0');
+	}
+	std::vector<char *> argv;
+	for (auto& arg : storage){ argv.push_back(arg.data()); }
+	argv.push_back(nullptr);
+
+	// Nothing between here and fail's longjmp has a destructor
+	// to skip: there are only JIT frames and the runtime's
+	jmp_buf failure;
+	failed = &failure;
+	if (setjmp(failure) != 0){ return 1; }
+	int (*mainFn)(int32_t, char **) =
+	  reinterpret_cast<int (*)(int32_t, char **)>(entry);
+	return mainFn(static_cast<int32_t>(args.size()), argv.data());
+}
+
+}
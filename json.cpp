@@ -0,0 +1,245 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "json.hpp"
+#include "errors.hpp"
+
+namespace a_lang{
+
+static void malformed(const std::string& why){
+	std::string msg = "Malformed JSON: " + why;
+	throw new UserError(msg.c_str());
+}
+
+static void skipSpace(const std::string& text, size_t& at){
+	while (at < text.size() && (text[at] == ' ' || text[at] == '\t'
+	  || text[at] == '\n' || text[at] == '\r')){
+		at++;
+	}
+}
+
+static void expect(const std::string& text, size_t& at, const char * word){
+	for (const char * c = word; *c != '\0'; c++){
+		if (at >= text.size() || text[at] != *c){
+			malformed(std::string("expected ") + word);
+		}
+		at++;
+	}
+}
+
+/* Append code point cp as UTF-8 */
+static void appendUtf8(std::string& out, unsigned long cp){
+	if (cp < 0x80){
+		out += static_cast<char>(cp);
+	} else if (cp < 0x800){
+		out += static_cast<char>(0xC0 | (cp >> 6));
+		out += static_cast<char>(0x80 | (cp & 0x3F));
+	} else if (cp < 0x10000){
+		out += static_cast<char>(0xE0 | (cp >> 12));
+		out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (cp & 0x3F));
+	} else {
+		out += static_cast<char>(0xF0 | (cp >> 18));
+		out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+		out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+}
+
+static unsigned long hex4(const std::string& text, size_t& at){
+	if (at + 4 > text.size()){ malformed("short \\u escape"); }
+	std::string digits = text.substr(at, 4);
+	at += 4;
+	char * end = nullptr;
+	unsigned long cp = strtoul(digits.c_str(), &end, 16);
+	if (*end != '\0'){ malformed("bad \\u escape"); }
+	return cp;
+}
+
+static std::string parseString(const std::string& text, size_t& at){
+	expect(text, at, "\"");
+	std::string out;
+	for (;;){
+		if (at >= text.size()){ malformed("unterminated string"); }
+		char c = text[at++];
+		if (c == '"'){ return out; }
+		if (c != '\\'){
+			out += c;
+			continue;
+		}
+		if (at >= text.size()){ malformed("unterminated string"); }
+		c = text[at++];
+		switch (c){
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u': {
+			unsigned long cp = hex4(text, at);
+			// A surrogate pair spells one code point
+			if (cp >= 0xD800 && cp < 0xDC00 && at + 1 < text.size()
+			  && text[at] == '\\' && text[at + 1] == 'u'){
+				at += 2;
+				unsigned long low = hex4(text, at);
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+			}
+			appendUtf8(out, cp);
+			break;
+		}
+		default: out += c;
+		}
+	}
+}
+
+static Json parseValue(const std::string& text, size_t& at){
+	skipSpace(text, at);
+	if (at >= text.size()){ malformed("unexpected end"); }
+	char c = text[at];
+	if (c == '{'){
+		Json obj = Json::object();
+		at++;
+		skipSpace(text, at);
+		if (at < text.size() && text[at] == '}'){
+			at++;
+			return obj;
+		}
+		for (;;){
+			skipSpace(text, at);
+			std::string key = parseString(text, at);
+			skipSpace(text, at);
+			expect(text, at, ":");
+			obj.set(key, parseValue(text, at));
+			skipSpace(text, at);
+			if (at < text.size() && text[at] == ','){
+				at++;
+				continue;
+			}
+			expect(text, at, "}");
+			return obj;
+		}
+	}
+	if (c == '['){
+		Json arr = Json::array();
+		at++;
+		skipSpace(text, at);
+		if (at < text.size() && text[at] == ']'){
+			at++;
+			return arr;
+		}
+		for (;;){
+			arr.push(parseValue(text, at));
+			skipSpace(text, at);
+			if (at < text.size() && text[at] == ','){
+				at++;
+				continue;
+			}
+			expect(text, at, "]");
+			return arr;
+		}
+	}
+	if (c == '"'){ return Json(parseString(text, at)); }
+	if (c == 't'){
+		expect(text, at, "true");
+		return Json(true);
+	}
+	if (c == 'f'){
+		expect(text, at, "false");
+		return Json(false);
+	}
+	if (c == 'n'){
+		expect(text, at, "null");
+		return Json();
+	}
+	const char * start = text.c_str() + at;
+	char * end = nullptr;
+	double num = strtod(start, &end);
+	if (end == start){ malformed("unexpected character"); }
+	at += static_cast<size_t>(end - start);
+	Json result;
+	result.kind = Json::NUM;
+	result.num = num;
+	return result;
+}
+
+Json Json::parse(const std::string& text){
+	size_t at = 0;
+	Json result = parseValue(text, at);
+	skipSpace(text, at);
+	if (at != text.size()){ malformed("trailing characters"); }
+	return result;
+}
+
+static std::string quote(const std::string& str){
+	std::string out = "\"";
+	for (char c : str){
+		if (c == '"'){ out += "\\\""; }
+		else if (c == '\\'){ out += "\\\\"; }
+		else if (c == '\n'){ out += "\\n"; }
+		else if (c == '\r'){ out += "\\r"; }
+		else if (c == '\t'){ out += "\\t"; }
+		else if (static_cast<unsigned char>(c) < 0x20){
+			char buf[8];
+			snprintf(buf, sizeof buf, "\\u%04x",
+			  static_cast<unsigned>(static_cast<unsigned char>(c)));
+			out += buf;
+		} else {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+std::string Json::write() const{
+	switch (kind){
+	case NUL: return "null";
+	case BOOL: return b ? "true" : "false";
+	case NUM: {
+		if (num == std::floor(num) && std::fabs(num) < 1e15){
+			return std::to_string(static_cast<long long>(num));
+		}
+		char buf[32];
+		snprintf(buf, sizeof buf, "%.17g", num);
+		return buf;
+	}
+	case STR: return quote(str);
+	case ARR: {
+		std::string out = "[";
+		for (size_t i = 0; i < items.size(); i++){
+			if (i > 0){ out += ","; }
+			out += items[i].write();
+		}
+		return out + "]";
+	}
+	case OBJ: {
+		std::string out = "{";
+		bool first = true;
+		for (auto& member : members){
+			if (!first){ out += ","; }
+			first = false;
+			out += quote(member.first) + ":" + member.second.write();
+		}
+		return out + "}";
+	}
+	}
+	return "null";
+}
+
+const Json& Json::operator[](const std::string& key) const{
+	static const Json none;
+	auto found = members.find(key);
+	if (found == members.end()){ return none; }
+	return found->second;
+}
+
+Json& Json::set(const std::string& key, Json value){
+	members[key] = value;
+	return *this;
+}
+
+Json& Json::push(Json value){
+	items.push_back(value);
+	return *this;
+}
+
+}
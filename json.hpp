@@ -0,0 +1,51 @@
+#ifndef A_LANG_JSON_HPP
+#define A_LANG_JSON_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace a_lang{
+
+/** Just enough JSON for the language server's JSON-RPC.
+ * Numbers are kept as doubles, which covers the integer ids
+ * and positions that LSP sends.
+**/
+class Json{
+public:
+	enum Kind { NUL, BOOL, NUM, STR, ARR, OBJ };
+	Json() : kind(NUL), b(false), num(0){ }
+	Json(bool bIn) : kind(BOOL), b(bIn), num(0){ }
+	Json(int numIn) : kind(NUM), b(false), num(numIn){ }
+	Json(size_t numIn)
+	: kind(NUM), b(false), num(static_cast<double>(numIn)){ }
+	Json(const char * strIn) : kind(STR), b(false), num(0), str(strIn){ }
+	Json(std::string strIn) : kind(STR), b(false), num(0), str(strIn){ }
+	static Json array(){ Json a; a.kind = ARR; return a; }
+	static Json object(){ Json o; o.kind = OBJ; return o; }
+
+	/** Parse text, throwing a UserError if it is not JSON **/
+	static Json parse(const std::string& text);
+	std::string write() const;
+
+	/** A member of an object, or null if there is none **/
+	const Json& operator[](const std::string& key) const;
+	/** Set a member of an object **/
+	Json& set(const std::string& key, Json value);
+	/** Append to an array **/
+	Json& push(Json value);
+
+	bool isNull() const { return kind == NUL; }
+	int asInt() const { return static_cast<int>(num); }
+
+	Kind kind;
+	bool b;
+	double num;
+	std::string str;
+	std::vector<Json> items;
+	std::map<std::string, Json> members;
+};
+
+}
+
+#endif
@@ -0,0 +1,901 @@
+#include <algorithm>
+#include <sstream>
+#include "ir.hpp"
+
+namespace a_lang{
+
+/*
+Lowering to the IR of the native backend. As in cgen.cpp, the
+functions here are grouped by purpose: every lower method lives
+in this file. The C backend checks the program first and
+resolves the names of globals, functions and custom types, so
+lowering itself finds no user errors.
+
+Scalar locals live in registers. A local whose address is taken
+(to bind a reference) lives in the frame instead, which is only
+known once the whole body has been seen; so, as in the C
+backend, each function is lowered twice, first into scratch to
+find those locals.
+*/
+
+namespace IrRuntime{
+	const char * const init = "art_init";
+	const char * const exit = "art_exit";
+	const char * const putInt = "art_put_int";
+	const char * const putBool = "art_put_bool";
+	const char * const putStr = "art_put_str";
+	const char * const getInt = "art_get_int";
+	const char * const getBool = "art_get_bool";
+	const char * const eh = "art_eh";
+	const char * const divZero = "art_div_zero";
+}
+
+/** IrGen **/
+
+IrGen::IrGen(CGen * cgen, IrProgram& program, std::string module)
+: myCGen(cgen), myProgram(program), myModule(module), myFn(nullptr),
+  myScratchFn("", 0), myScratch(false), myClass(nullptr), mySelf(-1),
+  myRetType(CType::VOID), myRetAddr(-1){
+	myProgram.functions.emplace_back(cgen->moduleSym("art_init_globals"), 0);
+	myInitFn = &myProgram.functions.back();
+}
+
+IrFunction * IrGen::startFn(std::string name, int params, bool scratch){
+	mySaved.push_back(myFn);
+	if (scratch){
+		myScratchFn = IrFunction(name, params);
+		myFn = &myScratchFn;
+	} else {
+		myProgram.functions.emplace_back(name, params);
+		myFn = &myProgram.functions.back();
+	}
+	myScratch = scratch;
+	return myFn;
+}
+
+void IrGen::endFn(){
+	myFn = mySaved.back();
+	mySaved.pop_back();
+	myScratch = myFn == &myScratchFn;
+}
+
+IrReg IrGen::constant(int64_t value, bool wide){
+	IrInstr instr(IrOp::CONST);
+	instr.dst = myFn->newReg(wide);
+	instr.imm = value;
+	return myFn->add(instr).dst;
+}
+
+IrReg IrGen::unary(IrOp op, IrReg a){
+	IrInstr instr(op);
+	instr.dst = myFn->newReg(false);
+	instr.a = a;
+	return myFn->add(instr).dst;
+}
+
+IrReg IrGen::binary(IrOp op, IrReg a, IrReg b){
+	IrInstr instr(op);
+	instr.dst = myFn->newReg(false);
+	instr.a = a;
+	instr.b = b;
+	return myFn->add(instr).dst;
+}
+
+IrReg IrGen::arg(int index, bool wide){
+	IrInstr instr(IrOp::ARG);
+	instr.dst = myFn->newReg(wide);
+	instr.imm = index;
+	return myFn->add(instr).dst;
+}
+
+IrReg IrGen::slot(int size, int align){
+	IrInstr instr(IrOp::SLOT);
+	instr.dst = myFn->newReg(true);
+	instr.imm = myFn->newSlot(size, align);
+	return myFn->add(instr).dst;
+}
+
+IrReg IrGen::global(std::string sym){
+	IrInstr instr(IrOp::GLOBAL);
+	instr.dst = myFn->newReg(true);
+	instr.sym = sym;
+	return myFn->add(instr).dst;
+}
+
+IrReg IrGen::offset(IrReg addr, int64_t offset){
+	if (offset == 0){ return addr; }
+	IrInstr instr(IrOp::OFFSET);
+	instr.dst = myFn->newReg(true);
+	instr.a = addr;
+	instr.imm = offset;
+	return myFn->add(instr).dst;
+}
+
+IrReg IrGen::load(IrReg addr, int64_t offset, int size, bool wide){
+	IrInstr instr(IrOp::LOAD);
+	instr.dst = myFn->newReg(wide);
+	instr.a = addr;
+	instr.imm = offset;
+	instr.size = size;
+	return myFn->add(instr).dst;
+}
+
+void IrGen::store(IrReg addr, int64_t offset, IrReg value, int size){
+	IrInstr instr(IrOp::STORE);
+	instr.a = addr;
+	instr.b = value;
+	instr.imm = offset;
+	instr.size = size;
+	myFn->add(instr);
+}
+
+void IrGen::zero(IrReg addr, int size){
+	IrInstr instr(IrOp::ZERO);
+	instr.a = addr;
+	instr.imm = size;
+	myFn->add(instr);
+}
+
+void IrGen::move(IrReg dst, IrReg src, int size){
+	if (dst == src){ return; }
+	IrInstr instr(IrOp::MOVE);
+	instr.a = dst;
+	instr.b = src;
+	instr.imm = size;
+	myFn->add(instr);
+}
+
+IrReg IrGen::call(std::string sym, std::vector<IrReg> args, bool result,
+  bool resultWide){
+	IrInstr instr(IrOp::CALL);
+	if (result){ instr.dst = myFn->newReg(resultWide); }
+	instr.sym = sym;
+	instr.args = args;
+	return myFn->add(instr).dst;
+}
+
+void IrGen::copy(IrReg dst, IrReg src){
+	if (dst == src){ return; }
+	IrInstr instr(IrOp::COPY);
+	instr.dst = dst;
+	instr.a = src;
+	myFn->add(instr);
+}
+
+void IrGen::label(int label){
+	IrInstr instr(IrOp::LABEL);
+	instr.imm = label;
+	myFn->add(instr);
+}
+
+void IrGen::jump(int label){
+	IrInstr instr(IrOp::JUMP);
+	instr.imm = label;
+	myFn->add(instr);
+}
+
+void IrGen::branch(IrReg cond, int ifTrue, int ifFalse){
+	IrInstr instr(IrOp::BRANCH);
+	instr.a = cond;
+	instr.imm = ifTrue;
+	instr.imm2 = ifFalse;
+	myFn->add(instr);
+}
+
+void IrGen::ret(IrReg value){
+	IrInstr instr(IrOp::RET);
+	instr.a = value;
+	myFn->add(instr);
+}
+
+/* Types are laid out as the C backend's structs are by a C
+   compiler for x86-64 */
+
+int IrGen::sizeOf(CType type){
+	if (type.ref){ return 8; }
+	switch (type.kind){
+	case CType::INT: return 4;
+	case CType::BOOL: return 1;
+	case CType::STR: return 8;
+	case CType::CLASS: return layout(myCGen->lookupClass(nullptr, type)).size;
+	default: throw new InternalError("Size of a void value");
+	}
+}
+
+int IrGen::alignOf(CType type){
+	if (isObject(type)){
+		return layout(myCGen->lookupClass(nullptr, type)).align;
+	}
+	return sizeOf(type);
+}
+
+const IrLayout& IrGen::layout(CClass * cls){
+	std::string key = CGen::structName(cls->module, cls->defn->ID()->getName());
+	auto found = myLayouts.find(key);
+	if (found != myLayouts.end()){ return found->second; }
+	IrLayout layout;
+	for (auto& name : cls->fieldOrder){
+		CType type = cls->fields.find(name)->second;
+		int align = alignOf(type);
+		layout.size = (layout.size + align - 1) / align * align;
+		layout.offsets[name] = layout.size;
+		layout.size += sizeOf(type);
+		layout.align = std::max(layout.align, align);
+	}
+	// As the struct's art_unused, when it has no fields
+	if (layout.size == 0){ layout.size = 1; }
+	layout.size = (layout.size + layout.align - 1) / layout.align
+	  * layout.align;
+	return myLayouts.emplace(key, layout).first->second;
+}
+
+IrValue IrGen::read(IrPlace place){
+	if (place.reg >= 0){ return IrValue(place.reg, place.type); }
+	if (isObject(place.type)){
+		return IrValue(offset(place.addr, place.offset), place.type);
+	}
+	return IrValue(load(place.addr, place.offset, sizeOf(place.type),
+	  isWide(place.type)), place.type);
+}
+
+void IrGen::write(IrPlace place, IrValue value){
+	if (place.reg >= 0){
+		copy(place.reg, value.reg);
+	} else if (isObject(place.type)){
+		move(offset(place.addr, place.offset), value.reg,
+		  sizeOf(place.type));
+	} else {
+		store(place.addr, place.offset, value.reg, sizeOf(place.type));
+	}
+}
+
+IrReg IrGen::addressOf(IrPlace place, LocNode * loc){
+	if (place.reg < 0){ return offset(place.addr, place.offset); }
+	auto id = dynamic_cast<IDNode *>(loc);
+	if (!myScratch || id == nullptr){
+		throw new InternalError("Address of a value in a register");
+	}
+	escape(id->getName());
+	return constant(0, true);
+}
+
+IrReg IrGen::bindArg(ExpNode * arg, CType formal){
+	auto loc = dynamic_cast<LocNode *>(arg);
+	if (formal.ref){
+		bool bound = false;
+		IrValue value = lowerStorage(arg, bound);
+		if (bound){ return value.reg; }
+		// A temporary, as the C backend's compound literal
+		CType base = formal.base();
+		IrReg addr = slot(sizeOf(base), alignOf(base));
+		write(IrPlace::inMemory(addr, 0, base), value);
+		return addr;
+	}
+	IrValue value = arg->lower(this);
+	if (!isObject(formal) || loc == nullptr){ return value.reg; }
+	// A location's object is copied; any other is already fresh
+	IrReg addr = slot(sizeOf(formal), alignOf(formal));
+	move(addr, value.reg, sizeOf(formal));
+	return addr;
+}
+
+IrValue IrGen::lowerStorage(ExpNode * exp, bool& bound){
+	auto call = dynamic_cast<CallExpNode *>(exp);
+	if (call != nullptr){ return call->lowerCall(this, bound); }
+	auto loc = dynamic_cast<LocNode *>(exp);
+	bound = loc != nullptr;
+	if (!bound){ return exp->lower(this); }
+	IrPlace place = loc->lowerPlace(this);
+	return IrValue(addressOf(place, loc), place.type);
+}
+
+void IrGen::enterScope(){
+	myScopes.emplace_front();
+}
+
+void IrGen::leaveScope(){
+	myScopes.pop_front();
+}
+
+IrPlace IrGen::declareLocal(std::string name, CType type, IrReg reg){
+	IrPlace place;
+	if (type.ref){
+		place = IrPlace::inMemory(reg, 0, type.base());
+	} else if (isObject(type)){
+		IrReg addr = reg >= 0 ? reg : slot(sizeOf(type), alignOf(type));
+		place = IrPlace::inMemory(addr, 0, type);
+	} else if (myEscaped.find(name) != myEscaped.end()){
+		place = IrPlace::inMemory(slot(sizeOf(type), alignOf(type)), 0, type);
+		write(place, IrValue(reg, type));
+	} else {
+		// A register of its own, since reg may be another local's
+		place = IrPlace::inReg(myFn->newReg(isWide(type)), type);
+		copy(place.reg, reg);
+	}
+	myScopes.front()[name] = place;
+	return place;
+}
+
+IrPlace IrGen::lookupVar(IDNode * id){
+	std::string name = id->getName();
+	for (auto& scope : myScopes){
+		auto found = scope.find(name);
+		if (found != scope.end()){ return found->second; }
+	}
+	CType type(CType::VOID);
+	IrReg addr;
+	int64_t offset = 0;
+	if (myClass != nullptr
+	  && myClass->fields.find(name) != myClass->fields.end()){
+		type = myClass->fields.find(name)->second;
+		addr = mySelf;
+		offset = layout(myClass).offsets.find(name)->second;
+	} else {
+		CSym sym = myCGen->lookupVar(id);
+		type = sym.type;
+		addr = global(sym.cName);
+	}
+	if (type.ref){
+		return IrPlace::inMemory(load(addr, offset, 8, true), 0, type.base());
+	}
+	return IrPlace::inMemory(addr, offset, type);
+}
+
+void IrGen::enterClass(CClass * cls){
+	myClass = cls;
+	myCGen->enterClass(cls);
+}
+
+void IrGen::leaveClass(){
+	myClass = nullptr;
+	myCGen->leaveClass();
+}
+
+static void lowerBlock(IrGen * gen, std::list<StmtNode *> * body){
+	gen->enterScope();
+	for (auto stmt : *body){ stmt->lower(gen); }
+	gen->leaveScope();
+}
+
+/** Program **/
+
+void ProgramNode::lower(IrProgram& program, const CGenOpts& opts){
+	if (!myImports->empty()){
+		CGen::fail(myImports->front()->pos(),
+		  "The native backend needs a program of one module");
+	}
+	if (opts.profile || opts.count || !opts.feedback.empty()){
+		CGen::fail(myPos, "-P, -I and -F need the C backend");
+	}
+	// The C backend reports whatever is wrong with the program
+	std::stringstream checked;
+	emitC(checked, opts);
+
+	CGen cgen(opts);
+	std::stringstream declared;
+	for (auto global : *myGlobals){
+		global->cDeclare(&cgen, declared);
+	}
+	FnDeclNode * mainFn = cgen.findFn("main");
+	if (mainFn == nullptr){
+		CGen::fail(myPos, "No main function");
+	}
+	IrGen gen(&cgen, program, opts.module);
+	for (auto global : *myGlobals){
+		global->lowerGlobal(&gen);
+	}
+
+	// The entry point, as the C backend's main
+	CType retType = mainFn->getRetTypeNode()->cType(&cgen);
+	gen.startFn("main", 2, false);
+	IrReg argc = gen.arg(0, false);
+	IrReg argv = gen.arg(1, true);
+	gen.call(IrRuntime::init, {argc, argv}, false, false);
+	gen.call(gen.initFn()->name, {}, false, false);
+	IrReg result;
+	if (retType.kind == CType::INT && !retType.ref){
+		result = gen.call(cgen.fnCName("main"), {}, true, false);
+	} else {
+		std::vector<IrReg> args;
+		if (IrGen::isObject(retType)){
+			args.push_back(gen.slot(gen.sizeOf(retType),
+			  gen.alignOf(retType)));
+		}
+		gen.call(cgen.fnCName("main"), args, false, false);
+		result = gen.constant(0, false);
+	}
+	gen.call(IrRuntime::exit, {}, false, false);
+	gen.ret(result);
+	gen.endFn();
+
+	gen.resumeFn(gen.initFn());
+	gen.ret(-1);
+	gen.endFn();
+	for (auto& str : cgen.strings()){ program.strings.push_back(str); }
+}
+
+/** Locations **/
+
+IrValue LocNode::lower(IrGen * gen){
+	return gen->read(lowerPlace(gen));
+}
+
+IrPlace IDNode::lowerPlace(IrGen * gen){
+	return gen->lookupVar(this);
+}
+
+IrPlace MemberFieldExpNode::lowerPlace(IrGen * gen){
+	IrPlace base = myBase->lowerPlace(gen);
+	CClass * cls = gen->cgen()->lookupClass(myPos, base.type);
+	std::string name = myField->getName();
+	CType type = cls->fields.find(name)->second;
+	int64_t offset = base.offset + gen->layout(cls).offsets.find(name)->second;
+	if (type.ref){
+		return IrPlace::inMemory(gen->load(base.addr, offset, 8, true), 0,
+		  type.base());
+	}
+	return IrPlace::inMemory(base.addr, offset, type);
+}
+
+/** Expression Nodes **/
+
+IrValue CallExpNode::lower(IrGen * gen){
+	bool ref = false;
+	IrValue value = lowerCall(gen, ref);
+	if (!ref){ return value; }
+	return gen->read(IrPlace::inMemory(value.reg, 0, value.type));
+}
+
+IrValue CallExpNode::lowerCall(IrGen * gen, bool& ref){
+	FnDeclNode * fn = nullptr;
+	std::string target;
+	IrReg self = -1;
+	auto member = dynamic_cast<MemberFieldExpNode *>(myCallee);
+	auto id = dynamic_cast<IDNode *>(myCallee);
+	if (member != nullptr){
+		IrPlace base = member->getBase()->lowerPlace(gen);
+		CClass * cls = gen->cgen()->lookupClass(member->pos(), base.type);
+		std::string name = member->getField()->getName();
+		fn = cls->methods.find(name)->second;
+		target = CGen::methodName(cls->module, base.type.cls, name);
+		self = gen->addressOf(base, member->getBase());
+	} else if (id != nullptr){
+		bool isMethod = false;
+		fn = gen->cgen()->lookupFn(id, isMethod);
+		if (isMethod){
+			CClass * cls = gen->currentClass();
+			target = CGen::methodName(cls->module,
+			  cls->defn->ID()->getName(), id->getName());
+			self = gen->self();
+		} else {
+			target = gen->cgen()->fnCName(id->getName());
+		}
+	} else {
+		throw new InternalError("Unexpected callee kind");
+	}
+
+	CType retType = fn->getRetTypeNode()->cType(gen->cgen());
+	std::vector<IrReg> args;
+	IrReg result = -1;
+	if (IrGen::isObject(retType)){
+		result = gen->slot(gen->sizeOf(retType), gen->alignOf(retType));
+		args.push_back(result);
+	}
+	if (self >= 0){ args.push_back(self); }
+	auto formal = fn->getFormals()->begin();
+	for (auto arg : *myArgs){
+		args.push_back(gen->bindArg(arg,
+		  (*formal)->getTypeNode()->cType(gen->cgen())));
+		++formal;
+	}
+	if (IrGen::isObject(retType) || retType.kind == CType::VOID){
+		gen->call(target, args, false, false);
+		return IrValue(result, retType);
+	}
+	IrReg value = gen->call(target, args, true, IrGen::isWide(retType));
+	ref = retType.ref;
+	return IrValue(value, retType.base());
+}
+
+IrValue IntLitNode::lower(IrGen * gen){
+	return IrValue(gen->constant(myNum, false), CType(CType::INT));
+}
+
+IrValue StrLitNode::lower(IrGen * gen){
+	int id = gen->cgen()->internString(myStr);
+	if (id < 0){
+		return IrValue(gen->constant(0, true), CType(CType::STR));
+	}
+	IrInstr instr(IrOp::STR);
+	instr.dst = gen->fn()->newReg(true);
+	instr.imm = id;
+	return IrValue(gen->fn()->add(instr).dst, CType(CType::STR));
+}
+
+IrValue TrueNode::lower(IrGen * gen){
+	return IrValue(gen->constant(1, false), CType(CType::BOOL));
+}
+
+IrValue FalseNode::lower(IrGen * gen){
+	return IrValue(gen->constant(0, false), CType(CType::BOOL));
+}
+
+IrValue EhNode::lower(IrGen * gen){
+	return IrValue(gen->call(IrRuntime::eh, {}, true, false),
+	  CType(CType::BOOL));
+}
+
+IrValue BinaryExpNode::lowerArith(IrGen * gen, IrOp op){
+	IrReg a = myExp1->lower(gen).reg;
+	IrReg b = myExp2->lower(gen).reg;
+	return IrValue(gen->binary(op, a, b), CType(CType::INT));
+}
+
+IrValue BinaryExpNode::lowerCompare(IrGen * gen, IrOp op){
+	IrReg a = myExp1->lower(gen).reg;
+	IrReg b = myExp2->lower(gen).reg;
+	return IrValue(gen->binary(op, a, b), CType(CType::BOOL));
+}
+
+IrValue BinaryExpNode::lowerLogic(IrGen * gen, bool isAnd){
+	// The second operand is only evaluated if it decides
+	IrReg result = gen->fn()->newReg(false);
+	int second = gen->fn()->newLabel();
+	int done = gen->fn()->newLabel();
+	gen->copy(result, myExp1->lower(gen).reg);
+	if (isAnd){
+		gen->branch(result, second, done);
+	} else {
+		gen->branch(result, done, second);
+	}
+	gen->label(second);
+	gen->copy(result, myExp2->lower(gen).reg);
+	gen->label(done);
+	return IrValue(result, CType(CType::BOOL));
+}
+
+IrValue PlusNode::lower(IrGen * gen){
+	return lowerArith(gen, IrOp::ADD);
+}
+
+IrValue MinusNode::lower(IrGen * gen){
+	return lowerArith(gen, IrOp::SUB);
+}
+
+IrValue TimesNode::lower(IrGen * gen){
+	return lowerArith(gen, IrOp::MUL);
+}
+
+IrValue DivideNode::lower(IrGen * gen){
+	IrReg a = myExp1->lower(gen).reg;
+	IrReg b = myExp2->lower(gen).reg;
+	// As the runtime's art_div: the hardware faults on 0, and on
+	// -1 with INT_MIN, so neither reaches a DIV
+	if (dynamic_cast<IntLitNode *>(myExp2) != nullptr){
+		CRange divisor = myExp2->cRange(gen->cgen());
+		if (!divisor.contains(0) && !divisor.contains(-1)){
+			return IrValue(gen->binary(IrOp::DIV, a, b), CType(CType::INT));
+		}
+	}
+	IrFunction * fn = gen->fn();
+	IrReg result = fn->newReg(false);
+	int byZero = fn->newLabel();
+	int notZero = fn->newLabel();
+	int negate = fn->newLabel();
+	int divide = fn->newLabel();
+	int done = fn->newLabel();
+	gen->branch(gen->binary(IrOp::EQ, b, gen->constant(0, false)),
+	  byZero, notZero);
+	gen->label(byZero);
+	gen->call(IrRuntime::divZero, {}, false, false);
+	gen->label(notZero);
+	gen->branch(gen->binary(IrOp::EQ, b, gen->constant(-1, false)),
+	  negate, divide);
+	gen->label(negate);
+	gen->copy(result, gen->unary(IrOp::NEG, a));
+	gen->jump(done);
+	gen->label(divide);
+	gen->copy(result, gen->binary(IrOp::DIV, a, b));
+	gen->label(done);
+	return IrValue(result, CType(CType::INT));
+}
+
+IrValue AndNode::lower(IrGen * gen){
+	return lowerLogic(gen, true);
+}
+
+IrValue OrNode::lower(IrGen * gen){
+	return lowerLogic(gen, false);
+}
+
+IrValue EqualsNode::lower(IrGen * gen){
+	return lowerCompare(gen, IrOp::EQ);
+}
+
+IrValue NotEqualsNode::lower(IrGen * gen){
+	return lowerCompare(gen, IrOp::NE);
+}
+
+IrValue LessNode::lower(IrGen * gen){
+	return lowerCompare(gen, IrOp::LT);
+}
+
+IrValue LessEqNode::lower(IrGen * gen){
+	return lowerCompare(gen, IrOp::LE);
+}
+
+IrValue GreaterNode::lower(IrGen * gen){
+	return lowerCompare(gen, IrOp::GT);
+}
+
+IrValue GreaterEqNode::lower(IrGen * gen){
+	return lowerCompare(gen, IrOp::GE);
+}
+
+IrValue NegNode::lower(IrGen * gen){
+	return IrValue(gen->unary(IrOp::NEG, myExp->lower(gen).reg),
+	  CType(CType::INT));
+}
+
+IrValue NotNode::lower(IrGen * gen){
+	return IrValue(gen->unary(IrOp::NOT, myExp->lower(gen).reg),
+	  CType(CType::BOOL));
+}
+
+/** Statement Nodes **/
+
+void AssignStmtNode::lower(IrGen * gen){
+	IrValue value = mySrc->lower(gen);
+	gen->write(myDst->lowerPlace(gen), value);
+}
+
+void CallStmtNode::lower(IrGen * gen){
+	myCallExp->lower(gen);
+}
+
+void ReturnStmtNode::lower(IrGen * gen){
+	if (myExp == nullptr){
+		gen->ret(-1);
+		return;
+	}
+	CType retType = gen->retType();
+	if (IrGen::isObject(retType)){
+		IrValue value = myExp->lower(gen);
+		gen->move(gen->retAddr(), value.reg, gen->sizeOf(retType));
+		gen->ret(gen->retAddr());
+	} else {
+		gen->ret(gen->bindArg(myExp, retType));
+	}
+}
+
+void MaybeStmtNode::lower(IrGen * gen){
+	IrFunction * fn = gen->fn();
+	int first = fn->newLabel();
+	int second = fn->newLabel();
+	int done = fn->newLabel();
+	gen->branch(gen->call(IrRuntime::eh, {}, true, false), first, second);
+	gen->label(first);
+	IrValue value1 = mySrc1->lower(gen);
+	gen->write(myDst->lowerPlace(gen), value1);
+	gen->jump(done);
+	gen->label(second);
+	IrValue value2 = mySrc2->lower(gen);
+	gen->write(myDst->lowerPlace(gen), value2);
+	gen->label(done);
+}
+
+void FromConsoleStmtNode::lower(IrGen * gen){
+	IrPlace dst = myDst->lowerPlace(gen);
+	const char * fn = dst.type.kind == CType::INT ? IrRuntime::getInt
+	  : IrRuntime::getBool;
+	gen->write(dst, IrValue(gen->call(fn, {}, true, false), dst.type));
+}
+
+void ToConsoleStmtNode::lower(IrGen * gen){
+	IrValue value = mySrc->lower(gen);
+	const char * fn = IrRuntime::putStr;
+	if (value.type.kind == CType::INT){ fn = IrRuntime::putInt; }
+	if (value.type.kind == CType::BOOL){ fn = IrRuntime::putBool; }
+	gen->call(fn, {value.reg}, false, false);
+}
+
+void PostDecStmtNode::lower(IrGen * gen){
+	IrPlace place = myLoc->lowerPlace(gen);
+	IrReg value = gen->read(place).reg;
+	gen->write(place, IrValue(gen->binary(IrOp::SUB, value,
+	  gen->constant(1, false)), place.type));
+}
+
+void PostIncStmtNode::lower(IrGen * gen){
+	IrPlace place = myLoc->lowerPlace(gen);
+	IrReg value = gen->read(place).reg;
+	gen->write(place, IrValue(gen->binary(IrOp::ADD, value,
+	  gen->constant(1, false)), place.type));
+}
+
+void IfStmtNode::lower(IrGen * gen){
+	int body = gen->fn()->newLabel();
+	int done = gen->fn()->newLabel();
+	gen->branch(myCond->lower(gen).reg, body, done);
+	gen->label(body);
+	lowerBlock(gen, myBody);
+	gen->label(done);
+}
+
+void IfElseStmtNode::lower(IrGen * gen){
+	int bodyTrue = gen->fn()->newLabel();
+	int bodyFalse = gen->fn()->newLabel();
+	int done = gen->fn()->newLabel();
+	gen->branch(myCond->lower(gen).reg, bodyTrue, bodyFalse);
+	gen->label(bodyTrue);
+	lowerBlock(gen, myBodyTrue);
+	gen->jump(done);
+	gen->label(bodyFalse);
+	lowerBlock(gen, myBodyFalse);
+	gen->label(done);
+}
+
+void WhileStmtNode::lower(IrGen * gen){
+	// The test is at the bottom, so an iteration takes one branch
+	int body = gen->fn()->newLabel();
+	int test = gen->fn()->newLabel();
+	int done = gen->fn()->newLabel();
+	gen->jump(test);
+	gen->label(body);
+	lowerBlock(gen, myBody);
+	gen->label(test);
+	gen->branch(myCond->lower(gen).reg, body, done);
+	gen->label(done);
+}
+
+/** Declaration Nodes **/
+
+void VarDeclNode::lower(IrGen * gen){
+	CType type = myType->cType(gen->cgen());
+	std::string name = myID->getName();
+	// The initializer is lowered before the name is in scope
+	if (type.ref){
+		IrReg addr = myInit == nullptr ? gen->constant(0, true)
+		  : gen->bindArg(myInit, type);
+		gen->declareLocal(name, type, addr);
+	} else if (IrGen::isObject(type)){
+		IrReg init = myInit == nullptr ? -1 : myInit->lower(gen).reg;
+		IrPlace place = gen->declareLocal(name, type, -1);
+		if (init >= 0){
+			gen->write(place, IrValue(init, type));
+		} else {
+			gen->call(CGen::initName(type.module, type.cls), {place.addr},
+			  false, false);
+		}
+	} else {
+		IrReg init = myInit == nullptr
+		  ? gen->constant(0, IrGen::isWide(type)) : myInit->lower(gen).reg;
+		gen->declareLocal(name, type, init);
+	}
+}
+
+void VarDeclNode::lowerGlobal(IrGen * gen){
+	CType type = myType->cType(gen->cgen());
+	std::string sym = CGen::globalName(gen->module(), myID->getName());
+	IrProgram& program = gen->program();
+	int size = type.ref ? 8 : gen->sizeOf(type);
+	int align = type.ref ? 8 : gen->alignOf(type);
+	program.globals.push_back(IrGlobal(sym, size, align));
+
+	// Globals start zeroed; anything more runs before main
+	gen->resumeFn(gen->initFn());
+	IrReg addr = gen->global(sym);
+	if (myInit != nullptr && type.ref){
+		bool bound = false;
+		IrValue init = gen->lowerStorage(myInit, bound);
+		if (bound){
+			gen->store(addr, 0, init.reg, 8);
+		} else {
+			// A cell of its own, as in the C backend
+			CType base = type.base();
+			std::string cell = gen->cgen()->moduleSym("art_cell"
+			  + std::to_string(program.globals.size()));
+			program.globals.push_back(IrGlobal(cell, gen->sizeOf(base),
+			  gen->alignOf(base)));
+			IrReg cellAddr = gen->global(cell);
+			gen->write(IrPlace::inMemory(cellAddr, 0, base), init);
+			gen->store(addr, 0, cellAddr, 8);
+		}
+	} else if (myInit != nullptr){
+		gen->write(IrPlace::inMemory(addr, 0, type), myInit->lower(gen));
+	} else if (IrGen::isObject(type)){
+		gen->call(CGen::initName(type.module, type.cls), {addr}, false, false);
+	}
+	gen->endFn();
+}
+
+void ClassDefnNode::lower(IrGen * gen){
+	throw new InternalError("Class definition in statement position");
+}
+
+void ClassDefnNode::lowerGlobal(IrGen * gen){
+	std::string name = myID->getName();
+	CClass * cls = gen->cgen()->lookupClass(myPos, name);
+	gen->enterClass(cls);
+	const IrLayout& layout = gen->layout(cls);
+
+	// The object is zeroed, then its field initializers run
+	gen->startFn(CGen::initName(cls->module, name), 1, false);
+	IrReg self = gen->arg(0, true);
+	gen->setSelf(self);
+	gen->zero(self, layout.size);
+	for (auto member : *myMembers){
+		auto field = dynamic_cast<VarDeclNode *>(member);
+		if (field == nullptr){ continue; }
+		std::string fieldName = field->ID()->getName();
+		CType type = cls->fields.find(fieldName)->second;
+		int64_t offset = layout.offsets.find(fieldName)->second;
+		if (field->getInit() != nullptr && type.ref){
+			gen->store(self, offset, gen->bindArg(field->getInit(), type), 8);
+		} else if (field->getInit() != nullptr){
+			gen->write(IrPlace::inMemory(self, offset, type),
+			  field->getInit()->lower(gen));
+		} else if (IrGen::isObject(type)){
+			gen->call(CGen::initName(type.module, type.cls),
+			  {gen->offset(self, offset)}, false, false);
+		}
+	}
+	gen->ret(-1);
+	gen->endFn();
+
+	for (auto member : *myMembers){
+		auto method = dynamic_cast<FnDeclNode *>(member);
+		if (method != nullptr){ method->lowerGlobal(gen); }
+	}
+	gen->leaveClass();
+}
+
+void FnDeclNode::lower(IrGen * gen){
+	throw new InternalError("Function definition in statement position");
+}
+
+void FnDeclNode::lowerGlobal(IrGen * gen){
+	CClass * cls = gen->currentClass();
+	std::string name = cls == nullptr
+	  ? gen->cgen()->fnCName(myID->getName())
+	  : CGen::methodName(cls->module, cls->defn->ID()->getName(),
+	  myID->getName());
+	CType retType = myRetType->cType(gen->cgen());
+	bool sret = IrGen::isObject(retType);
+	int params = static_cast<int>(myFormals->size())
+	  + (cls != nullptr ? 1 : 0) + (sret ? 1 : 0);
+
+	gen->clearEscapes();
+	for (int pass = 0; pass < 2; pass++){
+		gen->startFn(name, params, pass == 0);
+		// Every argument is taken before any other code
+		int index = 0;
+		IrReg retAddr = sret ? gen->arg(index++, true) : -1;
+		if (cls != nullptr){ gen->setSelf(gen->arg(index++, true)); }
+		std::vector<IrReg> args;
+		for (auto formal : *myFormals){
+			CType type = formal->getTypeNode()->cType(gen->cgen());
+			args.push_back(gen->arg(index++, IrGen::isWide(type)));
+		}
+		gen->setRet(retType, retAddr);
+		gen->enterScope();
+		auto arg = args.begin();
+		for (auto formal : *myFormals){
+			gen->declareLocal(formal->ID()->getName(),
+			  formal->getTypeNode()->cType(gen->cgen()), *arg++);
+		}
+		lowerBlock(gen, myBody);
+		gen->leaveScope();
+		// Falling off the end returns, with a zero if need be
+		if (retType.kind == CType::VOID){
+			gen->ret(-1);
+		} else if (sret){
+			gen->ret(retAddr);
+		} else {
+			gen->ret(gen->constant(0, IrGen::isWide(retType)));
+		}
+		gen->endFn();
+	}
+}
+
+}
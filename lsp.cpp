@@ -0,0 +1,649 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "lsp.hpp"
+#include "arena.hpp"
+#include "json.hpp"
+#include "module.hpp"
+#include "names.hpp"
+#include "relex.hpp"
+#include "scanner.hpp"
+
+namespace a_lang{
+
+/*
+The language server. Each open document is kept as a list of
+chunks, each a run of whole top-level declarations with the
+lines around them, parsed on its own. The document's tokens are
+kept up to date edit by edit (see relex.hpp), and the chunks are
+re-split from them after each change. Only the chunks whose text
+changed are parsed again.
+
+Names are analyzed chunk by chunk too (see NameIndex). Each
+chunk declares its globals in an index of its own, and the
+document merges them into a NameTable; each chunk's uses are
+resolved against that table in a second index. After a change,
+only the new chunks are analyzed, and the chunks that looked up
+a name whose declaration came or went with them. A chunk that
+only moved has its places moved. The imports are declared again
+only when the chunks that import change or move.
+
+What an update still costs in the whole document is the scan of
+its tokens for chunk boundaries, a comparison of the unchanged
+chunks' text with what they were (to know that they are
+unchanged), and the merge of every chunk's globals into the
+table: a map insertion per top-level name, not a walk of the
+declarations.
+
+A syntax error is confined to its chunk. While any chunk fails
+to parse, the names it declares are unknown, so unresolved
+names are not reported until the whole document parses again.
+
+Each chunk's AST lives in an arena of the chunk's, so it goes
+when no version of the document has that chunk any more. Name
+analysis copies what it keeps out of the ASTs.
+
+LSP counts the characters of a line in UTF-16 code units, and
+ac counts bytes, so columns are converted both ways against the
+document's text.
+
+A document's imports are found relative to the file its URI
+names, and go-to-definition of an imported name answers with
+the place in the module's own file.
+*/
+
+/* Chunks' ASTs and errors count the chunk's first line as 1;
+   their names are placed in the document */
+class LspChunk{
+public:
+	LspChunk(std::string textIn, size_t offsetIn)
+	: text(textIn), imports(nullptr), decls(nullptr), offset(offsetIn){ }
+	/** The declaration named at a place in the document, and
+	 * where that name is, as NameIndex has them **/
+	const NameDecl * lookupAt(size_t line, size_t col) const;
+	const Position * spanAt(size_t line, size_t col) const;
+	std::string text;
+	/** Owns the chunk's AST **/
+	AstArena arena;
+	/** Both nullptr if the chunk did not parse **/
+	std::list<ImportNode *> * imports;
+	std::list<DeclNode *> * decls;
+	std::vector<Report::Diagnostic> errors;
+	/** The globals the chunk declares, and the names used in
+	 * it, resolved against the document's table; both nullptr
+	 * if the chunk did not parse **/
+	std::unique_ptr<NameIndex> declared;
+	std::unique_ptr<NameIndex> analyzed;
+	/** The line offset its names were placed at **/
+	size_t offset;
+};
+
+const NameDecl * LspChunk::lookupAt(size_t line, size_t col) const{
+	if (analyzed == nullptr){ return nullptr; }
+	const NameDecl * found = analyzed->lookupAt(line, col);
+	return found != nullptr ? found : declared->lookupAt(line, col);
+}
+
+const Position * LspChunk::spanAt(size_t line, size_t col) const{
+	if (analyzed == nullptr){ return nullptr; }
+	const Position * found = analyzed->spanAt(line, col);
+	return found != nullptr ? found : declared->spanAt(line, col);
+}
+
+class LspDocument{
+public:
+	LspDocument() : parsed(false){ }
+	/** Bring the chunks and names up to date with lexed **/
+	void update();
+	/** The chunk a line (from 1) is in, or nullptr **/
+	const LspChunk * chunkAt(size_t line) const;
+	/** The file the document's URI names, if it is a file: URI **/
+	std::string path;
+	std::unique_ptr<LexedText> lexed;
+	std::vector<std::shared_ptr<LspChunk>> chunks;
+	/** The line before each chunk's first line **/
+	std::vector<size_t> offsets;
+	/** The globals of the modules imported, and the chunks
+	 * that import them with their offsets at the time **/
+	std::unique_ptr<NameIndex> imported;
+	std::vector<std::pair<const LspChunk *, size_t>> importers;
+	NameTable table;
+	/** Whether every chunk parsed **/
+	bool parsed;
+private:
+	void updateNames();
+};
+
+static std::shared_ptr<LspChunk> parseChunk(const std::string& text,
+  size_t offset){
+	auto chunk = std::make_shared<LspChunk>(text, offset);
+	AstArena::Scope scope(&chunk->arena);
+	std::istringstream in(text);
+	ProgramNode * root = nullptr;
+	std::vector<Report::Diagnostic> * outer = Report::collector();
+	Report::collector() = &chunk->errors;
+	Scanner scanner(&in);
+	Parser parser(scanner, &root);
+	if (parser.parse() == 0 && root != nullptr){
+		chunk->imports = root->getImports();
+		chunk->decls = root->getGlobals();
+		chunk->declared.reset(new NameIndex());
+		chunk->declared->declareGlobals(chunk->decls, offset);
+	}
+	Report::collector() = outer;
+	return chunk;
+}
+
+static bool sameText(const std::string& text, size_t begin, size_t end,
+  const LspChunk& chunk){
+	return chunk.text.size() == end - begin
+	  && text.compare(begin, end - begin, chunk.text) == 0;
+}
+
+void LspDocument::update(){
+	std::vector<size_t> firsts = declFirstLines(*lexed);
+	const std::string& text = lexed->text();
+	size_t count = firsts.size();
+	std::vector<size_t> starts;
+	for (size_t first : firsts){ starts.push_back(lexed->lineStart(first)); }
+	starts.push_back(lexed->lineStart(lexed->lineCount()));
+
+	// The chunks before the first change and after the last are
+	// the old ones in order. Those between are found by text, as
+	// identical text parses identically wherever it has moved to.
+	// Replaced chunks live until the names are up to date, so no
+	// new declaration can take the place of one that went.
+	std::vector<std::shared_ptr<LspChunk>> old;
+	old.swap(chunks);
+	chunks.resize(count);
+	size_t front = 0;
+	while (front < count && front < old.size()
+	  && sameText(text, starts[front], starts[front + 1], *old[front])){
+		chunks[front] = std::move(old[front]);
+		front++;
+	}
+	size_t back = 0;
+	while (back < count - front && back < old.size() - front
+	  && sameText(text, starts[count - back - 1], starts[count - back],
+	  *old[old.size() - back - 1])){
+		chunks[count - back - 1] = std::move(old[old.size() - back - 1]);
+		back++;
+	}
+	std::unordered_multimap<std::string, std::shared_ptr<LspChunk>> moved;
+	for (size_t i = front; i < old.size() - back; i++){
+		std::string key = old[i]->text;
+		moved.emplace(key, std::move(old[i]));
+	}
+	for (size_t i = front; i < count - back; i++){
+		std::string piece = text.substr(starts[i], starts[i + 1] - starts[i]);
+		auto found = moved.find(piece);
+		if (found != moved.end()){
+			chunks[i] = std::move(found->second);
+			moved.erase(found);
+		} else {
+			chunks[i] = parseChunk(piece, firsts[i]);
+		}
+	}
+	offsets = firsts;
+	updateNames();
+}
+
+void LspDocument::updateNames(){
+	for (size_t i = 0; i < chunks.size(); i++){
+		LspChunk& chunk = *chunks[i];
+		if (chunk.offset == offsets[i]){ continue; }
+		if (chunk.declared != nullptr){
+			std::ptrdiff_t lines = static_cast<std::ptrdiff_t>(offsets[i])
+			  - static_cast<std::ptrdiff_t>(chunk.offset);
+			chunk.declared->moveLines(lines);
+			if (chunk.analyzed != nullptr){ chunk.analyzed->moveLines(lines); }
+		}
+		chunk.offset = offsets[i];
+	}
+
+	// Imported places are the import's, or in another file
+	std::vector<std::pair<const LspChunk *, size_t>> importing;
+	for (size_t i = 0; i < chunks.size(); i++){
+		if (chunks[i]->imports != nullptr && !chunks[i]->imports->empty()){
+			importing.push_back(std::make_pair(chunks[i].get(), offsets[i]));
+		}
+	}
+	std::unique_ptr<NameIndex> replaced;
+	if (imported == nullptr || importing != importers){
+		replaced = std::move(imported);
+		imported.reset(new NameIndex());
+		for (auto& importer : importing){
+			imported->declareImports(importer.first->imports, path,
+			  importer.second);
+		}
+		importers = importing;
+	}
+
+	NameTable now;
+	now.add(*imported);
+	parsed = true;
+	for (auto& chunk : chunks){
+		if (chunk->declared == nullptr){ parsed = false; }
+		else { now.add(*chunk->declared); }
+	}
+	std::set<std::string> globals;
+	std::set<std::string> classes;
+	now.changes(table, globals, classes);
+	table = std::move(now);
+	for (size_t i = 0; i < chunks.size(); i++){
+		LspChunk& chunk = *chunks[i];
+		if (chunk.decls == nullptr){ continue; }
+		if (chunk.analyzed == nullptr
+		  || chunk.analyzed->dependsOn(globals, classes)){
+			chunk.analyzed.reset(new NameIndex(&table));
+			chunk.analyzed->analyze(chunk.decls, offsets[i]);
+		}
+	}
+}
+
+const LspChunk * LspDocument::chunkAt(size_t line) const{
+	// Chunk i has the lines after offsets[i], up to the next's
+	auto after = std::upper_bound(offsets.begin(), offsets.end(), line - 1);
+	if (after == offsets.begin()){ return nullptr; }
+	return chunks[static_cast<size_t>(after - offsets.begin()) - 1].get();
+}
+
+static int hexDigit(char c){
+	if (c >= '0' && c <= '9'){ return c - '0'; }
+	if (c >= 'a' && c <= 'f'){ return c - 'a' + 10; }
+	if (c >= 'A' && c <= 'F'){ return c - 'A' + 10; }
+	return -1;
+}
+
+/* The path of a file: URI, or "" */
+static std::string uriPath(const std::string& uri){
+	const std::string scheme = "file://";
+	if (uri.compare(0, scheme.size(), scheme) != 0){ return ""; }
+	std::string path;
+	for (size_t i = scheme.size(); i < uri.size(); i++){
+		int hi = i + 2 < uri.size() ? hexDigit(uri[i + 1]) : -1;
+		int lo = i + 2 < uri.size() ? hexDigit(uri[i + 2]) : -1;
+		if (uri[i] == '%' && hi >= 0 && lo >= 0){
+			path += static_cast<char>(hi * 16 + lo);
+			i += 2;
+		} else {
+			path += uri[i];
+		}
+	}
+	return normalPath(path);
+}
+
+/* The file: URI of a path */
+static std::string pathUri(const std::string& path){
+	static const char hex[] = "0123456789ABCDEF";
+	std::string uri = "file://";
+	for (char c : path){
+		unsigned char u = static_cast<unsigned char>(c);
+		if (isalnum(u) || c == '/' || c == '-' || c == '_' || c == '.'
+		  || c == '~'){
+			uri += c;
+		} else {
+			uri += '%';
+			uri += hex[u >> 4];
+			uri += hex[u & 15];
+		}
+	}
+	return uri;
+}
+
+/* The UTF-16 code units in the first col bytes of a line (all
+   from 0). A byte that starts a character is one unit, or two
+   if the character is outside the BMP; past the end of the
+   text, each byte is one. */
+static size_t toUtf16(const LexedText& text, size_t line, size_t col){
+	const std::string& all = text.text();
+	size_t start = text.lineStart(line);
+	size_t units = 0;
+	for (size_t at = start; at < start + col; at++){
+		if (at >= all.size()){
+			units++;
+			continue;
+		}
+		unsigned char c = static_cast<unsigned char>(all[at]);
+		if ((c & 0xC0) != 0x80){ units += c >= 0xF0 ? 2 : 1; }
+	}
+	return units;
+}
+
+/* The bytes in the first units UTF-16 code units of a line */
+static size_t fromUtf16(const LexedText& text, size_t line, size_t units){
+	const std::string& all = text.text();
+	size_t start = text.lineStart(line);
+	size_t end = text.lineStart(line + 1);
+	size_t at = start;
+	size_t seen = 0;
+	while (at < end && seen < units){
+		unsigned char c = static_cast<unsigned char>(all[at]);
+		seen += c >= 0xF0 ? 2 : 1;
+		at++;
+		while (at < end
+		  && (static_cast<unsigned char>(all[at]) & 0xC0) == 0x80){
+			at++;
+		}
+	}
+	return at - start + (units > seen ? units - seen : 0);
+}
+
+/* LSP counts lines and characters from 0 */
+static Json lspPosition(const LexedText& text, size_t line, size_t col){
+	line = line > 0 ? line - 1 : 0;
+	col = col > 0 ? col - 1 : 0;
+	return Json::object()
+	  .set("line", line)
+	  .set("character", toUtf16(text, line, col));
+}
+
+static Json lspRange(const LexedText& text, const Position& pos){
+	return Json::object()
+	  .set("start", lspPosition(text, pos.line(), pos.col()))
+	  .set("end", lspPosition(text, pos.lineEnd(), pos.colEnd()));
+}
+
+static Json lspDiagnostic(const LexedText& text, const Position& pos,
+  std::string msg){
+	return Json::object()
+	  .set("range", lspRange(text, pos))
+	  .set("severity", 1)
+	  .set("source", "ac")
+	  .set("message", msg);
+}
+
+static void pushDiagnostics(Json& diagnostics, const LexedText& text,
+  const std::vector<Report::Diagnostic>& errors){
+	for (auto& error : errors){
+		diagnostics.push(lspDiagnostic(text, error.pos, error.msg));
+	}
+}
+
+static int symbolKind(const std::string& kind){
+	if (kind == "class"){ return 5; }
+	if (kind == "method"){ return 6; }
+	if (kind == "field"){ return 8; }
+	if (kind == "function"){ return 12; }
+	return 13;
+}
+
+static Json documentSymbol(const LexedText& text, const NameDecl * decl){
+	Json symbol = Json::object()
+	  .set("name", decl->name)
+	  .set("detail", decl->type)
+	  .set("kind", symbolKind(decl->kind))
+	  .set("range", lspRange(text, decl->whole))
+	  .set("selectionRange", lspRange(text, decl->at));
+	if (decl->kind == "class"){
+		Json children = Json::array();
+		for (auto member : decl->members){
+			children.push(documentSymbol(text, member));
+		}
+		symbol.set("children", children);
+	}
+	return symbol;
+}
+
+class LspServer{
+public:
+	LspServer(std::istream& in, std::ostream& out)
+	: myIn(in), myOut(out), myShutdown(false){ }
+	int run();
+private:
+	bool readMessage(std::string& body);
+	void send(Json msg);
+	void reply(const Json& id, Json result);
+	void replyError(const Json& id, int code, std::string msg);
+	void publishDiagnostics(const std::string& uri);
+	LspDocument * document(const Json& params);
+	void place(const LspDocument& doc, const Json& position,
+	  size_t& line, size_t& col);
+	Json capabilities();
+	Json hover(const Json& params);
+	Json definition(const Json& params);
+	Json documentSymbols(const Json& params);
+	std::istream& myIn;
+	std::ostream& myOut;
+	std::map<std::string, LspDocument> myDocs;
+	bool myShutdown;
+};
+
+bool LspServer::readMessage(std::string& body){
+	size_t length = 0;
+	bool haveLength = false;
+	std::string header;
+	while (std::getline(myIn, header)){
+		if (!header.empty() && header.back() == '\r'){ header.pop_back(); }
+		if (header.empty()){
+			if (!haveLength){ continue; }
+			body.assign(length, '\0');
+			myIn.read(&body[0], static_cast<std::streamsize>(length));
+			return static_cast<size_t>(myIn.gcount()) == length;
+		}
+		const std::string key = "Content-Length:";
+		if (header.compare(0, key.size(), key) == 0){
+			length = std::strtoul(header.c_str() + key.size(), nullptr, 10);
+			haveLength = true;
+		}
+	}
+	return false;
+}
+
+void LspServer::send(Json msg){
+	msg.set("jsonrpc", "2.0");
+	std::string body = msg.write();
+	myOut << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+	myOut.flush();
+}
+
+void LspServer::reply(const Json& id, Json result){
+	send(Json::object().set("id", id).set("result", result));
+}
+
+void LspServer::replyError(const Json& id, int code, std::string msg){
+	Json error = Json::object().set("code", code).set("message", msg);
+	send(Json::object().set("id", id).set("error", error));
+}
+
+void LspServer::publishDiagnostics(const std::string& uri){
+	Json diagnostics = Json::array();
+	auto found = myDocs.find(uri);
+	if (found != myDocs.end()){
+		LspDocument& doc = found->second;
+		for (size_t i = 0; i < doc.chunks.size(); i++){
+			size_t off = doc.offsets[i];
+			for (auto& error : doc.chunks[i]->errors){
+				Position at(error.pos.line() + off, error.pos.col(),
+				  error.pos.lineEnd() + off, error.pos.colEnd());
+				diagnostics.push(lspDiagnostic(*doc.lexed, at, error.msg));
+			}
+		}
+		if (doc.parsed){
+			pushDiagnostics(diagnostics, *doc.lexed, doc.imported->errors());
+			pushDiagnostics(diagnostics, *doc.lexed, doc.table.errors());
+			for (auto& chunk : doc.chunks){
+				pushDiagnostics(diagnostics, *doc.lexed,
+				  chunk->declared->errors());
+				pushDiagnostics(diagnostics, *doc.lexed,
+				  chunk->analyzed->errors());
+			}
+		}
+	}
+	Json params = Json::object()
+	  .set("uri", uri)
+	  .set("diagnostics", diagnostics);
+	send(Json::object()
+	  .set("method", "textDocument/publishDiagnostics")
+	  .set("params", params));
+}
+
+LspDocument * LspServer::document(const Json& params){
+	auto found = myDocs.find(params["textDocument"]["uri"].str);
+	if (found == myDocs.end()){ return nullptr; }
+	return &found->second;
+}
+
+/* An LSP position as a line and byte column, both from 1 */
+void LspServer::place(const LspDocument& doc, const Json& position,
+  size_t& line, size_t& col){
+	line = static_cast<size_t>(position["line"].asInt());
+	col = fromUtf16(*doc.lexed, line,
+	  static_cast<size_t>(position["character"].asInt())) + 1;
+	line++;
+}
+
+Json LspServer::capabilities(){
+	Json caps = Json::object()
+	  // Changes come as edited ranges, to relex only those
+	  .set("textDocumentSync", 2)
+	  .set("hoverProvider", true)
+	  .set("definitionProvider", true)
+	  .set("documentSymbolProvider", true);
+	Json info = Json::object().set("name", "ac");
+	return Json::object().set("capabilities", caps).set("serverInfo", info);
+}
+
+Json LspServer::hover(const Json& params){
+	LspDocument * doc = document(params);
+	if (doc == nullptr){ return Json(); }
+	size_t line;
+	size_t col;
+	place(*doc, params["position"], line, col);
+	const LspChunk * chunk = doc->chunkAt(line);
+	if (chunk == nullptr){ return Json(); }
+	const NameDecl * decl = chunk->lookupAt(line, col);
+	if (decl == nullptr){ return Json(); }
+	std::string text = "```\n" + decl->name + " : " + decl->type
+	  + "\n```\n" + decl->kind;
+	Json contents = Json::object()
+	  .set("kind", "markdown")
+	  .set("value", text);
+	return Json::object()
+	  .set("contents", contents)
+	  .set("range", lspRange(*doc->lexed, *chunk->spanAt(line, col)));
+}
+
+Json LspServer::definition(const Json& params){
+	LspDocument * doc = document(params);
+	if (doc == nullptr){ return Json(); }
+	size_t line;
+	size_t col;
+	place(*doc, params["position"], line, col);
+	const LspChunk * chunk = doc->chunkAt(line);
+	if (chunk == nullptr){ return Json(); }
+	const NameDecl * decl = chunk->lookupAt(line, col);
+	if (decl == nullptr){ return Json(); }
+	if (decl->file.empty() || decl->file == doc->path){
+		return Json::object()
+		  .set("uri", params["textDocument"]["uri"])
+		  .set("range", lspRange(*doc->lexed, decl->at));
+	}
+	// Declared in an imported module, whose columns are counted
+	// against its own text
+	std::ifstream in(decl->file);
+	std::stringstream text;
+	text << in.rdbuf();
+	return Json::object()
+	  .set("uri", pathUri(decl->file))
+	  .set("range", lspRange(LexedText(text.str()), decl->at));
+}
+
+Json LspServer::documentSymbols(const Json& params){
+	Json symbols = Json::array();
+	LspDocument * doc = document(params);
+	if (doc == nullptr){ return symbols; }
+	for (auto& chunk : doc->chunks){
+		if (chunk->declared == nullptr){ continue; }
+		for (auto decl : chunk->declared->outline()){
+			symbols.push(documentSymbol(*doc->lexed, decl));
+		}
+	}
+	return symbols;
+}
+
+int LspServer::run(){
+	std::string body;
+	while (readMessage(body)){
+		Json msg;
+		try {
+			msg = Json::parse(body);
+		} catch (UserError * e){
+			replyError(Json(), -32700, e->msg());
+			continue;
+		}
+		const std::string& method = msg["method"].str;
+		const Json& id = msg["id"];
+		const Json& params = msg["params"];
+		if (method == "initialize"){
+			reply(id, capabilities());
+		} else if (method == "shutdown"){
+			myShutdown = true;
+			reply(id, Json());
+		} else if (method == "exit"){
+			return myShutdown ? 0 : 1;
+		} else if (method == "textDocument/didOpen"){
+			const std::string& uri = params["textDocument"]["uri"].str;
+			LspDocument& doc = myDocs[uri];
+			doc.path = uriPath(uri);
+			doc.lexed.reset(new LexedText(params["textDocument"]["text"].str));
+			doc.update();
+			publishDiagnostics(uri);
+		} else if (method == "textDocument/didChange"){
+			const std::string& uri = params["textDocument"]["uri"].str;
+			// Changes to a document that is not open have nothing
+			// to apply to
+			auto found = myDocs.find(uri);
+			if (found == myDocs.end()){ continue; }
+			LspDocument& doc = found->second;
+			for (auto& change : params["contentChanges"].items){
+				const Json& range = change["range"];
+				if (range.isNull()){
+					doc.lexed.reset(new LexedText(change["text"].str));
+					continue;
+				}
+				size_t startLine
+				  = static_cast<size_t>(range["start"]["line"].asInt());
+				size_t endLine
+				  = static_cast<size_t>(range["end"]["line"].asInt());
+				doc.lexed->edit(startLine, fromUtf16(*doc.lexed, startLine,
+				  static_cast<size_t>(range["start"]["character"].asInt())),
+				  endLine, fromUtf16(*doc.lexed, endLine,
+				  static_cast<size_t>(range["end"]["character"].asInt())),
+				  change["text"].str);
+			}
+			doc.update();
+			publishDiagnostics(uri);
+		} else if (method == "textDocument/didClose"){
+			const std::string& uri = params["textDocument"]["uri"].str;
+			myDocs.erase(uri);
+			publishDiagnostics(uri);
+		} else if (method == "textDocument/hover"){
+			reply(id, hover(params));
+		} else if (method == "textDocument/definition"){
+			reply(id, definition(params));
+		} else if (method == "textDocument/documentSymbol"){
+			reply(id, documentSymbols(params));
+		} else if (!id.isNull()){
+			replyError(id, -32601, "Unhandled method " + method);
+		}
+	}
+	// The client went away without saying exit
+	return 1;
+}
+
+int serveLsp(std::istream& in, std::ostream& out){
+	LspServer server(in, out);
+	return server.run();
+}
+
+}
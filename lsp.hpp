@@ -0,0 +1,15 @@
+#ifndef A_LANG_LSP_HPP
+#define A_LANG_LSP_HPP
+
+#include <istream>
+#include <ostream>
+
+namespace a_lang{
+
+/** Serve the Language Server Protocol on in and out until the
+ * client says exit, and return the exit code LSP asks for **/
+int serveLsp(std::istream& in, std::ostream& out);
+
+}
+
+#endif
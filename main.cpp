@@ -1,61 +1,139 @@
 #include <iostream>
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
 #include "errors.hpp"
 #include "scanner.hpp"
+#include "cgen.hpp"
+#include "daemon.hpp"
+#include "cache.hpp"
+#include "watch.hpp"
+#include "lsp.hpp"
+#include "xref.hpp"
+#include "module.hpp"
+#include "build.hpp"
+#include "stream.hpp"
+#include "x64.hpp"
+#include "jit.hpp"
 
 using namespace a_lang;
 
-static void usageAndDie(){
-	std::cerr << "Usage: ac <infile>"
+static int usage(){
+	std::cerr << "Usage: ac <infile, or - for stdin>"
 	<< " [-u <unparseFile>]: Output canonical program form\n"
 	<< " [-p]: Parse the input to check syntax\n"
 	<< " [-t <tokensFile>]: Output tokens to <tokensFile>\n"
+	<< " [-c <cFile>]: Output the program as C source to <cFile>\n"
+	<< " [-s <asmFile>]: Output the program as x86-64 assembler source"
+	<< " to <asmFile>\n"
+	<< " [-r [-- <args>]]: Compile the program in memory and run it with"
+	<< " <args>\n"
+	<< " [-i <ifaceFile>]: Output the interface its importers read\n"
+	<< " [-P]: With -c, instrument the C for the sampling profiler\n"
+	<< " [-I]: With -c, instrument the C to count branches and calls\n"
+	<< " [-F <countsFile>]: With -c, optimize for counts from an -I run\n"
+	<< " [-C <cacheDir>]: Reuse outputs for unchanged input from <cacheDir>\n"
+	<< "Or: ac --daemon <socket>: Serve compile requests on <socket>\n"
+	<< "Or: ac --client <socket> <args>: Have the daemon on <socket>"
+	<< " run ac <args>\n"
+	<< "Or: ac --watch <args>: Run ac <args> again whenever its inputs"
+	<< " change\n"
+	<< "Or: ac --lsp: Serve the Language Server Protocol on stdin/stdout\n"
+	<< "Or: ac --build [-j <jobs>] <infiles>: Write the interface and C"
+	<< " of <infiles> and their imports\n"
+	<< "Or: ac --index <indexFile> <infiles>: Index the symbols in"
+	<< " <infiles>\n"
+	<< "Or: ac --refs <indexFile> <name or file:line:col>: Find the"
+	<< " references to a symbol\n"
 	;
-	exit(1);
+	return 1;
 }
 
-static void writeTokenStream(const char * inPath, const char * outPath){
+/* Write an output and, unless producing it reported errors
+   that a cache hit would not repeat, cache it */
+static void finishOutput(const char * outPath, const std::string& text,
+  FrontendCache * cache, const char * kind, const std::string& opts,
+  size_t errorsBefore){
+	writeOutput(outPath, text.data(), text.size());
+	if (cache != nullptr && Report::count() == errorsBefore){
+		cache->store(kind, opts, text);
+	}
+}
+
+/* Whether the input is stdin, which is read once, as it comes */
+static bool isStdin(const char * inPath){
+	return strcmp(inPath, "-") == 0;
+}
+
+/* The stream to write an output to as it is made: outPath, or
+   stdout for "--" (as writeOutput does) */
+static std::ostream * openOutput(const char * outPath, std::ofstream& file){
+	if (strcmp(outPath, "--") == 0){ return &std::cout; }
+	file.open(outPath);
+	if (!file.good()){
+		std::string msg = "Bad output file ";
+		msg += outPath;
+		throw new InternalError(msg.c_str());
+	}
+	return &file;
+}
+
+static void writeTokenStream(const char * inPath, const char * outPath,
+  FrontendCache * cache){
+	if (outPath == nullptr){
+		std::string msg = "No tokens output file given";
+		throw new InternalError(msg.c_str());
+	}
+	if (isStdin(inPath)){
+		std::ofstream file;
+		Scanner scanner(&std::cin);
+		scanner.outputTokens(*openOutput(outPath, file));
+		return;
+	}
 	std::ifstream inStream(inPath);
 	if (!inStream.good()){
 		std::string msg = "Bad input stream";
 		msg += inPath;
 		throw new InternalError(msg.c_str());
 	}
-	if (outPath == nullptr){
-		std::string msg = "No tokens output file given";
-		throw new InternalError(msg.c_str());
+	if (cache != nullptr && cache->serve("tokens", "", outPath)){
+		return;
 	}
 
+	size_t errorsBefore = Report::count();
 	Scanner scanner(&inStream);
-	if (strcmp(outPath, "--") == 0){
-		scanner.outputTokens(std::cout);
-	} else {
-		std::ofstream outStream(outPath);
-		if (!outStream.good()){
-			std::string msg = "Bad output file ";
-			msg += outPath;
-			throw new InternalError(msg.c_str());
-		}
-		scanner.outputTokens(outStream);
-		outStream.close();
-	}
+	std::stringstream tokens;
+	scanner.outputTokens(tokens);
+	finishOutput(outPath, tokens.str(), cache, "tokens", "", errorsBefore);
 }
 
 static a_lang::ProgramNode * parse(const char * inFile){
-	std::ifstream inStream(inFile);
-	if (!inStream.good()){
-		std::string msg = "Bad input stream ";
-		msg += inFile;
-		throw new UserError(msg.c_str());
+	a_lang::ProgramNode * kept = nullptr;
+	if (!isStdin(inFile) && a_lang::watchedParse(inFile, kept)){
+		return kept;
+	}
+	std::ifstream inStream;
+	std::istream * in = &std::cin;
+	if (!isStdin(inFile)){
+		inStream.open(inFile);
+		if (!inStream.good()){
+			std::string msg = "Bad input stream ";
+			msg += inFile;
+			throw new UserError(msg.c_str());
+		}
+		in = &inStream;
 	}
 
 	//This pointer will be set to the root of the
 	// AST after parsing
 	a_lang::ProgramNode * root = nullptr;
 
-	a_lang::Scanner scanner(&inStream);
+	a_lang::Scanner scanner(in);
 	a_lang::Parser parser(scanner, &root);
 
 	int errCode = parser.parse();
@@ -64,46 +142,138 @@ static a_lang::ProgramNode * parse(const char * inFile){
 	return root;
 }
 
-static void outputAST(ASTNode * ast, const char * outPath){
-	if (strcmp(outPath, "--") == 0){
-		ast->unparse(std::cout, 0);
-	} else {
-		std::ofstream outStream(outPath);
-		if (!outStream.good()){
-			std::string msg = "Bad output file ";
-			msg += outPath;
-			throw new a_lang::InternalError(msg.c_str());
-		}
-		ast->unparse(outStream, 0);
+static bool doUnparsing(const char * inputPath, const char * outPath,
+  FrontendCache * cache){
+	if (isStdin(inputPath)){
+		// A declaration at a time, so a pipe of any length fits
+		std::ofstream file;
+		return streamUnparse(std::cin, openOutput(outPath, file));
 	}
+	if (cache != nullptr && cache->serve("unparse", "", outPath)){
+		return true;
+	}
+	size_t errorsBefore = Report::count();
+	a_lang::ProgramNode * ast = parse(inputPath);
+	if (ast == nullptr){ 
+		std::cerr << "No AST built\n";
+		return false;
+	}
+
+	std::stringstream text;
+	ast->unparse(text, 0);
+	finishOutput(outPath, text.str(), cache, "unparse", "", errorsBefore);
+	return true;
+}
+
+/* What, besides the input, the C output depends on */
+static std::string cGenKey(const char * inputPath,
+  const a_lang::CGenOpts& opts, const char * countsFile){
+	// Symbols are named for the module, and imports are typed
+	// by their interfaces
+	std::string key = "M" + moduleTag(inputPath) + "\n";
+	for (auto& import : scanImports(inputPath)){
+		std::string module = resolveImport(inputPath, import);
+		std::ifstream iface(interfacePath(module));
+		std::stringstream contents;
+		contents << iface.rdbuf();
+		key += "i" + moduleTag(module) + "\n" + contents.str();
+	}
+	// The profiler reports the source by name
+	if (opts.profile){ key += std::string("P") + inputPath + "\n"; }
+	if (opts.count){ key += "I\n"; }
+	if (countsFile != nullptr){
+		std::ifstream counts(countsFile);
+		std::stringstream contents;
+		contents << counts.rdbuf();
+		key += "F" + contents.str();
+	}
+	return key;
 }
 
-static bool doUnparsing(const char * inputPath, const char * outPath){
+static bool doCGen(const char * inputPath, const char * outPath,
+  a_lang::CGenOpts opts, FrontendCache * cache, const std::string& key){
+	if (cache != nullptr && cache->serve("c", key, outPath)){
+		return true;
+	}
+	size_t errorsBefore = Report::count();
 	a_lang::ProgramNode * ast = parse(inputPath);
 	if (ast == nullptr){ 
 		std::cerr << "No AST built\n";
 		return false;
 	}
 
-	outputAST(ast, outPath);
+	// Generate everything first so an error leaves no partial file
+	opts.srcName = inputPath;
+	opts.module = moduleTag(inputPath);
+	opts.imported = importedDecls(ast, inputPath);
+	std::stringstream cSrc;
+	ast->emitC(cSrc, opts);
+	finishOutput(outPath, cSrc.str(), cache, "c", key, errorsBefore);
 	return true;
 }
 
-int 
-main( const int argc, const char **argv )
+/* The native backend, which takes a program of one module */
+static bool doNative(const char * inputPath, const char * outPath,
+  a_lang::CGenOpts opts){
+	a_lang::ProgramNode * ast = parse(inputPath);
+	if (ast == nullptr){ 
+		std::cerr << "No AST built\n";
+		return false;
+	}
+	opts.srcName = inputPath;
+	opts.module = moduleTag(inputPath);
+	a_lang::IrProgram program;
+	ast->lower(program, opts);
+	std::stringstream asmSrc;
+	emitX64(program, asmSrc);
+	writeOutput(outPath, asmSrc.str().data(), asmSrc.str().size());
+	return true;
+}
+
+/* The native backend again, run in this process by the JIT.
+   Sets exitCode to the program's, if it could be compiled. */
+static bool doJit(const char * inputPath, a_lang::CGenOpts opts,
+  const std::vector<std::string>& args, int& exitCode){
+	a_lang::ProgramNode * ast = parse(inputPath);
+	if (ast == nullptr){ 
+		std::cerr << "No AST built\n";
+		return false;
+	}
+	opts.srcName = inputPath;
+	opts.module = moduleTag(inputPath);
+	a_lang::IrProgram program;
+	ast->lower(program, opts);
+	exitCode = runJit(program, args);
+	return true;
+}
+
+static int
+compile( const int argc, const char **argv )
 {
 	if (argc == 0){
-		usageAndDie();
+		return usage();
 	}
 	const char * inFile = NULL;
 	const char * tokensFile = NULL;
 	bool checkParse = false;
 	const char * unparseFile = NULL;
+	const char * cFile = NULL;
+	const char * asmFile = NULL;
+	const char * ifaceFile = NULL;
+	a_lang::CGenOpts cOpts;
+	const char * countsFile = NULL;
+	const char * cacheDir = NULL;
+	bool run = false;
+	std::vector<std::string> runArgs;
 
 	bool useful = false;
 	int i = 1;
 	for (int i = 1 ; i < argc ; i++){
-		if (argv[i][0] == '-'){
+		if (strcmp(argv[i], "--") == 0){
+			// The rest are the program's, for -r
+			runArgs.assign(argv + i + 1, argv + argc);
+			break;
+		} else if (argv[i][0] == '-' && argv[i][1] != '\0'){
 			if (argv[i][1] == 't'){
 				i++;
 				tokensFile = argv[i];
@@ -114,13 +284,43 @@ main( const int argc, const char **argv )
 				useful = true;
 			} else if (argv[i][1] == 'u'){
 				i++;
-				if (i >= argc){ usageAndDie(); }
+				if (i >= argc){ return usage(); }
 				unparseFile = argv[i];
 				useful = true;
+			} else if (argv[i][1] == 'c'){
+				i++;
+				if (i >= argc){ return usage(); }
+				cFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 's'){
+				i++;
+				if (i >= argc){ return usage(); }
+				asmFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'i'){
+				i++;
+				if (i >= argc){ return usage(); }
+				ifaceFile = argv[i];
+				useful = true;
+			} else if (argv[i][1] == 'r'){
+				run = true;
+				useful = true;
+			} else if (argv[i][1] == 'P'){
+				cOpts.profile = true;
+			} else if (argv[i][1] == 'I'){
+				cOpts.count = true;
+			} else if (argv[i][1] == 'F'){
+				i++;
+				if (i >= argc){ return usage(); }
+				countsFile = argv[i];
+			} else if (argv[i][1] == 'C'){
+				i++;
+				if (i >= argc){ return usage(); }
+				cacheDir = argv[i];
 			} else {
 				std::cerr << "Unrecognized argument: ";
 				std::cerr << argv[i] << std::endl;
-				usageAndDie();
+				return usage();
 			}
 		} else {
 			if (inFile == NULL){
@@ -128,40 +328,183 @@ main( const int argc, const char **argv )
 			} else {
 				std::cerr << "Only 1 input file allowed";
 				std::cerr << argv[i] << std::endl;
-				usageAndDie();
+				return usage();
 			}
 		}
 	}
 	if (inFile == NULL){
-		usageAndDie();
+		return usage();
 	}
 	if (!useful){
 		std::cerr << "Hey, you didn't tell the compiler to do anything!\n";
-		usageAndDie();
+		return usage();
+	}
+
+	if (isStdin(inFile)){
+		int outputs = (tokensFile != NULL) + checkParse
+		  + (unparseFile != NULL) + (cFile != NULL) + (asmFile != NULL)
+		  + (ifaceFile != NULL) + run;
+		if (outputs > 1){
+			std::cerr << "Only 1 output can be made from stdin\n";
+			return usage();
+		}
+		// There is no file to key a cache entry on
+		cacheDir = NULL;
+	}
+
+	// A daemon runs many compiles, so nothing may outlive this one
+	std::unique_ptr<FrontendCache> ownCache;
+	FrontendCache * cache = nullptr;
+	if (cacheDir != NULL){
+		ownCache.reset(new FrontendCache(cacheDir, inFile));
+		cache = ownCache.get();
 	}
 
 	try {
 		if (tokensFile != NULL){
-			writeTokenStream(inFile, tokensFile);
+			writeTokenStream(inFile, tokensFile, cache);
 		} if (checkParse){
-			if (!parse(inFile)){
-				std::cerr << "Parse failed" << std::endl;
+			// An empty entry records a clean parse
+			if (cache == nullptr || !cache->serve("parse", "", "/dev/null")){
+				size_t errorsBefore = Report::count();
+				bool parsed = isStdin(inFile)
+				  ? streamUnparse(std::cin, nullptr) : parse(inFile) != nullptr;
+				if (!parsed){
+					std::cerr << "Parse failed" << std::endl;
+				} else if (cache != nullptr
+				  && Report::count() == errorsBefore){
+					cache->store("parse", "", "");
+				}
 			}
 		} if (unparseFile != nullptr){
-			doUnparsing(inFile, unparseFile);
+			doUnparsing(inFile, unparseFile, cache);
+		} if (ifaceFile != nullptr){
+			a_lang::ProgramNode * ast = parse(inFile);
+			if (ast == nullptr){
+				std::cerr << "No AST built\n";
+				return 1;
+			}
+			writeModuleInterface(ast, inFile, ifaceFile);
+		} if (cFile != nullptr){
+			std::string key = cGenKey(inFile, cOpts, countsFile);
+			if (countsFile != nullptr){ cOpts.loadFeedback(countsFile); }
+			if (!doCGen(inFile, cFile, cOpts, cache, key)){ return 1; }
+		} if (asmFile != nullptr){
+			if (countsFile != nullptr && cFile == nullptr){
+				cOpts.loadFeedback(countsFile);
+			}
+			if (!doNative(inFile, asmFile, cOpts)){ return 1; }
+		} if (run){
+			if (countsFile != nullptr && cFile == nullptr && asmFile == nullptr){
+				cOpts.loadFeedback(countsFile);
+			}
+			runArgs.insert(runArgs.begin(), inFile);
+			int code = 0;
+			if (!doJit(inFile, cOpts, runArgs, code)){ return 1; }
+			return code;
 		}
 	} catch (ToDoError * e){
 		std::cerr << "ToDo: " << e->msg() << std::endl;
-		exit(1);
+		return 1;
 	} catch (InternalError * e){
 		std::string msg = "Something in the compiler is broken: ";
 		std::cerr << msg << e->msg() << std::endl;
-		exit(1);
+		return 1;
 	} catch (UserError * e){
 		std::string msg = "The user made a mistake: ";
 		std::cerr << msg << e->msg() << std::endl;
-		exit(1);
+		return 1;
 	}
 	
 	return 0;
 }
+
+/* What a command line reads: the input file, the source of
+   every module it imports, directly or not, and the counts file
+   given to -F. The imported modules' interfaces are not among
+   the files, since the watch writes them. */
+static a_lang::WatchInputs inputsOf(const int argc,
+  const char **argv){
+	a_lang::WatchInputs inputs;
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "--") == 0){
+			break;
+		} else if (argv[i][0] != '-'){
+			inputs.files.push_back(argv[i]);
+			std::set<std::string> seen;
+			std::vector<std::string> todo(1, argv[i]);
+			while (!todo.empty()){
+				std::string module = todo.back();
+				todo.pop_back();
+				for (auto& import : scanImports(module)){
+					std::string dep = normalPath(resolveImport(module, import));
+					if (!seen.insert(dep).second){ continue; }
+					inputs.files.push_back(dep);
+					inputs.modules.push_back(dep);
+					todo.push_back(dep);
+				}
+			}
+		} else if (strchr("tpucsiFC", argv[i][1]) != nullptr
+		  && argv[i][1] != '\0' && i + 1 < argc){
+			if (argv[i][1] == 'F'){ inputs.files.push_back(argv[i + 1]); }
+			i++;
+		}
+	}
+	return inputs;
+}
+
+int
+main( const int argc, const char **argv )
+{
+	if (argc == 2 && strcmp(argv[1], "--lsp") == 0){
+		return a_lang::serveLsp(std::cin, std::cout);
+	}
+	if (argc >= 2 && strcmp(argv[1], "--build") == 0){
+		int jobs = 0;
+		int first = 2;
+		// -j N or -jN
+		if (first < argc && strncmp(argv[first], "-j", 2) == 0){
+			const char * count = argv[first] + 2;
+			if (*count == '\0' && ++first < argc){ count = argv[first]; }
+			char * end = nullptr;
+			long parsed = strtol(count, &end, 10);
+			if (*count == '\0' || *end != '\0' || parsed < 0
+			  || parsed > INT_MAX){
+				return usage();
+			}
+			jobs = static_cast<int>(parsed);
+			first++;
+		}
+		if (first >= argc){ return usage(); }
+		std::vector<std::string> modules(argv + first, argv + argc);
+		return a_lang::buildModules(modules, jobs, compile);
+	}
+	if (argc >= 3 && strcmp(argv[1], "--index") == 0){
+		std::vector<std::string> files(argv + 3, argv + argc);
+		return a_lang::writeXrefIndex(argv[2], files) ? 0 : 1;
+	}
+	if (argc == 4 && strcmp(argv[1], "--refs") == 0){
+		return a_lang::queryXrefIndex(argv[2], argv[3], std::cout) ? 0 : 1;
+	}
+	if (argc >= 2 && strcmp(argv[1], "--watch") == 0){
+		std::vector<const char *> args(argv + 2, argv + argc);
+		args.insert(args.begin(), argv[0]);
+		int count = static_cast<int>(args.size());
+		return a_lang::watchAndRebuild(inputsOf, count, args.data(),
+		  compile);
+	}
+	if (argc >= 3 && strcmp(argv[1], "--daemon") == 0){
+		return a_lang::serveDaemon(argv[2], compile);
+	}
+	if (argc >= 3 && strcmp(argv[1], "--client") == 0){
+		int exitCode = 0;
+		if (a_lang::forwardToDaemon(argv[2], argc - 3, argv + 3, exitCode)){
+			return exitCode;
+		}
+		// No daemon is running, so do the work here
+		std::vector<const char *> args(argv + 3, argv + argc);
+		args.insert(args.begin(), argv[0]);
+		return compile(static_cast<int>(args.size()), args.data());
+	}
+	return compile(argc, argv);
+}
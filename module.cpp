@@ -0,0 +1,462 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+#include "module.hpp"
+#include "scanner.hpp"
+
+namespace a_lang{
+
+/*
+A module interface is a short binary file:
+
+	"ACMI", then a count: the format version (2)
+	a count of other modules' custom types, then for each
+	  the tag of its module and its declaration
+	a count of declarations, then each declaration
+
+Counts are 4 bytes, little-endian, and names are a count of
+bytes then the bytes. Declarations and types start with a tag:
+
+	'v' name type                 a global variable
+	'f' name count type* type     a function: formals, return
+	'c' name count decl*          a custom type: its fields and
+	                              methods, in layout order
+	'i' 'b' 'v'                   int, bool, void
+	'c' module name               a custom type, by the tag of
+	                              its module ("" for this one)
+	                              and its name
+	'&' type  'k' type            ref and immutable
+
+A signature may name a custom type of an imported module, which
+the importer need not import too. So an interface carries the
+declarations of those types, and of the types they name in
+turn, each after the types it names. An importer declares them
+before the module's own declarations, hidden: it may use them,
+but not name them.
+
+Custom types come first, in source order, since one may use
+another. The other declarations are sorted, so reordering them
+in the source leaves the interface as it was. Formals have no
+names here: renaming one does not change the signature.
+*/
+
+static const char moduleMagic[] = "ACMI";
+static const size_t moduleVersion = 2;
+
+void ModuleWriter::count(size_t n){
+	for (int shift = 0; shift < 32; shift += 8){
+		myBytes += static_cast<char>((n >> shift) & 0xff);
+	}
+}
+
+void ModuleWriter::name(const std::string& s){
+	count(s.length());
+	myBytes += s;
+}
+
+/** Type Nodes **/
+
+void IntTypeNode::exportType(ModuleWriter& out){
+	out.tag('i');
+}
+
+void BoolTypeNode::exportType(ModuleWriter& out){
+	out.tag('b');
+}
+
+void VoidTypeNode::exportType(ModuleWriter& out){
+	out.tag('v');
+}
+
+void ClassTypeNode::exportType(ModuleWriter& out){
+	std::string name = myID->getName();
+	std::string module = myModule;
+	if (module.empty()){
+		auto found = out.types().visible.find(name);
+		if (found == out.types().visible.end()){
+			std::string msg = myPos->span() + " Undeclared type " + name;
+			throw new UserError(msg.c_str());
+		}
+		module = found->second;
+	}
+	out.tag('c');
+	out.name(module);
+	out.name(name);
+	if (!module.empty()){ out.types().used.insert({module, name}); }
+}
+
+void ImmutableTypeNode::exportType(ModuleWriter& out){
+	out.tag('k');
+	mySub->exportType(out);
+}
+
+void RefTypeNode::exportType(ModuleWriter& out){
+	out.tag('&');
+	mySub->exportType(out);
+}
+
+/** Declaration Nodes **/
+
+void VarDeclNode::exportDecl(ModuleWriter& out){
+	out.tag('v');
+	out.name(myID->getName());
+	myType->exportType(out);
+}
+
+void FnDeclNode::exportDecl(ModuleWriter& out){
+	out.tag('f');
+	out.name(myID->getName());
+	out.count(myFormals->size());
+	for (auto formal : *myFormals){
+		formal->getTypeNode()->exportType(out);
+	}
+	myRetType->exportType(out);
+}
+
+void ClassDefnNode::exportDecl(ModuleWriter& out){
+	out.tag('c');
+	out.name(myID->getName());
+	out.count(myMembers->size());
+	for (auto member : *myMembers){
+		member->exportDecl(out);
+	}
+}
+
+typedef std::pair<std::string, std::string> TypeKey;
+
+/* Append the declaration of another module's type, after those
+   of the types it names that are not written yet */
+static void exportForeign(const TypeKey& type,
+  const std::map<TypeKey, ClassDefnNode *>& defns,
+  std::set<TypeKey>& written, std::string& bytes, size_t& count){
+	if (!written.insert(type).second){ return; }
+	auto defn = defns.find(type);
+	if (defn == defns.end()){
+		std::string msg = "No import declares type " + type.second
+		  + " of module " + type.first;
+		throw new UserError(msg.c_str());
+	}
+	InterfaceTypes named;
+	ModuleWriter decl(&named);
+	decl.name(type.first);
+	defn->second->exportDecl(decl);
+	for (auto& other : named.used){
+		exportForeign(other, defns, written, bytes, count);
+	}
+	bytes += decl.bytes();
+	count++;
+}
+
+std::string moduleInterface(ProgramNode * program,
+  const std::string& srcPath){
+	// What the signatures may name: the module's own types, or
+	// those its imports declare (and so would be found by the C
+	// backend), whatever module they are from
+	InterfaceTypes types;
+	std::map<TypeKey, ClassDefnNode *> defns;
+	for (auto& module : *importedDecls(program, srcPath)){
+		std::string tag = moduleTag(module.path);
+		for (auto& type : module.types){
+			defns[{type.module, type.defn->ID()->getName()}] = type.defn;
+		}
+		for (auto decl : *module.decls){
+			auto cls = dynamic_cast<ClassDefnNode *>(decl);
+			if (cls == nullptr){ continue; }
+			defns[{tag, cls->ID()->getName()}] = cls;
+			types.visible.emplace(cls->ID()->getName(), tag);
+		}
+	}
+	for (auto global : *program->getGlobals()){
+		auto cls = dynamic_cast<ClassDefnNode *>(global);
+		if (cls != nullptr){ types.visible[cls->ID()->getName()] = ""; }
+	}
+
+	ModuleWriter classes(&types);
+	std::vector<std::string> others;
+	for (auto global : *program->getGlobals()){
+		if (dynamic_cast<ClassDefnNode *>(global) != nullptr){
+			global->exportDecl(classes);
+		} else {
+			ModuleWriter decl(&types);
+			global->exportDecl(decl);
+			others.push_back(decl.bytes());
+		}
+	}
+	std::sort(others.begin(), others.end());
+
+	std::set<TypeKey> written;
+	std::string foreign;
+	size_t foreignCount = 0;
+	for (auto& type : types.used){
+		exportForeign(type, defns, written, foreign, foreignCount);
+	}
+
+	ModuleWriter out(&types);
+	for (const char * c = moduleMagic; *c != '\0'; c++){ out.tag(*c); }
+	out.count(moduleVersion);
+	out.count(foreignCount);
+	std::string bytes = out.bytes() + foreign;
+	ModuleWriter globals(&types);
+	globals.count(program->getGlobals()->size());
+	bytes += globals.bytes() + classes.bytes();
+	for (auto& decl : others){ bytes += decl; }
+	return bytes;
+}
+
+void writeModuleInterface(ProgramNode * program,
+  const std::string& srcPath, const char * path){
+	std::string bytes = moduleInterface(program, srcPath);
+	std::ifstream old(path, std::ios::binary);
+	if (old.good()){
+		std::stringstream contents;
+		contents << old.rdbuf();
+		if (contents.str() == bytes){ return; }
+	}
+
+	// Write aside and rename, so an importer never reads half
+	std::string tmpPath = std::string(path) + "."
+	  + std::to_string(getpid());
+	std::ofstream out(tmpPath, std::ios::binary);
+	out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	out.close();
+	if (!out.good() || rename(tmpPath.c_str(), path) != 0){
+		unlink(tmpPath.c_str());
+		std::string msg = "Could not write module interface ";
+		msg += path;
+		throw new UserError(msg.c_str());
+	}
+}
+
+/* Reads an interface back, failing on anything malformed */
+class ModuleReader{
+public:
+	ModuleReader(const std::string& bytes, const std::string& path,
+	  const std::string& module)
+	: myBytes(bytes), myPath(path), myModule(module), myAt(0){ }
+	char tag(){
+		if (myAt >= myBytes.size()){ corrupt(); }
+		return myBytes[myAt++];
+	}
+	size_t count(){
+		size_t n = 0;
+		for (int shift = 0; shift < 32; shift += 8){
+			n |= static_cast<size_t>(static_cast<unsigned char>(tag()))
+			  << shift;
+		}
+		return n;
+	}
+	std::string name(){
+		size_t len = count();
+		if (len > myBytes.size() - myAt){ corrupt(); }
+		std::string result = myBytes.substr(myAt, len);
+		myAt += len;
+		return result;
+	}
+	/** The tag of a custom type's module **/
+	std::string module(){
+		std::string tag = name();
+		return tag.empty() ? myModule : tag;
+	}
+	bool done() const { return myAt == myBytes.size(); }
+	[[noreturn]] void corrupt() const {
+		std::string msg = "Corrupt module interface " + myPath;
+		throw new UserError(msg.c_str());
+	}
+private:
+	const std::string& myBytes;
+	std::string myPath;
+	std::string myModule;
+	size_t myAt;
+};
+
+static TypeNode * readType(ModuleReader& in, const Position * at){
+	switch (in.tag()){
+	case 'i': return new IntTypeNode(at);
+	case 'b': return new BoolTypeNode(at);
+	case 'v': return new VoidTypeNode(at);
+	case 'c': {
+		std::string module = in.module();
+		return new ClassTypeNode(at, new IDNode(at, in.name()), module);
+	}
+	case '&': return new RefTypeNode(at, readType(in, at));
+	case 'k': return new ImmutableTypeNode(at, readType(in, at));
+	}
+	in.corrupt();
+}
+
+static DeclNode * readDecl(ModuleReader& in, const Position * at,
+  bool member){
+	char kind = in.tag();
+	IDNode * id = new IDNode(at, in.name());
+	if (kind == 'v'){
+		return new VarDeclNode(at, id, readType(in, at), nullptr);
+	} else if (kind == 'f'){
+		auto formals = AstArena::track(new std::list<FormalDeclNode *>());
+		size_t n = in.count();
+		for (size_t i = 0; i < n; i++){
+			IDNode * formal = new IDNode(at, "arg" + std::to_string(i));
+			formals->push_back(new FormalDeclNode(at, formal,
+			  readType(in, at)));
+		}
+		TypeNode * retType = readType(in, at);
+		return new FnDeclNode(at, id, formals, retType,
+		  AstArena::track(new std::list<StmtNode *>()));
+	} else if (kind == 'c' && !member){
+		auto members = AstArena::track(new std::list<DeclNode *>());
+		size_t n = in.count();
+		for (size_t i = 0; i < n; i++){
+			members->push_back(readDecl(in, at, true));
+		}
+		return new ClassDefnNode(at, id, members);
+	}
+	in.corrupt();
+}
+
+std::list<DeclNode *> * interfaceDecls(const std::string& modulePath,
+  const Position * at, std::list<ForeignType> * types){
+	std::string path = interfacePath(modulePath);
+	std::ifstream file(path, std::ios::binary);
+	if (!file.good()){
+		std::string msg = "No interface for module " + modulePath
+		  + " (make it with ac " + modulePath + " -i " + path + ")";
+		throw new UserError(msg.c_str());
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::string bytes = contents.str();
+	ModuleReader in(bytes, path, moduleTag(modulePath));
+	for (const char * c = moduleMagic; *c != '\0'; c++){
+		if (in.tag() != *c){ in.corrupt(); }
+	}
+	if (in.count() != moduleVersion){ in.corrupt(); }
+	size_t foreign = in.count();
+	for (size_t i = 0; i < foreign; i++){
+		std::string module = in.name();
+		auto defn = dynamic_cast<ClassDefnNode *>(readDecl(in, at, false));
+		if (module.empty() || defn == nullptr){ in.corrupt(); }
+		if (types != nullptr){ types->push_back(ForeignType(module, defn)); }
+	}
+	auto decls = AstArena::track(new std::list<DeclNode *>());
+	size_t n = in.count();
+	for (size_t i = 0; i < n; i++){
+		decls->push_back(readDecl(in, at, false));
+	}
+	if (!in.done()){ in.corrupt(); }
+	return decls;
+}
+
+std::list<ImportedModule> * importedDecls(ProgramNode * program,
+  const std::string& srcPath){
+	auto modules = AstArena::track(new std::list<ImportedModule>());
+	std::vector<std::string> seen;
+	for (auto import : *program->getImports()){
+		std::string module
+		  = normalPath(resolveImport(srcPath, import->getPath()));
+		if (std::find(seen.begin(), seen.end(), module) != seen.end()){
+			continue;
+		}
+		seen.push_back(module);
+		modules->push_back(ImportedModule(module));
+		ImportedModule& imported = modules->back();
+		imported.decls = interfaceDecls(module, import->pos(),
+		  &imported.types);
+	}
+	return modules;
+}
+
+std::vector<std::string> scanImports(const std::string& srcPath){
+	std::vector<std::string> imports;
+	std::ifstream in(srcPath);
+	if (!in.good()){ return imports; }
+
+	// The tokens are only looked at here
+	AstArena tokens;
+	AstArena::Scope scope(&tokens);
+	std::vector<Report::Diagnostic> errors;
+	std::vector<Report::Diagnostic> * outer = Report::collector();
+	Report::collector() = &errors;
+	Scanner scanner(&in);
+	Parser::semantic_type lval;
+	while (scanner.yylex(&lval) == Parser::token::IMPORT){
+		if (scanner.yylex(&lval) != Parser::token::STRINGLITERAL){ break; }
+		std::string lexeme
+		  = static_cast<StrToken *>(lval.as<Token *>())->str();
+		if (scanner.yylex(&lval) != Parser::token::SEMICOL){ break; }
+		imports.push_back(lexeme.substr(1, lexeme.length() - 2));
+	}
+	Report::collector() = outer;
+	return imports;
+}
+
+std::string resolveImport(const std::string& srcPath,
+  const std::string& import){
+	size_t slash = srcPath.rfind('/');
+	if (import.empty() || import[0] == '/' || slash == std::string::npos){
+		return import;
+	}
+	return srcPath.substr(0, slash + 1) + import;
+}
+
+std::string normalPath(const std::string& path){
+	std::vector<std::string> parts;
+	std::stringstream in(path);
+	std::string part;
+	while (std::getline(in, part, '/')){
+		if (part.empty() || part == "."){ continue; }
+		if (part == ".." && !parts.empty() && parts.back() != ".."){
+			parts.pop_back();
+		} else {
+			parts.push_back(part);
+		}
+	}
+	std::string result = !path.empty() && path[0] == '/' ? "/" : "";
+	for (size_t i = 0; i < parts.size(); i++){
+		result += (i > 0 ? "/" : "") + parts[i];
+	}
+	return result;
+}
+
+std::string interfacePath(const std::string& modulePath){
+	return modulePath + "i";
+}
+
+std::string cPathOf(const std::string& modulePath){
+	size_t len = modulePath.length();
+	if (len > 2 && modulePath.compare(len - 2, 2, ".a") == 0){
+		return modulePath.substr(0, len - 2) + ".c";
+	}
+	return modulePath + ".c";
+}
+
+std::string moduleTag(const std::string& modulePath){
+	size_t slash = modulePath.rfind('/');
+	std::string file = slash == std::string::npos
+	  ? modulePath : modulePath.substr(slash + 1);
+	std::string tag = file.substr(0, file.rfind('.'));
+	for (auto& c : tag){
+		if (!isalnum(static_cast<unsigned char>(c))){ c = '_'; }
+	}
+
+	// Importers spell the path to a module in their own ways,
+	// so the directory is resolved first. Only the directory:
+	// an importer may have the interface without the source.
+	std::string dir = slash == std::string::npos
+	  ? "." : modulePath.substr(0, slash + 1);
+	char * real = realpath(dir.c_str(), nullptr);
+	std::string where = (real != nullptr ? real : dir) + "/" + file;
+	free(real);
+	uint32_t hash = 2166136261u;
+	for (char c : where){
+		hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+	}
+	char hex[9];
+	snprintf(hex, sizeof hex, "%08x", hash);
+	return tag + "_" + hex;
+}
+
+}
@@ -0,0 +1,116 @@
+#ifndef A_LANG_MODULE_HPP
+#define A_LANG_MODULE_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ast.hpp"
+
+namespace a_lang{
+
+/** The custom types that the declarations of an interface
+ * name, as it is written **/
+class InterfaceTypes{
+public:
+	/** The module declaring each type the source may name: ""
+	 * for the module itself, or an imported module's tag **/
+	std::map<std::string, std::string> visible;
+	/** The types of other modules named, by tag and name **/
+	std::set<std::pair<std::string, std::string>> used;
+};
+
+/** Builds the bytes of a module interface (see module.cpp) **/
+class ModuleWriter{
+public:
+	ModuleWriter(InterfaceTypes * types) : myTypes(types){ }
+	void tag(char c){ myBytes += c; }
+	void count(size_t n);
+	void name(const std::string& s);
+	InterfaceTypes& types(){ return *myTypes; }
+	const std::string& bytes() const { return myBytes; }
+private:
+	InterfaceTypes * myTypes;
+	std::string myBytes;
+};
+
+/** The interface of a module: what its importers may use of
+ * it, which is the signature of every global, and the custom
+ * types of other modules those signatures name. program is
+ * read from srcPath, and the interfaces of its imports must be
+ * written already. Editing a function body or a comment
+ * leaves it byte for byte the same. Throws a UserError if a
+ * signature names a type that is nowhere declared. **/
+std::string moduleInterface(ProgramNode * program,
+  const std::string& srcPath);
+
+/** Write program's interface to path, unless the file already
+ * holds exactly that, so that its timestamp only moves when the
+ * interface changes. Throws a UserError if it can't write. **/
+void writeModuleInterface(ProgramNode * program,
+  const std::string& srcPath, const char * path);
+
+/** A custom type of another module that an interface names **/
+class ForeignType{
+public:
+	ForeignType(std::string moduleIn, ClassDefnNode * defnIn)
+	: module(moduleIn), defn(defnIn){ }
+	/** The tag of the module that declares it **/
+	std::string module;
+	ClassDefnNode * defn;
+};
+
+/** The declarations in the interface of the module at
+ * modulePath, with no bodies or initializers, positioned at at.
+ * The custom types of other modules that they name are added to
+ * types, if given, each after those it names in turn. Throws a
+ * UserError if the interface is missing or corrupt. **/
+std::list<DeclNode *> * interfaceDecls(const std::string& modulePath,
+  const Position * at, std::list<ForeignType> * types = nullptr);
+
+/** A module imported by another, as its interface declares it **/
+class ImportedModule{
+public:
+	ImportedModule(std::string pathIn)
+	: path(pathIn), decls(nullptr){ }
+	/** Where the module is, resolved from the importer **/
+	std::string path;
+	/** Custom types of other modules that decls name, which
+	 * the importer need not import itself (see interfaceDecls) **/
+	std::list<ForeignType> types;
+	std::list<DeclNode *> * decls;
+};
+
+/** Every module that program (read from srcPath) imports, each
+ * once, in order, with the declarations read from its interface
+ * (see interfaceDecls), positioned at the import **/
+std::list<ImportedModule> * importedDecls(ProgramNode * program,
+  const std::string& srcPath);
+
+/** The paths a source file imports, as written, found by
+ * scanning its first tokens rather than parsing it **/
+std::vector<std::string> scanImports(const std::string& srcPath);
+
+/** Where an import in the file at srcPath refers to **/
+std::string resolveImport(const std::string& srcPath,
+  const std::string& import);
+/** path without "." and "dir/..", so that a module has one
+ * name however it is reached **/
+std::string normalPath(const std::string& path);
+/** Where the interface of the module at modulePath lives:
+ * beside it, as "shapes.a" has "shapes.ai" **/
+std::string interfacePath(const std::string& modulePath);
+/** Where the C of the module at modulePath is expected to be,
+ * as "shapes.a" has "shapes.c" **/
+std::string cPathOf(const std::string& modulePath);
+/** A C identifier that tells the module apart from the others
+ * in a program: its file name, without the extension, and a
+ * hash of the directory it is really in **/
+std::string moduleTag(const std::string& modulePath);
+
+}
+
+#endif
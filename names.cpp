@@ -0,0 +1,510 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "names.hpp"
+#include "alang.hpp"
+#include "module.hpp"
+
+namespace a_lang{
+
+/*
+Name analysis, for tools rather than for code generation: it
+records every declaration and every use of a name with its
+place in the source, and reports the names it cannot resolve
+instead of stopping at the first. Declarations are made in two
+passes (see NameIndex) so that a piece of the program can be
+reparsed without redoing the others' declarations in order.
+Imported modules are declared before either pass, from their
+source where it parses so that their names can be found there.
+
+Analyzing against a NameTable notes each global and type looked
+up there, found or not: a piece that used a name, or failed to,
+is affected exactly when the table's declaration of that name
+changes. Members are looked up through their type, so a change
+to a class's members shows as a change to the class.
+*/
+
+/** NameIndex **/
+
+Position NameIndex::place(const Position * pos) const{
+	return Position(pos->line() + myLineOffset, pos->col(),
+	  pos->lineEnd() + myLineOffset, pos->colEnd());
+}
+
+void NameIndex::error(const Position * pos, std::string msg){
+	Position at = place(pos);
+	// A module's errors are its importer's
+	if (myImportAt != nullptr){ at = *myImportAt; }
+	myErrors.push_back(Report::Diagnostic(&at, msg));
+}
+
+const NameDecl * NameIndex::findGlobal(const std::string& name){
+	const Scope * globals = &myGlobals;
+	if (myTable != nullptr){
+		myGlobalUses.insert(name);
+		globals = &myTable->myGlobals;
+	}
+	auto found = globals->find(name);
+	return found == globals->end() ? nullptr : found->second;
+}
+
+NameDecl * NameIndex::findClass(const std::string& name){
+	const std::map<std::string, NameDecl *> * classes = &myClasses;
+	if (myTable != nullptr){
+		myClassUses.insert(name);
+		classes = &myTable->myClasses;
+	}
+	auto found = classes->find(name);
+	return found == classes->end() ? nullptr : found->second;
+}
+
+const NameDecl * NameIndex::findMember(const std::string& cls,
+  const std::string& name){
+	const Scope * members = nullptr;
+	if (myTable != nullptr){
+		myClassUses.insert(cls);
+		auto found = myTable->myMembers.find(cls);
+		if (found != myTable->myMembers.end()){ members = found->second; }
+	} else {
+		auto found = myMembers.find(cls);
+		if (found != myMembers.end()){ members = &found->second; }
+	}
+	if (members == nullptr){ return nullptr; }
+	auto found = members->find(name);
+	return found == members->end() ? nullptr : found->second;
+}
+
+void NameIndex::declareModule(const std::string& module,
+  const std::string& srcPath, const Position * import){
+	std::ifstream in(module);
+	std::stringstream text;
+	text << in.rdbuf();
+	std::unique_ptr<CompilationUnit> unit;
+	if (in.good() || in.eof()){ unit = parseSource(text.str()); }
+	if (unit != nullptr && unit->ok()){
+		myFile = module;
+		myLineOffset = 0;
+		for (auto decl : *unit->ast()->getGlobals()){ decl->nameDeclare(this); }
+		return;
+	}
+	AstArena arena;
+	AstArena::Scope scope(&arena);
+	myFile = srcPath;
+	for (auto decl : *interfaceDecls(module, import)){
+		decl->nameDeclare(this);
+	}
+}
+
+void NameIndex::declareImports(std::list<ImportNode *> * imports,
+  const std::string& srcPath, size_t lineOffset){
+	for (auto import : *imports){
+		std::string module
+		  = normalPath(resolveImport(srcPath, import->getPath()));
+		if (std::find(myModules.begin(), myModules.end(), module)
+		  != myModules.end()){
+			continue;
+		}
+		myModules.push_back(module);
+		myLineOffset = lineOffset;
+		Position at = place(import->pos());
+		try {
+			myImportAt = &at;
+			declareModule(module, srcPath, import->pos());
+		} catch (UserError * e){
+			error(import->pos(), e->msg());
+		}
+		myImportAt = nullptr;
+		myFile.clear();
+	}
+}
+
+void NameIndex::declareGlobals(std::list<DeclNode *> * decls,
+  size_t lineOffset){
+	myLineOffset = lineOffset;
+	for (auto decl : *decls){ decl->nameDeclare(this); }
+}
+
+void NameIndex::analyze(std::list<DeclNode *> * decls,
+  size_t lineOffset){
+	myLineOffset = lineOffset;
+	for (auto decl : *decls){ decl->nameAnalysis(this); }
+}
+
+const NameDecl * NameIndex::declare(IDNode * id, ASTNode * whole,
+  std::string kind, std::string type, std::string cls){
+	Scope * scope = &myGlobals;
+	if (inFn()){
+		scope = &myScopes.back();
+	} else if (myClass != nullptr){
+		scope = &myMembers[myClass->name];
+		if (kind == "variable"){ kind = "field"; }
+		if (kind == "function"){ kind = "method"; }
+	}
+	myDecls.push_back(NameDecl(id->getName(), kind, type, cls,
+	  place(id->pos()), place(whole->pos())));
+	myDecls.back().file = myFile;
+	const NameDecl * decl = &myDecls.back();
+	if (scope->find(decl->name) != scope->end()){
+		error(id->pos(), "Multiply declared identifier " + decl->name);
+	} else {
+		(*scope)[decl->name] = decl;
+	}
+	if (!inFn()){
+		if (myClass != nullptr){ myClass->members.push_back(decl); }
+		else if (myFile.empty()){ myOutline.push_back(decl); }
+	}
+	return decl;
+}
+
+void NameIndex::declareClass(IDNode * id, ASTNode * whole){
+	std::string name = id->getName();
+	myDecls.push_back(NameDecl(name, "class", "custom", name,
+	  place(id->pos()), place(whole->pos())));
+	myDecls.back().file = myFile;
+	NameDecl * decl = &myDecls.back();
+	if (myClasses.find(name) != myClasses.end()){
+		error(id->pos(), "Multiply declared type " + name);
+	} else {
+		myClasses[name] = decl;
+	}
+	if (myFile.empty()){ myOutline.push_back(decl); }
+}
+
+const NameDecl * NameIndex::use(IDNode * id){
+	std::string name = id->getName();
+	const NameDecl * found = nullptr;
+	for (auto scope = myScopes.rbegin();
+	  found == nullptr && scope != myScopes.rend(); ++scope){
+		auto decl = scope->find(name);
+		if (decl != scope->end()){ found = decl->second; }
+	}
+	if (found == nullptr && myClass != nullptr){
+		found = findMember(myClass->name, name);
+	}
+	if (found == nullptr){ found = findGlobal(name); }
+	if (found == nullptr){
+		error(id->pos(), "Undeclared identifier " + name);
+		return nullptr;
+	}
+	myUses.push_back(NameUse(place(id->pos()), found));
+	return found;
+}
+
+const NameDecl * NameIndex::useType(IDNode * id){
+	const NameDecl * found = findClass(id->getName());
+	if (found == nullptr){
+		error(id->pos(), "Undeclared type " + id->getName());
+		return nullptr;
+	}
+	myUses.push_back(NameUse(place(id->pos()), found));
+	return found;
+}
+
+const NameDecl * NameIndex::useMember(const NameDecl * base,
+  IDNode * field){
+	// An unresolved base has already been reported
+	if (base == nullptr){ return nullptr; }
+	if (base->cls.empty()){
+		error(field->pos(), "Member access on non-custom type "
+		  + base->type);
+		return nullptr;
+	}
+	const NameDecl * found = findMember(base->cls, field->getName());
+	if (found == nullptr){
+		error(field->pos(), "Undeclared identifier " + field->getName());
+		return nullptr;
+	}
+	myUses.push_back(NameUse(place(field->pos()), found));
+	return found;
+}
+
+void NameIndex::enterClass(IDNode * id){
+	myClass = findClass(id->getName());
+}
+
+void NameIndex::enterFn(){
+	myFnDepth++;
+	enterScope();
+}
+
+void NameIndex::leaveFn(){
+	leaveScope();
+	myFnDepth--;
+}
+
+static bool covers(const Position& at, size_t line, size_t col){
+	return at.line() == line && at.col() <= col && col < at.colEnd();
+}
+
+const Position * NameIndex::spanAt(size_t line, size_t col) const{
+	for (auto& use : myUses){
+		if (covers(use.at, line, col)){ return &use.at; }
+	}
+	for (auto& decl : myDecls){
+		if (decl.file.empty() && covers(decl.at, line, col)){
+			return &decl.at;
+		}
+	}
+	return nullptr;
+}
+
+const NameDecl * NameIndex::lookupAt(size_t line, size_t col) const{
+	for (auto& use : myUses){
+		if (covers(use.at, line, col)){ return use.decl; }
+	}
+	for (auto& decl : myDecls){
+		if (decl.file.empty() && covers(decl.at, line, col)){
+			return &decl;
+		}
+	}
+	return nullptr;
+}
+
+static bool meets(const std::set<std::string>& a,
+  const std::set<std::string>& b){
+	const std::set<std::string>& small = a.size() < b.size() ? a : b;
+	const std::set<std::string>& large = a.size() < b.size() ? b : a;
+	for (auto& name : small){
+		if (large.count(name) > 0){ return true; }
+	}
+	return false;
+}
+
+bool NameIndex::dependsOn(const std::set<std::string>& globals,
+  const std::set<std::string>& classes) const{
+	return meets(myGlobalUses, globals) || meets(myClassUses, classes);
+}
+
+void NameIndex::moveLines(std::ptrdiff_t lines){
+	for (auto& decl : myDecls){
+		if (!decl.file.empty()){ continue; }
+		decl.at.moveLines(lines);
+		decl.whole.moveLines(lines);
+	}
+	for (auto& use : myUses){ use.at.moveLines(lines); }
+	for (auto& error : myErrors){ error.pos.moveLines(lines); }
+}
+
+/** NameTable **/
+
+void NameTable::add(const NameIndex& piece){
+	for (auto& global : piece.myGlobals){
+		if (!myGlobals.insert(global).second){
+			myErrors.push_back(Report::Diagnostic(&global.second->at,
+			  "Multiply declared identifier " + global.first));
+		}
+	}
+	for (auto& cls : piece.myClasses){
+		if (!myClasses.insert(cls).second){
+			myErrors.push_back(Report::Diagnostic(&cls.second->at,
+			  "Multiply declared type " + cls.first));
+			continue;
+		}
+		auto members = piece.myMembers.find(cls.first);
+		if (members != piece.myMembers.end()){
+			myMembers[cls.first] = &members->second;
+		}
+	}
+}
+
+template <typename Decls>
+static void differences(const Decls& now, const Decls& old,
+  std::set<std::string>& names){
+	for (auto& decl : now){
+		auto was = old.find(decl.first);
+		if (was == old.end() || was->second != decl.second){
+			names.insert(decl.first);
+		}
+	}
+	for (auto& decl : old){
+		if (now.find(decl.first) == now.end()){ names.insert(decl.first); }
+	}
+}
+
+void NameTable::changes(const NameTable& old,
+  std::set<std::string>& globals, std::set<std::string>& classes) const{
+	differences(myGlobals, old.myGlobals, globals);
+	differences(myClasses, old.myClasses, classes);
+}
+
+/** Declarations **/
+
+void VarDeclNode::nameDeclare(NameIndex * names){
+	std::stringstream type;
+	myType->unparse(type, 0);
+	names->declare(myID, this, "variable", type.str(),
+	  myType->className());
+}
+
+void FormalDeclNode::nameDeclare(NameIndex * names){
+	std::stringstream type;
+	getTypeNode()->unparse(type, 0);
+	names->declare(ID(), this, "parameter", type.str(),
+	  getTypeNode()->className());
+}
+
+void FnDeclNode::nameDeclare(NameIndex * names){
+	std::stringstream sig;
+	sig << "(";
+	bool first = true;
+	for (auto formal : *myFormals){
+		if (first){ first = false; }
+		else { sig << ", "; }
+		formal->unparse(sig, 0);
+	}
+	sig << ") -> ";
+	myRetType->unparse(sig, 0);
+	names->declare(myID, this, "function", sig.str(), "");
+}
+
+void ClassDefnNode::nameDeclare(NameIndex * names){
+	names->declareClass(myID, this);
+	names->enterClass(myID);
+	for (auto member : *myMembers){ member->nameDeclare(names); }
+	names->leaveClass();
+}
+
+void VarDeclNode::nameAnalysis(NameIndex * names){
+	myType->nameAnalysis(names);
+	if (myInit != nullptr){ myInit->nameAnalysis(names); }
+	// Globals and fields were declared up front
+	if (names->inFn()){ nameDeclare(names); }
+}
+
+void FnDeclNode::nameAnalysis(NameIndex * names){
+	myRetType->nameAnalysis(names);
+	names->enterFn();
+	for (auto formal : *myFormals){ formal->nameAnalysis(names); }
+	for (auto stmt : *myBody){ stmt->nameAnalysis(names); }
+	names->leaveFn();
+}
+
+void ClassDefnNode::nameAnalysis(NameIndex * names){
+	names->enterClass(myID);
+	for (auto member : *myMembers){ member->nameAnalysis(names); }
+	names->leaveClass();
+}
+
+/** Types **/
+
+void TypeNode::nameAnalysis(NameIndex * names){ }
+
+std::string TypeNode::className(){
+	return "";
+}
+
+void ClassTypeNode::nameAnalysis(NameIndex * names){
+	names->useType(myID);
+}
+
+std::string ClassTypeNode::className(){
+	return myID->getName();
+}
+
+void ImmutableTypeNode::nameAnalysis(NameIndex * names){
+	mySub->nameAnalysis(names);
+}
+
+std::string ImmutableTypeNode::className(){
+	return mySub->className();
+}
+
+void RefTypeNode::nameAnalysis(NameIndex * names){
+	mySub->nameAnalysis(names);
+}
+
+std::string RefTypeNode::className(){
+	return mySub->className();
+}
+
+/** Statements **/
+
+static void analyzeBlock(NameIndex * names, std::list<StmtNode *> * body){
+	names->enterScope();
+	for (auto stmt : *body){ stmt->nameAnalysis(names); }
+	names->leaveScope();
+}
+
+void AssignStmtNode::nameAnalysis(NameIndex * names){
+	myDst->nameAnalysis(names);
+	mySrc->nameAnalysis(names);
+}
+
+void CallStmtNode::nameAnalysis(NameIndex * names){
+	myCallExp->nameAnalysis(names);
+}
+
+void ReturnStmtNode::nameAnalysis(NameIndex * names){
+	if (myExp != nullptr){ myExp->nameAnalysis(names); }
+}
+
+void MaybeStmtNode::nameAnalysis(NameIndex * names){
+	myDst->nameAnalysis(names);
+	mySrc1->nameAnalysis(names);
+	mySrc2->nameAnalysis(names);
+}
+
+void FromConsoleStmtNode::nameAnalysis(NameIndex * names){
+	myDst->nameAnalysis(names);
+}
+
+void ToConsoleStmtNode::nameAnalysis(NameIndex * names){
+	mySrc->nameAnalysis(names);
+}
+
+void PostDecStmtNode::nameAnalysis(NameIndex * names){
+	myLoc->nameAnalysis(names);
+}
+
+void PostIncStmtNode::nameAnalysis(NameIndex * names){
+	myLoc->nameAnalysis(names);
+}
+
+void IfStmtNode::nameAnalysis(NameIndex * names){
+	myCond->nameAnalysis(names);
+	analyzeBlock(names, myBody);
+}
+
+void IfElseStmtNode::nameAnalysis(NameIndex * names){
+	myCond->nameAnalysis(names);
+	analyzeBlock(names, myBodyTrue);
+	analyzeBlock(names, myBodyFalse);
+}
+
+void WhileStmtNode::nameAnalysis(NameIndex * names){
+	myCond->nameAnalysis(names);
+	analyzeBlock(names, myBody);
+}
+
+/** Expressions **/
+
+const NameDecl * ExpNode::nameAnalysis(NameIndex * names){
+	return nullptr;
+}
+
+const NameDecl * IDNode::nameAnalysis(NameIndex * names){
+	return names->use(this);
+}
+
+const NameDecl * MemberFieldExpNode::nameAnalysis(NameIndex * names){
+	return names->useMember(myBase->nameAnalysis(names), myField);
+}
+
+const NameDecl * CallExpNode::nameAnalysis(NameIndex * names){
+	myCallee->nameAnalysis(names);
+	for (auto arg : *myArgs){ arg->nameAnalysis(names); }
+	return nullptr;
+}
+
+const NameDecl * BinaryExpNode::nameAnalysis(NameIndex * names){
+	myExp1->nameAnalysis(names);
+	myExp2->nameAnalysis(names);
+	return nullptr;
+}
+
+const NameDecl * UnaryExpNode::nameAnalysis(NameIndex * names){
+	myExp->nameAnalysis(names);
+	return nullptr;
+}
+
+} // End namespace a_lang
@@ -0,0 +1,182 @@
+#ifndef A_LANG_NAMES_HPP
+#define A_LANG_NAMES_HPP
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+#include "errors.hpp"
+
+namespace a_lang{
+
+/** Something a name can refer to **/
+class NameDecl{
+public:
+	NameDecl(std::string nameIn, std::string kindIn, std::string typeIn,
+	  std::string clsIn, Position atIn, Position wholeIn)
+	: name(nameIn), kind(kindIn), type(typeIn), cls(clsIn),
+	  at(atIn), whole(wholeIn){ }
+	std::string name;
+	/** "variable", "parameter", "function", "class", "field"
+	 * or "method" **/
+	std::string kind;
+	/** The type as written, e.g. "int" or "(a : int) -> bool" **/
+	std::string type;
+	/** The class of a name of custom type, for member access **/
+	std::string cls;
+	/** Where the name is declared **/
+	Position at;
+	/** The whole declaration **/
+	Position whole;
+	/** The module it is declared in, if it was imported; at and
+	 * whole are then places in that file **/
+	std::string file;
+	/** The fields and methods of a class, in order **/
+	std::vector<const NameDecl *> members;
+};
+
+/** An occurrence of a name, and what it refers to **/
+class NameUse{
+public:
+	NameUse(Position atIn, const NameDecl * declIn)
+	: at(atIn), decl(declIn){ }
+	Position at;
+	const NameDecl * decl;
+};
+
+class NameTable;
+
+/** Name analysis of a program, for tools that need to know
+ * what each name refers to (see lsp.cpp). The program may come
+ * in pieces parsed separately, each with its own line numbers
+ * starting at 1: pass each piece's line offset in.
+ *
+ * A program whose pieces change one at a time can instead give
+ * each piece two indexes: one that only declares its globals,
+ * and one that analyzes it against a NameTable of every piece's
+ * globals. A piece's analysis then needs redoing only when the
+ * piece changes or dependsOn the names that did.
+ *
+ * Lookup follows the C backend: the enclosing blocks of a
+ * function, then its class's members, then globals. Every
+ * global is visible everywhere, wherever it is declared, and so
+ * are the globals of the modules the program imports.
+**/
+class NameIndex{
+public:
+	/** Globals, types and members are looked up in table if
+	 * there is one, while analyzing, rather than among the ones
+	 * declared here **/
+	NameIndex(const NameTable * table = nullptr)
+	: myTable(table), myClass(nullptr), myFnDepth(0), myLineOffset(0),
+	  myImportAt(nullptr){ }
+	/** Make the globals of the modules a piece imports visible,
+	 * where srcPath is the program's file. Each module's source
+	 * gives the places they are declared at; if it will not
+	 * parse, its interface is used, placed at the import. A
+	 * module is declared once, however many pieces import it. **/
+	void declareImports(std::list<ImportNode *> * imports,
+	  const std::string& srcPath, size_t lineOffset);
+	/** First make every piece's globals visible... **/
+	void declareGlobals(std::list<DeclNode *> * decls, size_t lineOffset);
+	/** ...then resolve the names used in each piece **/
+	void analyze(std::list<DeclNode *> * decls, size_t lineOffset);
+
+	/* Used by the nameDeclare and nameAnalysis methods */
+	const NameDecl * declare(IDNode * id, ASTNode * whole,
+	  std::string kind, std::string type, std::string cls);
+	void declareClass(IDNode * id, ASTNode * whole);
+	const NameDecl * use(IDNode * id);
+	const NameDecl * useType(IDNode * id);
+	const NameDecl * useMember(const NameDecl * base, IDNode * field);
+	void enterClass(IDNode * id);
+	void leaveClass(){ myClass = nullptr; }
+	void enterFn();
+	void leaveFn();
+	void enterScope(){ myScopes.push_back(Scope()); }
+	void leaveScope(){ myScopes.pop_back(); }
+	bool inFn() const { return myFnDepth > 0; }
+
+	/** The declaration named at a place (1-based), by a use of
+	 * it or by the declaration itself, or nullptr **/
+	const NameDecl * lookupAt(size_t line, size_t col) const;
+	/** Where the name at a place is, if there is one **/
+	const Position * spanAt(size_t line, size_t col) const;
+	/** Top-level declarations in order, classes with members **/
+	const std::vector<const NameDecl *>& outline() const {
+		return myOutline;
+	}
+	const std::vector<Report::Diagnostic>& errors() const {
+		return myErrors;
+	}
+	const std::list<NameDecl>& decls() const { return myDecls; }
+	const std::vector<NameUse>& uses() const { return myUses; }
+	/** Whether any global or type among those given was looked
+	 * up in the table while analyzing **/
+	bool dependsOn(const std::set<std::string>& globals,
+	  const std::set<std::string>& classes) const;
+	/** Move every place here down by lines, which may be
+	 * negative, for a piece that has moved **/
+	void moveLines(std::ptrdiff_t lines);
+private:
+	friend class NameTable;
+	typedef std::map<std::string, const NameDecl *> Scope;
+	Position place(const Position * pos) const;
+	const NameDecl * findGlobal(const std::string& name);
+	NameDecl * findClass(const std::string& name);
+	const NameDecl * findMember(const std::string& cls,
+	  const std::string& name);
+	void error(const Position * pos, std::string msg);
+	void declareModule(const std::string& module,
+	  const std::string& srcPath, const Position * import);
+	std::list<NameDecl> myDecls;
+	std::vector<NameUse> myUses;
+	std::vector<const NameDecl *> myOutline;
+	std::vector<Report::Diagnostic> myErrors;
+	const NameTable * myTable;
+	/* The names looked up in myTable */
+	std::set<std::string> myGlobalUses;
+	std::set<std::string> myClassUses;
+	Scope myGlobals;
+	std::map<std::string, NameDecl *> myClasses;
+	std::map<std::string, Scope> myMembers;
+	std::vector<Scope> myScopes;
+	NameDecl * myClass;
+	int myFnDepth;
+	size_t myLineOffset;
+	std::vector<std::string> myModules;
+	/* While a module is declared: the file its places are in,
+	   and where it is imported */
+	std::string myFile;
+	const Position * myImportAt;
+};
+
+/** The globals, types and members of a program analyzed piece
+ * by piece, as declared by each piece's index in turn. A name
+ * is the first piece's to declare it; a later piece's
+ * declaration of it is reported as multiply declared. **/
+class NameTable{
+public:
+	/** Take the names a piece's index declared **/
+	void add(const NameIndex& piece);
+	/** Gather the globals and types whose declaration differs
+	 * between this table and old **/
+	void changes(const NameTable& old, std::set<std::string>& globals,
+	  std::set<std::string>& classes) const;
+	const std::vector<Report::Diagnostic>& errors() const {
+		return myErrors;
+	}
+private:
+	friend class NameIndex;
+	NameIndex::Scope myGlobals;
+	std::map<std::string, NameDecl *> myClasses;
+	/* Each type's members, in the index that declared it */
+	std::map<std::string, const NameIndex::Scope *> myMembers;
+	std::vector<Report::Diagnostic> myErrors;
+};
+
+}
+
+#endif
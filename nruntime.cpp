@@ -0,0 +1,403 @@
+#include "x64.hpp"
+
+namespace a_lang{
+
+/*
+The runtime for programs produced by the native backend: the
+C backend's runtime (see cruntime.cpp), written in assembler for
+x86-64 Linux so that no C compiler is needed. It behaves just as
+that one does, down to the PRNG's sequence for a given --seed,
+and calls only read, write, exit, time, getpid, clock_gettime,
+strcmp, strtoull and memcpy from the C library.
+
+Every function follows the System V ABI. art_fail and
+art_div_zero do not return.
+*/
+static const char * const runtime = R"ART(# Generated by ac
+	.text
+# Write rsi bytes at rdi to stdout
+art_write_all:
+	pushq %r12
+	pushq %r13
+	subq $8, %rsp
+	movq %rdi, %r12
+	movq %rsi, %r13
+1:	testq %r13, %r13
+	jle 2f
+	movl $1, %edi
+	movq %r12, %rsi
+	movq %r13, %rdx
+	call write@PLT
+	testq %rax, %rax
+	jle 2f
+	addq %rax, %r12
+	subq %rax, %r13
+	jmp 1b
+2:	addq $8, %rsp
+	popq %r13
+	popq %r12
+	ret
+
+art_flush:
+	subq $8, %rsp
+	leaq art_out(%rip), %rdi
+	movq art_out_len(%rip), %rsi
+	call art_write_all
+	movq $0, art_out_len(%rip)
+	addq $8, %rsp
+	ret
+
+# Buffer rsi bytes at rdi for stdout
+art_put_bytes:
+	pushq %r12
+	pushq %r13
+	subq $8, %rsp
+	movq %rdi, %r12
+	movq %rsi, %r13
+	movq $65536, %rax
+	subq art_out_len(%rip), %rax
+	cmpq %rax, %r13
+	jbe 1f
+	call art_flush
+	cmpq $65536, %r13
+	jbe 1f
+	movq %r12, %rdi
+	movq %r13, %rsi
+	call art_write_all
+	jmp 2f
+1:	leaq art_out(%rip), %rdi
+	addq art_out_len(%rip), %rdi
+	movq %r12, %rsi
+	movq %r13, %rdx
+	call memcpy@PLT
+	addq %r13, art_out_len(%rip)
+2:	addq $8, %rsp
+	popq %r13
+	popq %r12
+	ret
+
+art_put_int:
+	subq $40, %rsp
+	movl %edi, %eax
+	movl %edi, %ecx
+	testl %eax, %eax
+	jns 1f
+	negl %eax
+1:	leaq 32(%rsp), %rsi
+	movl $10, %r8d
+2:	xorl %edx, %edx
+	divl %r8d
+	addl $48, %edx
+	decq %rsi
+	movb %dl, (%rsi)
+	testl %eax, %eax
+	jne 2b
+	testl %ecx, %ecx
+	jns 3f
+	decq %rsi
+	movb $45, (%rsi)
+3:	leaq 32(%rsp), %rdx
+	subq %rsi, %rdx
+	movq %rsi, %rdi
+	movq %rdx, %rsi
+	call art_put_bytes
+	addq $40, %rsp
+	ret
+
+art_put_bool:
+	testl %edi, %edi
+	je 1f
+	leaq art_true(%rip), %rdi
+	movl $4, %esi
+	jmp art_put_bytes
+1:	leaq art_false(%rip), %rdi
+	movl $5, %esi
+	jmp art_put_bytes
+
+# A string is the address of its bytes, length and hash, or 0
+art_put_str:
+	testq %rdi, %rdi
+	je 1f
+	movl 8(%rdi), %esi
+	movq (%rdi), %rdi
+	jmp art_put_bytes
+1:	ret
+
+# The next input byte, or -1 at end of input. Only blocks (and
+# so only flushes pending output) when the buffer is empty.
+art_in_peek:
+	movq art_in_pos(%rip), %rax
+	cmpq art_in_len(%rip), %rax
+	jne 1f
+	subq $8, %rsp
+	call art_flush
+	xorl %edi, %edi
+	leaq art_in(%rip), %rsi
+	movl $65536, %edx
+	call read@PLT
+	addq $8, %rsp
+	testq %rax, %rax
+	jle 2f
+	movq %rax, art_in_len(%rip)
+	movq $0, art_in_pos(%rip)
+	xorl %eax, %eax
+1:	leaq art_in(%rip), %rdx
+	movzbl (%rdx,%rax), %eax
+	ret
+2:	movl $-1, %eax
+	ret
+
+art_in_skip_space:
+	subq $8, %rsp
+1:	call art_in_peek
+	cmpl $32, %eax
+	je 2f
+	cmpl $9, %eax
+	je 2f
+	cmpl $10, %eax
+	je 2f
+	cmpl $13, %eax
+	je 2f
+	addq $8, %rsp
+	ret
+2:	incq art_in_pos(%rip)
+	jmp 1b
+
+art_get_int:
+	pushq %rbx
+	pushq %r12
+	subq $8, %rsp
+	call art_in_skip_space
+	xorl %ebx, %ebx
+	xorl %r12d, %r12d
+	call art_in_peek
+	cmpl $45, %eax
+	je 1f
+	cmpl $43, %eax
+	jne 3f
+	jmp 2f
+1:	movl $1, %r12d
+2:	incq art_in_pos(%rip)
+	call art_in_peek
+3:	cmpl $48, %eax
+	jl 6f
+	cmpl $57, %eax
+	jg 6f
+4:	imull $10, %ebx, %ebx
+	leal -48(%rbx,%rax), %ebx
+	incq art_in_pos(%rip)
+	call art_in_peek
+	cmpl $48, %eax
+	jl 5f
+	cmpl $57, %eax
+	jle 4b
+5:	movl %ebx, %eax
+	testl %r12d, %r12d
+	je 7f
+	negl %eax
+7:	addq $8, %rsp
+	popq %r12
+	popq %rbx
+	ret
+6:	leaq art_msg_int(%rip), %rdi
+	movl $31, %esi
+	call art_fail
+
+art_get_bool:
+	pushq %rbx
+	subq $16, %rsp
+	call art_in_skip_space
+	xorl %ebx, %ebx
+1:	call art_in_peek
+	cmpl $32, %eax
+	jle 2f
+	cmpl $5, %ebx
+	jge 2f
+	movb %al, (%rsp,%rbx)
+	incl %ebx
+	incq art_in_pos(%rip)
+	jmp 1b
+2:	cmpl $32, %eax
+	jg 9f
+	cmpl $1, %ebx
+	jne 3f
+	cmpb $49, (%rsp)
+	je 5f
+	cmpb $48, (%rsp)
+	je 4f
+	jmp 9f
+3:	cmpl $4, %ebx
+	jne 6f
+	cmpl $0x65757274, (%rsp)
+	je 5f
+	jmp 9f
+6:	cmpl $5, %ebx
+	jne 9f
+	cmpl $0x736c6166, (%rsp)
+	jne 9f
+	cmpb $101, 4(%rsp)
+	jne 9f
+4:	xorl %eax, %eax
+	jmp 8f
+5:	movl $1, %eax
+8:	addq $16, %rsp
+	popq %rbx
+	ret
+9:	leaq art_msg_bool(%rip), %rdi
+	movl $31, %esi
+	call art_fail
+
+# Flush, then write rsi bytes at rdi to stderr and exit with 1
+art_fail:
+	pushq %r12
+	pushq %r13
+	subq $8, %rsp
+	movq %rdi, %r12
+	movq %rsi, %r13
+	call art_flush
+	movl $2, %edi
+	movq %r12, %rsi
+	movq %r13, %rdx
+	call write@PLT
+	movl $1, %edi
+	call exit@PLT
+
+art_div_zero:
+	leaq art_msg_div(%rip), %rdi
+	movl $17, %esi
+	jmp art_fail
+
+# xoshiro256**; the top bit of each draw is a random bool
+art_eh:
+	movq art_rng+8(%rip), %rax
+	leaq (%rax,%rax,4), %rdx
+	rolq $7, %rdx
+	leaq (%rdx,%rdx,8), %rdx
+	movq %rax, %rcx
+	shlq $17, %rcx
+	movq art_rng(%rip), %rsi
+	movq art_rng+16(%rip), %rdi
+	movq art_rng+24(%rip), %r8
+	xorq %rsi, %rdi
+	xorq %rax, %r8
+	xorq %rdi, %rax
+	xorq %r8, %rsi
+	xorq %rcx, %rdi
+	rolq $45, %r8
+	movq %rsi, art_rng(%rip)
+	movq %rax, art_rng+8(%rip)
+	movq %rdi, art_rng+16(%rip)
+	movq %r8, art_rng+24(%rip)
+	shrq $63, %rdx
+	movl %edx, %eax
+	ret
+
+# art_init(argc, argv): seed the PRNG, from --seed <n> if given
+art_init:
+	pushq %rbx
+	pushq %r12
+	pushq %r13
+	pushq %r14
+	subq $24, %rsp
+	movl %edi, %ebx
+	movq %rsi, %r12
+	xorl %edi, %edi
+	call time@PLT
+	movq %rax, %r14
+# Mix in the pid and CLOCK_MONOTONIC's nanoseconds, as the C
+# runtime does, so that runs in the same second differ
+	call getpid@PLT
+	cltq
+	shlq $32, %rax
+	xorq %rax, %r14
+	movl $1, %edi
+	movq %rsp, %rsi
+	call clock_gettime@PLT
+	imulq $1000000000, (%rsp), %rax
+	addq 8(%rsp), %rax
+	xorq %rax, %r14
+	movl $1, %r13d
+1:	leal 1(%r13), %eax
+	cmpl %ebx, %eax
+	jge 3f
+	movq (%r12,%r13,8), %rdi
+	leaq art_seed_flag(%rip), %rsi
+	call strcmp@PLT
+	testl %eax, %eax
+	jne 2f
+	movq 8(%r12,%r13,8), %rdi
+	xorl %esi, %esi
+	xorl %edx, %edx
+	call strtoull@PLT
+	movq %rax, %r14
+2:	incl %r13d
+	jmp 1b
+3:	leaq art_rng(%rip), %rsi
+	xorl %ecx, %ecx
+	movabsq $0x9E3779B97F4A7C15, %r8
+	movabsq $0xBF58476D1CE4E5B9, %r9
+	movabsq $0x94D049BB133111EB, %r10
+4:	addq %r8, %r14
+	movq %r14, %rax
+	movq %rax, %rdx
+	shrq $30, %rdx
+	xorq %rdx, %rax
+	imulq %r9, %rax
+	movq %rax, %rdx
+	shrq $27, %rdx
+	xorq %rdx, %rax
+	imulq %r10, %rax
+	movq %rax, %rdx
+	shrq $31, %rdx
+	xorq %rdx, %rax
+	movq %rax, (%rsi,%rcx,8)
+	incq %rcx
+	cmpq $4, %rcx
+	jl 4b
+	addq $24, %rsp
+	popq %r14
+	popq %r13
+	popq %r12
+	popq %rbx
+	ret
+
+art_exit:
+	jmp art_flush
+
+	.section .rodata
+art_true:
+	.ascii "true"
+art_false:
+	.ascii "false"
+art_seed_flag:
+	.asciz "--seed"
+art_msg_int:
+	.ascii "Expected an int on the console\n"
+art_msg_bool:
+	.ascii "Expected a bool on the console\n"
+art_msg_div:
+	.ascii "Division by zero\n"
+
+	.bss
+	.align 16
+art_out:
+	.zero 65536
+art_in:
+	.zero 65536
+	.align 8
+art_out_len:
+	.zero 8
+art_in_pos:
+	.zero 8
+art_in_len:
+	.zero 8
+art_rng:
+	.zero 32
+
+)ART";
+
+void emitX64Runtime(std::ostream& out){
+	out << runtime;
+}
+
+}
@@ -0,0 +1,93 @@
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <utility>
+#include "relex.hpp"
+
+/*
+Checks incremental relexing against lexing from scratch. Each
+file named on the command line gets a run of random edits, made
+with LexedText::edit, and after every one the tokens, lexical
+errors and line starts must be just what a fresh LexedText of
+the edited text has. The edits are drawn from a fixed seed, so
+a failure can be replayed.
+*/
+
+using a_lang::LexedText;
+
+static const int editsPerFile = 2000;
+
+static const char * const snippets[] = {
+	"", "x", "\n", "a : int;\n", "\"str", "\"ok\"", "{", "}\n\n",
+	"# c\n", "$", "12", "\n\n x\n", "main : () -> int {\n\treturn 0;\n}\n",
+};
+
+/* Where a and b differ, or "" if they don't */
+static std::string difference(const LexedText& a, const LexedText& b){
+	if (a.text() != b.text()){ return "text"; }
+	if (a.lineCount() != b.lineCount()){ return "line count"; }
+	for (size_t line = 0; line <= a.lineCount(); line++){
+		if (a.lineStart(line) != b.lineStart(line)){
+			return "start of line " + std::to_string(line);
+		}
+	}
+	if (a.tokens().size() != b.tokens().size()){ return "token count"; }
+	for (size_t i = 0; i < a.tokens().size(); i++){
+		const a_lang::LexedToken& x = a.tokens()[i];
+		const a_lang::LexedToken& y = b.tokens()[i];
+		if (x.kind != y.kind || x.line != y.line || x.col != y.col
+		  || x.colEnd != y.colEnd){
+			return "token " + std::to_string(i);
+		}
+	}
+	if (a.errors().size() != b.errors().size()){ return "error count"; }
+	for (size_t i = 0; i < a.errors().size(); i++){
+		if (a.errors()[i].pos.span() != b.errors()[i].pos.span()
+		  || a.errors()[i].msg != b.errors()[i].msg){
+			return "error " + std::to_string(i);
+		}
+	}
+	return "";
+}
+
+static bool check(const char * path){
+	std::ifstream in(path);
+	if (!in.good()){
+		std::cout << path << ": cannot read\n";
+		return false;
+	}
+	std::stringstream contents;
+	contents << in.rdbuf();
+	LexedText text(contents.str());
+	std::mt19937 rng(42);
+	const size_t nSnippets = sizeof snippets / sizeof snippets[0];
+	for (int i = 0; i < editsPerFile; i++){
+		// Ranges may run past the ends of lines and of the text
+		size_t startLine = rng() % (text.lineCount() + 1);
+		size_t endLine = startLine + (rng() % 8 == 0 ? rng() % 3 : 0);
+		size_t startCol = rng() % 16;
+		size_t endCol = rng() % 16;
+		if (endLine == startLine && endCol < startCol){
+			std::swap(startCol, endCol);
+		}
+		text.edit(startLine, startCol, endLine, endCol,
+		  snippets[rng() % nSnippets]);
+		std::string diff = difference(text, LexedText(text.text()));
+		if (!diff.empty()){
+			std::cout << path << ": edit " << i << " left the "
+			  << diff << " different\n";
+			return false;
+		}
+	}
+	std::cout << path << ": ok\n";
+	return true;
+}
+
+int main(int argc, char ** argv){
+	bool ok = true;
+	for (int i = 1; i < argc; i++){
+		ok = check(argv[i]) && ok;
+	}
+	return ok ? 0 : 1;
+}
@@ -1,7 +1,9 @@
 #ifndef A_LANG_POSITION_H
 #define A_LANG_POSITION_H
 
+#include <cstddef>
 #include <string>
+#include "arena.hpp"
 
 namespace a_lang{
 
@@ -14,12 +16,29 @@ public:
 	: myLineI(start->myLineI), myColI(start->myColI),
 	  myLineE(end->myLineE),myColE(end->myColE){
 	}
+	virtual ~Position(){ }
+	/* Positions made with new belong to the current arena */
+	static void * operator new(size_t size){
+		void * p = ::operator new(size);
+		AstArena::track(static_cast<Position *>(p));
+		if (AstArena::current() != nullptr){
+			AstArena::current()->positions().push_back(
+			  static_cast<Position *>(p));
+		}
+		return p;
+	}
+	static void operator delete(void * p){ ::operator delete(p); }
 	virtual void expand(const Position * start, const Position * end){
 	  myLineI = start->myLineI;
 	  myColI = start->myColI;
 	  myLineE = end->myLineE;
 	  myColE = end->myColE;
 	}
+	/** Move down by lines, which may be negative **/
+	void moveLines(std::ptrdiff_t lines){
+		myLineI = static_cast<size_t>(static_cast<std::ptrdiff_t>(myLineI) + lines);
+		myLineE = static_cast<size_t>(static_cast<std::ptrdiff_t>(myLineE) + lines);
+	}
 	virtual std::string begin() const{
 		std::string result = "[" 
 		+ std::to_string(myLineI)
@@ -37,6 +56,10 @@ public:
 		+ "]";
 		return result;
 	}
+	size_t line() const { return myLineI; }
+	size_t col() const { return myColI; }
+	size_t lineEnd() const { return myLineE; }
+	size_t colEnd() const { return myColE; }
 private:
 	size_t myLineI;
 	size_t myColI;
@@ -0,0 +1,683 @@
+#include <algorithm>
+#include <climits>
+#include <list>
+#include <map>
+#include "regalloc.hpp"
+
+namespace a_lang{
+
+/*
+Linear scan register allocation with interval splitting, after
+Wimmer and Mossenbock's "Optimized Interval Splitting in a Linear
+Scan Register Allocator". Each register's live interval is the
+ranges of positions it is live over. Intervals are visited in
+order of start, each taking a register that is free for as long
+as it lives, or for a prefix of that, after which the rest is
+split off and visited later.
+
+When no register is free, what is spilled is what costs least:
+each use counts ten times more for each loop it is inside, so a
+value used in an inner loop takes the register of one that is
+only used outside it. A value spilled ahead of a loop it is used
+in is split again at the loop's head, to be reloaded there if a
+register is free.
+
+A split register is in different places over its life, so fn is
+rewritten to make each part of its interval a register of its
+own. A COPY goes where one part follows another inside a block,
+and COPYs go on the edges between blocks where a value is in
+different places at either end; a critical edge is given a block
+of its own for them.
+
+Instruction i reads its operands at position 4i, a call clobbers
+registers at 4i + 1, and results are written at 4i + 2. So an
+operand's register may be reused for the result, and values live
+across a call keep out of the registers that it clobbers.
+Registers defined once, by a CONST, are left out altogether.
+*/
+
+static int usePos(size_t i){ return static_cast<int>(4 * i); }
+static int defPos(size_t i){ return static_cast<int>(4 * i + 2); }
+
+static std::vector<IrReg> inputsOf(const IrInstr& instr){
+	std::vector<IrReg> inputs;
+	if (instr.a >= 0){ inputs.push_back(instr.a); }
+	if (instr.b >= 0){ inputs.push_back(instr.b); }
+	for (IrReg arg : instr.args){ inputs.push_back(arg); }
+	return inputs;
+}
+
+/* The positions from (inclusive) to to (exclusive) */
+class LiveRange{
+public:
+	LiveRange(int fromIn, int toIn) : from(fromIn), to(toIn){ }
+	int from;
+	int to;
+};
+
+/* The live interval of a register of fn, or of part of one, or
+   (where fixed) the positions a machine register is clobbered */
+class Interval{
+public:
+	Interval(IrReg vregIn, IrReg originalIn, int regIn, bool fixedIn)
+	: vreg(vregIn), original(originalIn), reg(regIn), fixed(fixedIn),
+	  moveIn(false){ }
+	int start() const { return ranges.front().from; }
+	int end() const { return ranges.back().to; }
+	bool covers(int pos) const {
+		for (auto& range : ranges){
+			if (range.from <= pos && pos < range.to){ return true; }
+		}
+		return false;
+	}
+	/* The first position both cover, or INT_MAX */
+	int intersection(const Interval& other) const {
+		size_t j = 0;
+		size_t k = 0;
+		while (j < ranges.size() && k < other.ranges.size()){
+			const LiveRange& mine = ranges[j];
+			const LiveRange& theirs = other.ranges[k];
+			int from = std::max(mine.from, theirs.from);
+			if (from < std::min(mine.to, theirs.to)){ return from; }
+			if (mine.to < theirs.to){ j++; } else { k++; }
+		}
+		return INT_MAX;
+	}
+	/* Ranges are added back to front, as code is walked
+	   backwards */
+	void addRange(int from, int to){
+		if (!ranges.empty() && to >= ranges.front().from){
+			ranges.front().from = std::min(ranges.front().from, from);
+			ranges.front().to = std::max(ranges.front().to, to);
+		} else {
+			ranges.insert(ranges.begin(), LiveRange(from, to));
+		}
+	}
+	void define(int pos){
+		if (!ranges.empty() && ranges.front().from <= pos){
+			ranges.front().from = pos;
+		} else {
+			ranges.insert(ranges.begin(), LiveRange(pos, pos + 1));
+		}
+	}
+	IrReg vreg;
+	IrReg original;
+	/* The register, or -1 for memory */
+	int reg;
+	bool fixed;
+	/* Whether the value flows in from the part before, at start */
+	bool moveIn;
+	std::vector<LiveRange> ranges;
+	/* Where the register is used or defined, in order */
+	std::vector<int> uses;
+};
+
+/* A basic block: code from start to end (exclusive) */
+class Block{
+public:
+	Block(size_t startIn) : start(startIn), end(startIn), depth(0), head(-1){ }
+	size_t start;
+	size_t end;
+	std::vector<size_t> succs;
+	std::vector<size_t> preds;
+	std::vector<bool> liveIn;
+	std::vector<bool> liveOut;
+	/* How many loops it is in, and where the innermost starts */
+	int depth;
+	int head;
+};
+
+typedef std::vector<std::pair<Interval *, Interval *>> Moves;
+
+class LinearScan{
+public:
+	LinearScan(IrFunction& fn, const RegFile& file);
+	RegAssignment run();
+private:
+	void findBlocks();
+	void findLiveness();
+	void buildIntervals();
+	void allocate();
+	bool allocateFree(Interval * current);
+	void allocateBlocked(Interval * current);
+	void spill(Interval * interval);
+	Interval * split(Interval * interval, int pos);
+	Interval * partAt(IrReg vreg, int pos);
+	const Block& blockAt(int pos){
+		size_t i = std::min(static_cast<size_t>(pos / 4), myFn.code.size() - 1);
+		return myBlocks[myBlockOf[i]];
+	}
+	int64_t weight(const Interval * interval, int from, int to);
+	int where(Interval * part);
+	void emitMoves(Moves moves, std::vector<IrInstr>& out);
+	std::vector<IrInstr> rewrite();
+
+	IrFunction& myFn;
+	const RegFile& myFile;
+	size_t myRegs;
+	size_t myArgsEnd;
+	std::vector<bool> myConst;
+	std::vector<std::pair<IrReg, int>> myHints;
+	std::vector<Block> myBlocks;
+	std::vector<size_t> myBlockOf;
+	std::list<Interval> myIntervals;
+	/* The parts of each register's interval, in order */
+	std::vector<std::vector<Interval *>> myParts;
+	std::multimap<int, Interval *> myUnhandled;
+	std::vector<Interval *> myActive;
+	std::vector<Interval *> myInactive;
+	std::map<IrReg, int> mySlots;
+};
+
+LinearScan::LinearScan(IrFunction& fn, const RegFile& file)
+: myFn(fn), myFile(file), myRegs(fn.wide.size()), myArgsEnd(0),
+  myConst(fn.wide.size(), false),
+  myHints(fn.wide.size(), std::make_pair(-1, 0)), myParts(fn.wide.size()){
+	std::vector<int> defs(myRegs, 0);
+	for (size_t i = 0; i < fn.code.size(); i++){
+		const IrInstr& instr = fn.code[i];
+		if (instr.op == IrOp::ARG && myArgsEnd == i){ myArgsEnd = i + 1; }
+		if (instr.dst < 0){ continue; }
+		size_t dst = static_cast<size_t>(instr.dst);
+		defs[dst]++;
+		myConst[dst] = instr.op == IrOp::CONST;
+		if (instr.op == IrOp::COPY){ myHints[dst] = std::make_pair(instr.a, usePos(i)); }
+	}
+	for (size_t r = 0; r < myRegs; r++){
+		myConst[r] = myConst[r] && defs[r] == 1;
+	}
+}
+
+void LinearScan::findBlocks(){
+	const std::vector<IrInstr>& code = myFn.code;
+	std::map<int64_t, size_t> byLabel;
+	for (size_t i = 0; i < code.size(); i++){
+		if (i == 0 || code[i].op == IrOp::LABEL || code[i - 1].isJump()){
+			myBlocks.push_back(Block(i));
+		}
+		if (code[i].op == IrOp::LABEL){ byLabel[code[i].imm] = myBlocks.size() - 1; }
+		myBlockOf.push_back(myBlocks.size() - 1);
+		myBlocks.back().end = i + 1;
+	}
+	for (size_t b = 0; b < myBlocks.size(); b++){
+		const IrInstr& last = code[myBlocks[b].end - 1];
+		std::vector<size_t>& succs = myBlocks[b].succs;
+		if (last.op == IrOp::JUMP || last.op == IrOp::BRANCH){
+			succs.push_back(byLabel[last.imm]);
+			if (last.op == IrOp::BRANCH && last.imm2 != last.imm){
+				succs.push_back(byLabel[last.imm2]);
+			}
+		} else if (last.op != IrOp::RET && b + 1 < myBlocks.size()){
+			succs.push_back(b + 1);
+		}
+		for (size_t succ : succs){
+			myBlocks[succ].preds.push_back(b);
+			// An edge back is a loop, of the blocks it spans
+			if (succ > b){ continue; }
+			for (size_t k = succ; k <= b; k++){
+				myBlocks[k].depth++;
+				myBlocks[k].head = std::max(myBlocks[k].head,
+				  usePos(myBlocks[succ].start));
+			}
+		}
+	}
+}
+
+void LinearScan::findLiveness(){
+	std::vector<std::vector<bool>> gen(myBlocks.size());
+	std::vector<std::vector<bool>> kill(myBlocks.size());
+	for (size_t b = 0; b < myBlocks.size(); b++){
+		Block& block = myBlocks[b];
+		gen[b].assign(myRegs, false);
+		kill[b].assign(myRegs, false);
+		block.liveIn.assign(myRegs, false);
+		block.liveOut.assign(myRegs, false);
+		for (size_t i = block.start; i < block.end; i++){
+			const IrInstr& instr = myFn.code[i];
+			for (IrReg r : inputsOf(instr)){
+				size_t reg = static_cast<size_t>(r);
+				if (!myConst[reg] && !kill[b][reg]){ gen[b][reg] = true; }
+			}
+			if (instr.dst >= 0){ kill[b][static_cast<size_t>(instr.dst)] = true; }
+		}
+	}
+	for (bool changed = true; changed; ){
+		changed = false;
+		for (size_t b = myBlocks.size(); b-- > 0; ){
+			Block& block = myBlocks[b];
+			for (size_t succ : block.succs){
+				for (size_t r = 0; r < myRegs; r++){
+					if (myBlocks[succ].liveIn[r]){ block.liveOut[r] = true; }
+				}
+			}
+			for (size_t r = 0; r < myRegs; r++){
+				bool in = gen[b][r] || (block.liveOut[r] && !kill[b][r]);
+				if (in && !block.liveIn[r]){
+					block.liveIn[r] = true;
+					changed = true;
+				}
+			}
+		}
+	}
+}
+
+void LinearScan::buildIntervals(){
+	for (size_t r = 0; r < myRegs; r++){
+		IrReg vreg = static_cast<IrReg>(r);
+		myIntervals.push_back(Interval(vreg, vreg, -1, false));
+		myParts[r].push_back(&myIntervals.back());
+	}
+	for (size_t b = myBlocks.size(); b-- > 0; ){
+		const Block& block = myBlocks[b];
+		int from = usePos(block.start);
+		for (size_t r = 0; r < myRegs; r++){
+			if (block.liveOut[r]){ myParts[r].front()->addRange(from, usePos(block.end)); }
+		}
+		for (size_t i = block.end; i-- > block.start; ){
+			const IrInstr& instr = myFn.code[i];
+			size_t dst = static_cast<size_t>(instr.dst);
+			if (instr.dst >= 0 && !myConst[dst]){
+				// Arguments all arrive at once
+				int pos = defPos(instr.op == IrOp::ARG ? myArgsEnd - 1 : i);
+				myParts[dst].front()->define(pos);
+				myParts[dst].front()->uses.push_back(pos);
+			}
+			for (IrReg r : inputsOf(instr)){
+				Interval * interval = myParts[static_cast<size_t>(r)].front();
+				if (myConst[static_cast<size_t>(r)]){ continue; }
+				interval->addRange(from, usePos(i) + 1);
+				interval->uses.push_back(usePos(i));
+			}
+		}
+	}
+	for (auto& interval : myIntervals){
+		std::sort(interval.uses.begin(), interval.uses.end());
+	}
+
+	// Calls clobber the registers not preserved across them
+	for (size_t k = myFile.preserved; k < myFile.regs.size(); k++){
+		myIntervals.push_back(Interval(-1, -1, myFile.regs[k], true));
+		Interval& fixed = myIntervals.back();
+		for (size_t i = 0; i < myFn.code.size(); i++){
+			if (myFn.code[i].op != IrOp::CALL){ continue; }
+			fixed.ranges.push_back(LiveRange(usePos(i) + 1, usePos(i) + 2));
+		}
+		if (!fixed.ranges.empty()){ myInactive.push_back(&fixed); }
+	}
+}
+
+Interval * LinearScan::partAt(IrReg vreg, int pos){
+	for (Interval * part : myParts[static_cast<size_t>(vreg)]){
+		if (part->covers(pos)){ return part; }
+	}
+	return nullptr;
+}
+
+int64_t LinearScan::weight(const Interval * interval, int from, int to){
+	int64_t total = 0;
+	for (int use : interval->uses){
+		if (use < from || use >= to){ continue; }
+		int64_t cost = 1;
+		for (int depth = std::min(blockAt(use).depth, 6); depth > 0; depth--){
+			cost *= 10;
+		}
+		total += cost;
+	}
+	return total;
+}
+
+/* Split interval at pos, which it lives past, returning the part
+   from pos on */
+Interval * LinearScan::split(Interval * interval, int pos){
+	IrReg original = interval->original;
+	IrReg vreg = myFn.newReg(myFn.wide[static_cast<size_t>(original)]);
+	myIntervals.push_back(Interval(vreg, original, -1, false));
+	Interval * part = &myIntervals.back();
+	part->moveIn = interval->covers(pos - 1) && interval->covers(pos);
+	std::vector<LiveRange> kept;
+	for (auto& range : interval->ranges){
+		if (range.to <= pos){
+			kept.push_back(range);
+		} else if (range.from >= pos){
+			part->ranges.push_back(range);
+		} else {
+			kept.push_back(LiveRange(range.from, pos));
+			part->ranges.push_back(LiveRange(pos, range.to));
+		}
+	}
+	interval->ranges = kept;
+	auto firstMoved = std::lower_bound(interval->uses.begin(),
+	  interval->uses.end(), pos);
+	part->uses.assign(firstMoved, interval->uses.end());
+	interval->uses.erase(firstMoved, interval->uses.end());
+	std::vector<Interval *>& parts = myParts[static_cast<size_t>(original)];
+	parts.insert(std::find(parts.begin(), parts.end(), interval) + 1, part);
+	return part;
+}
+
+void LinearScan::allocate(){
+	for (size_t r = 0; r < myRegs; r++){
+		Interval * interval = myParts[r].front();
+		if (myConst[r] || interval->ranges.empty()){ continue; }
+		myUnhandled.insert(std::make_pair(interval->start(), interval));
+	}
+	while (!myUnhandled.empty()){
+		Interval * current = myUnhandled.begin()->second;
+		myUnhandled.erase(myUnhandled.begin());
+		int pos = current->start();
+		std::vector<Interval *> active;
+		std::vector<Interval *> inactive;
+		for (auto list : { &myActive, &myInactive }){
+			for (Interval * interval : *list){
+				if (interval->end() <= pos){ continue; }
+				(interval->covers(pos) ? active : inactive).push_back(interval);
+			}
+		}
+		myActive = active;
+		myInactive = inactive;
+		if (!allocateFree(current)){ allocateBlocked(current); }
+		if (current->reg >= 0){ myActive.push_back(current); }
+	}
+}
+
+/* Give current a register that is free for all of it, or else
+   for as long a prefix as any is */
+bool LinearScan::allocateFree(Interval * current){
+	int pos = current->start();
+	std::map<int, int> freeUntil;
+	for (int reg : myFile.regs){ freeUntil[reg] = INT_MAX; }
+	for (Interval * interval : myActive){ freeUntil[interval->reg] = 0; }
+	for (Interval * interval : myInactive){
+		int& until = freeUntil[interval->reg];
+		until = std::min(until, interval->intersection(*current));
+	}
+	// Ties go to the registers calls clobber, which cost nothing to
+	// save where there are no calls
+	int best = myFile.regs.back();
+	for (size_t k = myFile.regs.size(); k-- > 0; ){
+		int reg = myFile.regs[k];
+		if (freeUntil[reg] > freeUntil[best]){ best = reg; }
+	}
+
+	// A copy's result is best where its operand was
+	std::pair<IrReg, int> hint = myHints[static_cast<size_t>(current->original)];
+	if (hint.first >= 0 && current == myParts[static_cast<size_t>(current->original)].front()){
+		Interval * source = partAt(hint.first, hint.second);
+		if (source != nullptr && freeUntil.count(source->reg) != 0
+		  && (freeUntil[source->reg] >= current->end()
+		  || freeUntil[source->reg] >= freeUntil[best])){
+			best = source->reg;
+		}
+	}
+
+	int until = freeUntil[best];
+	if (until <= pos){ return false; }
+	if (until >= current->end()){
+		current->reg = best;
+		return true;
+	}
+	int at = until / 4 * 4;
+	if (at <= pos){ return false; }
+	current->reg = best;
+	Interval * rest = split(current, at);
+	myUnhandled.insert(std::make_pair(rest->start(), rest));
+	return true;
+}
+
+/* Take a register from whatever holds it for the least cost, or
+   spill current if that costs less still */
+void LinearScan::allocateBlocked(Interval * current){
+	int pos = current->start();
+	std::map<int, int64_t> cost;
+	std::map<int, int> blocked;
+	for (int reg : myFile.regs){
+		cost[reg] = 0;
+		blocked[reg] = INT_MAX;
+	}
+	for (Interval * interval : myActive){
+		if (interval->fixed){
+			blocked[interval->reg] = pos;
+		} else {
+			cost[interval->reg] += weight(interval, pos, interval->end());
+		}
+	}
+	for (Interval * interval : myInactive){
+		int& at = blocked[interval->reg];
+		at = std::min(at, interval->intersection(*current));
+	}
+	int best = -1;
+	int bestLimit = 0;
+	for (int reg : myFile.regs){
+		int limit = blocked[reg] >= current->end() ? current->end()
+		  : blocked[reg] / 4 * 4;
+		if (limit <= pos){ continue; }
+		if (best < 0 || cost[reg] < cost[best]
+		  || (cost[reg] == cost[best] && limit > bestLimit)){
+			best = reg;
+			bestLimit = limit;
+		}
+	}
+	if (best < 0 || weight(current, pos, bestLimit) <= cost[best]){
+		spill(current);
+		return;
+	}
+
+	for (size_t k = 0; k < myActive.size(); k++){
+		Interval * holder = myActive[k];
+		if (holder->reg != best){ continue; }
+		if (holder->start() >= pos){
+			myActive.erase(myActive.begin() + static_cast<std::ptrdiff_t>(k));
+			spill(holder);
+		} else {
+			spill(split(holder, pos));
+		}
+		break;
+	}
+	current->reg = best;
+	if (bestLimit < current->end()){
+		Interval * rest = split(current, bestLimit);
+		myUnhandled.insert(std::make_pair(rest->start(), rest));
+	}
+}
+
+/* Put interval in memory, up to the head of a loop it is used in
+   that it is not in already */
+void LinearScan::spill(Interval * interval){
+	interval->reg = -1;
+	int from = interval->start();
+	const Block& start = blockAt(from);
+	for (int use : interval->uses){
+		if (use <= from){ continue; }
+		const Block& block = blockAt(use);
+		if (block.depth == 0 || (block.depth <= start.depth && block.head <= from)){
+			continue;
+		}
+		int at = block.head > from ? block.head
+		  : usePos(block.start) > from ? usePos(block.start) : use / 4 * 4;
+		if (at <= from){ continue; }
+		Interval * rest = split(interval, at);
+		myUnhandled.insert(std::make_pair(rest->start(), rest));
+		return;
+	}
+}
+
+/* A register, or a negative number for a spill slot */
+int LinearScan::where(Interval * part){
+	if (part->reg >= 0){ return part->reg; }
+	auto found = mySlots.find(part->original);
+	if (found == mySlots.end()){
+		int slot = static_cast<int>(mySlots.size());
+		found = mySlots.insert(std::make_pair(part->original, slot)).first;
+	}
+	return -1 - found->second;
+}
+
+/* COPYs for moves that all read before any of them writes. A
+   cycle, which can only be of registers, is broken through a
+   spill slot. */
+void LinearScan::emitMoves(Moves moves, std::vector<IrInstr>& out){
+	moves.erase(std::remove_if(moves.begin(), moves.end(),
+	  [this](const std::pair<Interval *, Interval *>& move){
+		return where(move.first) == where(move.second);
+	  }), moves.end());
+	while (!moves.empty()){
+		bool progress = false;
+		for (size_t k = 0; k < moves.size() && !progress; k++){
+			int dst = where(moves[k].second);
+			bool read = false;
+			for (size_t j = 0; j < moves.size(); j++){
+				if (j != k && where(moves[j].first) == dst){ read = true; }
+			}
+			if (read){ continue; }
+			IrInstr copy(IrOp::COPY);
+			copy.dst = moves[k].second->vreg;
+			copy.a = moves[k].first->vreg;
+			out.push_back(copy);
+			moves.erase(moves.begin() + static_cast<std::ptrdiff_t>(k));
+			progress = true;
+		}
+		if (progress){ continue; }
+		int held = where(moves.front().second);
+		Interval * source = nullptr;
+		for (auto& move : moves){
+			if (where(move.first) == held){ source = move.first; }
+		}
+		IrReg vreg = myFn.newReg(myFn.wide[static_cast<size_t>(source->vreg)]);
+		myIntervals.push_back(Interval(vreg, vreg, -1, false));
+		Interval * temp = &myIntervals.back();
+		IrInstr copy(IrOp::COPY);
+		copy.dst = vreg;
+		copy.a = source->vreg;
+		out.push_back(copy);
+		for (auto& move : moves){
+			if (where(move.first) == held){ move.first = temp; }
+		}
+	}
+}
+
+/* fn's code with each register replaced by the part of it live
+   there, and the moves between parts */
+std::vector<IrInstr> LinearScan::rewrite(){
+	std::vector<IrInstr> code = myFn.code;
+	std::vector<Moves> before(code.size());
+	for (size_t r = 0; r < myRegs; r++){
+		std::vector<Interval *>& parts = myParts[r];
+		for (size_t k = 1; k < parts.size(); k++){
+			int start = parts[k]->start();
+			bool atBlock = start % 4 == 0
+			  && blockAt(start).start == static_cast<size_t>(start / 4);
+			if (!parts[k]->moveIn || atBlock){ continue; }
+			before[static_cast<size_t>(start / 4)].push_back(
+			  std::make_pair(partAt(static_cast<IrReg>(r), start - 1), parts[k]));
+		}
+	}
+
+	// Moves on edges: at the end of a block with one successor,
+	// else at the start of a block with one predecessor, else in a
+	// block of their own
+	std::vector<Moves> atEnd(myBlocks.size());
+	std::vector<Moves> atStart(myBlocks.size());
+	std::vector<std::pair<int, Moves>> stubs;
+	std::vector<int64_t> stubTargets;
+	for (size_t b = 0; b < myBlocks.size(); b++){
+		const Block& block = myBlocks[b];
+		for (size_t p : block.preds){
+			const Block& pred = myBlocks[p];
+			Moves moves;
+			for (size_t r = 0; r < myRegs; r++){
+				if (!block.liveIn[r] || myConst[r]){ continue; }
+				IrReg vreg = static_cast<IrReg>(r);
+				Interval * from = partAt(vreg, usePos(pred.end) - 1);
+				Interval * to = partAt(vreg, usePos(block.start));
+				if (where(from) != where(to)){ moves.push_back(std::make_pair(from, to)); }
+			}
+			if (moves.empty()){ continue; }
+			IrInstr& last = code[pred.end - 1];
+			if (pred.succs.size() == 1 && last.op != IrOp::BRANCH){
+				atEnd[p] = moves;
+			} else if (block.preds.size() == 1){
+				atStart[b] = moves;
+			} else {
+				int64_t target = code[block.start].imm;
+				int label = myFn.newLabel();
+				if (last.imm == target){ last.imm = label; }
+				if (last.imm2 == target){ last.imm2 = label; }
+				stubs.push_back(std::make_pair(label, moves));
+				stubTargets.push_back(target);
+			}
+		}
+	}
+
+	std::vector<IrInstr> out;
+	for (size_t b = 0; b < myBlocks.size(); b++){
+		const Block& block = myBlocks[b];
+		for (size_t i = block.start; i < block.end; i++){
+			IrInstr instr = code[i];
+			for (IrReg * r : { &instr.a, &instr.b }){
+				if (*r >= 0 && !myConst[static_cast<size_t>(*r)]){
+					*r = partAt(*r, usePos(i))->vreg;
+				}
+			}
+			for (IrReg& r : instr.args){
+				if (!myConst[static_cast<size_t>(r)]){ r = partAt(r, usePos(i))->vreg; }
+			}
+			if (instr.dst >= 0 && !myConst[static_cast<size_t>(instr.dst)]){
+				int pos = defPos(instr.op == IrOp::ARG ? myArgsEnd - 1 : i);
+				instr.dst = partAt(instr.dst, pos)->vreg;
+			}
+			emitMoves(before[i], out);
+			if (instr.isJump()){ emitMoves(atEnd[b], out); }
+			out.push_back(instr);
+			if (i == block.start && instr.op == IrOp::LABEL){
+				emitMoves(atStart[b], out);
+			}
+		}
+		if (!code[block.end - 1].isJump()){ emitMoves(atEnd[b], out); }
+	}
+	for (size_t k = 0; k < stubs.size(); k++){
+		IrInstr label(IrOp::LABEL);
+		label.imm = stubs[k].first;
+		out.push_back(label);
+		emitMoves(stubs[k].second, out);
+		IrInstr jump(IrOp::JUMP);
+		jump.imm = stubTargets[k];
+		out.push_back(jump);
+	}
+	return out;
+}
+
+RegAssignment LinearScan::run(){
+	RegAssignment assignment;
+	if (!myFn.code.empty()){
+		findBlocks();
+		findLiveness();
+		buildIntervals();
+		allocate();
+		myFn.code = rewrite();
+	}
+	assignment.reg.assign(myFn.wide.size(), -1);
+	assignment.spill.assign(myFn.wide.size(), -1);
+	for (auto& interval : myIntervals){
+		// Registers never used are nowhere; temporaries of moves
+		// have no ranges but are used
+		if (interval.fixed || (interval.ranges.empty()
+		  && interval.vreg < static_cast<IrReg>(myRegs))){
+			continue;
+		}
+		size_t vreg = static_cast<size_t>(interval.vreg);
+		if (interval.original < static_cast<IrReg>(myRegs)
+		  && myConst[static_cast<size_t>(interval.original)]){
+			continue;
+		}
+		assignment.reg[vreg] = interval.reg;
+		if (interval.reg < 0){ assignment.spill[vreg] = -1 - where(&interval); }
+	}
+	assignment.spills = static_cast<int>(mySlots.size());
+	return assignment;
+}
+
+RegAssignment allocateRegs(IrFunction& fn, const RegFile& file){
+	return LinearScan(fn, file).run();
+}
+
+}
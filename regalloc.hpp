@@ -0,0 +1,40 @@
+#ifndef A_LANG_REGALLOC_HPP
+#define A_LANG_REGALLOC_HPP
+
+#include <cstddef>
+#include <vector>
+#include "ir.hpp"
+
+namespace a_lang{
+
+/** Where each register of an IrFunction lives: in a machine (or
+ * VM) register, or, where reg is -1, in spill slot spill.
+ * Registers defined once, by a CONST, live nowhere (both are -1):
+ * their value is an immediate at every use. **/
+class RegAssignment{
+public:
+	RegAssignment() : spills(0){ }
+	std::vector<int> reg;
+	std::vector<int> spill;
+	int spills;
+};
+
+/** The registers values may be kept in. The first preserved of
+ * them survive calls; every call clobbers the rest. **/
+class RegFile{
+public:
+	RegFile(std::vector<int> regsIn, size_t preservedIn)
+	: regs(regsIn), preserved(preservedIn){ }
+	std::vector<int> regs;
+	size_t preserved;
+};
+
+/** Allocate fn's registers to file by linear scan (see
+ * regalloc.cpp). A live range that cannot keep one register
+ * throughout is split, and fn is rewritten so that each part is a
+ * register of its own, with COPYs where the value changes place. **/
+RegAssignment allocateRegs(IrFunction& fn, const RegFile& file);
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <sstream>
+#include "relex.hpp"
+#include "arena.hpp"
+#include "scanner.hpp"
+
+namespace a_lang{
+
+/*
+An edit relexes from the start of its first line to the end of
+its last, in the new text. Every line starts in the scanner's
+initial state, so the new token stream rejoins the old one at
+the next line: the tokens from there on are the old ones, moved
+by however many lines the edit added or removed.
+*/
+
+static size_t newlines(const std::string& text, size_t from, size_t to){
+	return static_cast<size_t>(std::count(text.begin()
+	  + static_cast<std::ptrdiff_t>(from), text.begin()
+	  + static_cast<std::ptrdiff_t>(to), '\n'));
+}
+
+static bool beforeLine(const LexedToken& token, size_t line){
+	return token.line < line;
+}
+
+static bool errorBeforeLine(const Report::Diagnostic& error, size_t line){
+	return error.pos.line() < line;
+}
+
+static Position moved(const Position& pos, size_t from, size_t to){
+	return Position(pos.line() - from + to, pos.col(),
+	  pos.lineEnd() - from + to, pos.colEnd());
+}
+
+LexedText::LexedText(const std::string& text) : myText(text){
+	myLineStarts.push_back(0);
+	for (size_t i = 0; i < myText.size(); i++){
+		if (myText[i] == '\n'){ myLineStarts.push_back(i + 1); }
+	}
+	lex(myText, 0, myTokens, myErrors);
+}
+
+size_t LexedText::lineStart(size_t line) const{
+	if (line >= myLineStarts.size()){ return myText.size(); }
+	return myLineStarts[line];
+}
+
+size_t LexedText::offsetOf(size_t line, size_t col) const{
+	if (line >= myLineStarts.size()){ return myText.size(); }
+	size_t start = myLineStarts[line];
+	size_t end = line + 1 < myLineStarts.size()
+	  ? myLineStarts[line + 1] - 1 : myText.size();
+	return std::min(start + col, end);
+}
+
+void LexedText::lex(const std::string& text, size_t lineOffset,
+  std::vector<LexedToken>& tokens,
+  std::vector<Report::Diagnostic>& errors){
+	// Only the kinds and places of the tokens are kept
+	AstArena scanned;
+	AstArena::Scope scope(&scanned);
+	std::istringstream in(text);
+	std::vector<Report::Diagnostic> found;
+	std::vector<Report::Diagnostic> * outer = Report::collector();
+	Report::collector() = &found;
+	Scanner scanner(&in);
+	Parser::semantic_type lval;
+	for (;;){
+		int kind = scanner.yylex(&lval);
+		if (kind == Parser::token::END){ break; }
+		const Position * pos = lval.as<Token *>()->pos();
+		tokens.push_back(LexedToken(kind, pos->line() + lineOffset,
+		  pos->col(), pos->colEnd()));
+	}
+	Report::collector() = outer;
+	for (auto& error : found){
+		Position at = moved(error.pos, 0, lineOffset);
+		errors.push_back(Report::Diagnostic(&at, error.msg));
+	}
+}
+
+void LexedText::edit(size_t startLine, size_t startCol,
+  size_t endLine, size_t endCol, const std::string& newText){
+	size_t from = offsetOf(startLine, startCol);
+	size_t to = std::max(from, offsetOf(endLine, endCol));
+	startLine = std::min(startLine, myLineStarts.size() - 1);
+	size_t oldLines = newlines(myText, from, to);
+	size_t newLines = newlines(newText, 0, newText.size());
+	myText.replace(from, to - from, newText);
+
+	// Lines after the edit keep their starts, moved over
+	std::vector<size_t> fresh;
+	for (size_t i = 0; i < newText.size(); i++){
+		if (newText[i] == '\n'){ fresh.push_back(from + i + 1); }
+	}
+	auto firstGone = myLineStarts.begin()
+	  + static_cast<std::ptrdiff_t>(startLine + 1);
+	auto kept = myLineStarts.erase(firstGone,
+	  firstGone + static_cast<std::ptrdiff_t>(oldLines));
+	for (auto start = kept; start != myLineStarts.end(); ++start){
+		*start = *start - (to - from) + newText.size();
+	}
+	myLineStarts.insert(myLineStarts.begin()
+	  + static_cast<std::ptrdiff_t>(startLine + 1),
+	  fresh.begin(), fresh.end());
+
+	// Lines (from 1, as in tokens) first to last before the edit
+	// became first to last + newLines - oldLines after it
+	size_t first = startLine + 1;
+	size_t last = first + oldLines;
+	std::vector<LexedToken> tokens;
+	std::vector<Report::Diagnostic> errors;
+	size_t begin = lineStart(startLine);
+	size_t end = lineStart(startLine + newLines + 1);
+	lex(myText.substr(begin, end - begin), startLine, tokens, errors);
+
+	auto gone = std::lower_bound(myTokens.begin(), myTokens.end(),
+	  first, beforeLine);
+	auto after = std::lower_bound(gone, myTokens.end(), last + 1, beforeLine);
+	for (auto token = after; token != myTokens.end(); ++token){
+		token->line = token->line - oldLines + newLines;
+	}
+	after = myTokens.erase(gone, after);
+	myTokens.insert(after, tokens.begin(), tokens.end());
+
+	auto goneErr = std::lower_bound(myErrors.begin(), myErrors.end(),
+	  first, errorBeforeLine);
+	auto afterErr = std::lower_bound(goneErr, myErrors.end(), last + 1,
+	  errorBeforeLine);
+	for (auto error = afterErr; error != myErrors.end(); ++error){
+		error->pos = moved(error->pos, oldLines, newLines);
+	}
+	afterErr = myErrors.erase(goneErr, afterErr);
+	myErrors.insert(afterErr, errors.begin(), errors.end());
+}
+
+void LexedText::replace(const std::string& newText){
+	size_t common = std::min(myText.size(), newText.size());
+	size_t head = 0;
+	while (head < common && myText[head] == newText[head]){ head++; }
+	size_t tail = 0;
+	while (tail < common - head
+	  && myText[myText.size() - 1 - tail] == newText[newText.size() - 1 - tail]){
+		tail++;
+	}
+	if (head == myText.size() && head == newText.size()){ return; }
+	// Places are lines and columns of the text as it was
+	size_t from = newlines(myText, 0, head);
+	size_t to = newlines(myText, 0, myText.size() - tail);
+	edit(from, head - myLineStarts[from],
+	  to, myText.size() - tail - myLineStarts[to],
+	  newText.substr(head, newText.size() - tail - head));
+}
+
+std::vector<size_t> declFirstLines(const LexedText& lexed){
+	const std::vector<LexedToken>& tokens = lexed.tokens();
+	std::vector<size_t> firstLines;
+	firstLines.push_back(0);
+	size_t depth = 0;
+	for (size_t i = 0; i + 1 < tokens.size(); i++){
+		int kind = tokens[i].kind;
+		if (kind == TokenKind::LCURLY){ depth++; }
+		if (kind == TokenKind::RCURLY && depth > 0){ depth--; }
+		if (depth > 0){ continue; }
+		if (kind != TokenKind::SEMICOL && kind != TokenKind::RCURLY){
+			continue;
+		}
+		const LexedToken& next = tokens[i + 1];
+		if (kind == TokenKind::RCURLY && next.kind == TokenKind::SEMICOL){
+			continue;
+		}
+		// Token lines count from 1, so this is the next line from 0
+		if (next.line > tokens[i].line){
+			firstLines.push_back(tokens[i].line);
+		}
+	}
+	return firstLines;
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef A_LANG_RELEX_HPP
+#define A_LANG_RELEX_HPP
+
+#include <string>
+#include <vector>
+#include "errors.hpp"
+
+namespace a_lang{
+
+/** A token as kept by LexedText: its kind (a TokenKind) and
+ * where it is. Lines and columns count from 1, as in Position. **/
+class LexedToken{
+public:
+	LexedToken(int kindIn, size_t lineIn, size_t colIn, size_t colEndIn)
+	: kind(kindIn), line(lineIn), col(colIn), colEnd(colEndIn){ }
+	int kind;
+	size_t line;
+	size_t col;
+	size_t colEnd;
+};
+
+/** Source text with its tokens, kept up to date through edits
+ * by relexing only the lines an edit touches. No a-lang token
+ * (or comment) spans a newline, so each line lexes the same
+ * whatever comes before it.
+**/
+class LexedText{
+public:
+	LexedText(const std::string& text);
+	/** Replace the text between two places (lines and columns
+	 * counted from 0, as LSP does) with newText **/
+	void edit(size_t startLine, size_t startCol,
+	  size_t endLine, size_t endCol, const std::string& newText);
+	/** Make the text newText, as one edit of the part between
+	 * what the two have in common at either end **/
+	void replace(const std::string& newText);
+	const std::string& text() const { return myText; }
+	const std::vector<LexedToken>& tokens() const { return myTokens; }
+	/** Lexical errors, with their positions **/
+	const std::vector<Report::Diagnostic>& errors() const {
+		return myErrors;
+	}
+	/** The offset in text() of the start of a line (from 0) **/
+	size_t lineStart(size_t line) const;
+	size_t lineCount() const { return myLineStarts.size(); }
+private:
+	size_t offsetOf(size_t line, size_t col) const;
+	void lex(const std::string& text, size_t lineOffset,
+	  std::vector<LexedToken>& tokens,
+	  std::vector<Report::Diagnostic>& errors);
+	std::string myText;
+	std::vector<size_t> myLineStarts;
+	std::vector<LexedToken> myTokens;
+	std::vector<Report::Diagnostic> myErrors;
+};
+
+/** The first line (from 0) of each run of whole top-level
+ * declarations in lexed that can be parsed on its own. A
+ * declaration ends with a ";" or a "}" outside braces, except
+ * that a "}" followed by a ";" (the end of a class) ends at the
+ * ";". A run ends with the line a declaration ends on, unless
+ * the next token shares it. **/
+std::vector<size_t> declFirstLines(const LexedText& lexed);
+
+}
+
+#endif
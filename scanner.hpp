@@ -65,6 +65,11 @@ public:
 
    static std::string tokenKindString(int tokenKind);
 
+   /* Where scanning has got to, just past the last token */
+   virtual Position here() const {
+	return Position(lineNum, colNum, lineNum, colNum);
+   }
+
    void outputTokens(std::ostream& outstream);
 
 private:
@@ -0,0 +1,131 @@
+#include <memory>
+#include <utility>
+#include "stream.hpp"
+#include "arena.hpp"
+#include "scanner.hpp"
+
+namespace a_lang{
+
+/*
+Streaming input. One scanner reads the whole input, and its
+tokens are kept only until the top-level declaration they belong
+to is complete, which is found by the rule the language server
+uses to split a document: a ";" or "}" outside braces ends a
+declaration, unless it is the "}" before a class's ";", and the
+next declaration starts on a later line. The parser is then run
+over that declaration's tokens alone, its tree is unparsed and,
+with the tokens, freed when the next declaration is done.
+*/
+
+typedef std::vector<std::pair<int, Token *>> TokenList;
+
+/* A scanner that hands the parser tokens already scanned */
+class TokenReplay : public Scanner{
+public:
+	TokenReplay(const TokenList& tokens, Position end)
+	: Scanner(nullptr), myTokens(tokens), myNext(0), myEnd(end), myAt(end){
+	}
+	using Scanner::yylex;
+	int yylex(Parser::semantic_type * const lval) override{
+		if (myNext == myTokens.size()){
+			myAt = myEnd;
+			return Parser::token::END;
+		}
+		int kind = myTokens[myNext].first;
+		Token * token = myTokens[myNext].second;
+		myNext++;
+		const Position * pos = token->pos();
+		myAt = Position(pos->lineEnd(), pos->colEnd(),
+		  pos->lineEnd(), pos->colEnd());
+		switch (kind){
+		case Parser::token::ID:
+			lval->emplace<IDToken *>(static_cast<IDToken *>(token));
+			break;
+		case Parser::token::INTLITERAL:
+			lval->emplace<IntLitToken *>(static_cast<IntLitToken *>(token));
+			break;
+		case Parser::token::STRINGLITERAL:
+			lval->emplace<StrToken *>(static_cast<StrToken *>(token));
+			break;
+		default:
+			lval->emplace<Token *>(token);
+		}
+		return kind;
+	}
+	Position here() const override { return myAt; }
+private:
+	const TokenList& myTokens;
+	size_t myNext;
+	Position myEnd;
+	Position myAt;
+};
+
+/* Parse one declaration's tokens into arena and output it. Its
+   syntax errors are reported with their places, as the parse of
+   the rest goes on. */
+static bool emitDecl(const TokenList& tokens, Position end,
+  AstArena * arena, std::ostream * out){
+	AstArena::Scope scope(arena);
+	std::vector<Report::Diagnostic> errors;
+	std::vector<Report::Diagnostic> * outer = Report::collector();
+	Report::collector() = &errors;
+	ProgramNode * root = nullptr;
+	TokenReplay replay(tokens, end);
+	Parser parser(replay, &root);
+	int errCode = parser.parse();
+	Report::collector() = outer;
+	for (auto& error : errors){
+		Report::fatal(&error.pos, error.msg);
+	}
+	if (errCode != 0 || root == nullptr){ return false; }
+	if (out != nullptr){ root->unparse(*out, 0); }
+	return true;
+}
+
+bool streamUnparse(std::istream& in, std::ostream * out){
+	Scanner scanner(&in);
+	Parser::semantic_type lval;
+	TokenList decl;
+	// The arena of the declaration being read, and of the one
+	// before, which holds the first token of this one
+	std::unique_ptr<AstArena> arena(new AstArena());
+	std::unique_ptr<AstArena> done;
+	size_t depth = 0;
+	bool ok = true;
+	for (;;){
+		int kind;
+		{
+			AstArena::Scope scope(arena.get());
+			kind = scanner.yylex(&lval);
+		}
+		bool atEnd = kind == Parser::token::END;
+		Token * token = atEnd ? nullptr : lval.as<Token *>();
+
+		bool ended = atEnd;
+		if (!atEnd && depth == 0 && !decl.empty()){
+			int last = decl.back().first;
+			ended = token->pos()->line() > decl.back().second->pos()->lineEnd()
+			  && (last == Parser::token::SEMICOL
+			  || (last == Parser::token::RCURLY
+			  && kind != Parser::token::SEMICOL));
+		}
+		if (ended && !decl.empty()){
+			// A declaration cut short stops where the next one starts
+			Position end = atEnd ? scanner.here()
+			  : Position(token->pos()->line(), token->pos()->col(),
+			  token->pos()->line(), token->pos()->col());
+			ok = emitDecl(decl, end, arena.get(), out) && ok;
+			decl.clear();
+			done = std::move(arena);
+			arena.reset(new AstArena());
+		}
+		if (atEnd){ break; }
+
+		decl.push_back(std::make_pair(kind, token));
+		if (kind == Parser::token::LCURLY){ depth++; }
+		if (kind == Parser::token::RCURLY && depth > 0){ depth--; }
+	}
+	return ok;
+}
+
+}
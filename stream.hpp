@@ -0,0 +1,20 @@
+#ifndef A_LANG_STREAM_HPP
+#define A_LANG_STREAM_HPP
+
+#include <istream>
+#include <ostream>
+
+namespace a_lang{
+
+/** Parse the program read from in one top-level declaration at
+ * a time, writing the canonical form of each to out (unless out
+ * is null) as soon as it has parsed, then freeing it. Memory is
+ * bounded by the largest declaration, not the program, so in
+ * may be a pipe of any length. Errors are reported as usual,
+ * with lines counted through the whole input. Returns false if
+ * any declaration failed to parse; the others are still output. **/
+bool streamUnparse(std::istream& in, std::ostream * out);
+
+}
+
+#endif
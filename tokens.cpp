@@ -30,6 +30,7 @@ static std::string tokenKindString(int tokKind){
 		case TokenKind::INT: return "INT";
 		case TokenKind::INTLITERAL: return "INTLITERAL";
 		case TokenKind::IMMUTABLE: return "IMMUTABLE";
+		case TokenKind::IMPORT: return "IMPORT";
 		case TokenKind::LCURLY: return "LCURLY";
 		case TokenKind::LESS: return "LESS";
 		case TokenKind::LESSEQ: return "LESSEQ";
@@ -60,6 +61,7 @@ static std::string tokenKindString(int tokKind){
 
 Token::Token(Position * posIn, int kindIn)
   : myPos(posIn), myKind(kindIn){
+	AstArena::track(this);
 }
 
 std::string Token::toString(){
@@ -9,6 +9,7 @@ namespace a_lang{
 class Token{
 public:
 	Token(Position * pos, int kindIn);
+	virtual ~Token(){ }
 	virtual std::string toString();
 	size_t line() const;
 	size_t col() const;
@@ -23,6 +23,9 @@ of DeclNodes.
 
 
 void ProgramNode::unparse(std::ostream& out, int indent){
+	for (auto import : *myImports){
+		import->unparse(out, indent);
+	}
 	/* Oh, hey it's a for-each loop in C++!
 	   The loop iterates over each element in a collection
 	   without that gross i++ nonsense. 
@@ -40,11 +43,20 @@ void ProgramNode::unparse(std::ostream& out, int indent){
 	}
 }
 
+void ImportNode::unparse(std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << "import \"" << myPath << "\";\n";
+}
+
 void VarDeclNode::unparse(std::ostream& out, int indent){
 	doIndent(out, indent);
 	this->myID->unparse(out, 0);
 	out << ": ";
 	this->myType->unparse(out, 0);
+	if (myInit != nullptr){
+		out << " = ";
+		myInit->unparse(out, 0);
+	}
 	out << ";\n";
 }
 
@@ -390,4 +402,11 @@ void IDNode::unparse(std::ostream& out, int indent){
 	out << this->name;
 }
 
+void MemberFieldExpNode::unparse(std::ostream& out, int indent){
+	doIndent(out, indent);
+	myBase->unparse(out, 0);
+	out << "->";
+	myField->unparse(out, 0);
+}
+
 } // End namespace a_lang
@@ -0,0 +1,338 @@
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "watch.hpp"
+#include "arena.hpp"
+#include "build.hpp"
+#include "module.hpp"
+#include "relex.hpp"
+#include "scanner.hpp"
+
+namespace a_lang{
+
+/*
+Watch mode. Editors often save by writing a new file and
+renaming it over the old one, which would end a watch on the
+file itself, so each file's directory is watched instead and
+events are matched by name. A burst of events (a save is
+usually several) leads to a single rebuild, and a save that
+left every file as it was leads to none. Before each rebuild
+the inputs are found again, and any new directory among them
+is watched from then on.
+
+Builds run in this process, as the daemon's requests do, so
+what they parsed can be kept for the next. Each file is kept as
+its tokens, which a change relexes only where the text differs
+(see relex.hpp), and as chunks of whole top-level declarations,
+split as the language server splits a document. Only the chunks
+whose text changed are parsed again. A chunk's AST lives in an
+arena of its own, and when an edit above it moves it, its
+positions are moved with it, so errors and counter keys name the
+right lines. If any chunk fails to parse, the file is parsed
+whole instead, so that its errors are reported just as ac
+reports them. The program is checked and its code generated
+afresh from the ASTs on every build.
+
+The daemon keeps its requests' parses the same way (see
+keepParses). Its clients may be in any directory, so files are
+kept by absolute path, and only the most recently parsed few,
+since nothing tells it when a file stops mattering.
+
+Imported modules are brought up to date by buildModules before
+each build, which rewrites an interface or C only when its
+inputs changed, so the build reads its imports' interfaces as
+they now are.
+*/
+
+/* How long a burst of events may go quiet before rebuilding */
+static const int settleMs = 50;
+
+static std::string dirOf(const std::string& path){
+	size_t slash = path.rfind('/');
+	if (slash == std::string::npos){ return "."; }
+	if (slash == 0){ return "/"; }
+	return path.substr(0, slash);
+}
+
+static std::string baseOf(const std::string& path){
+	size_t slash = path.rfind('/');
+	if (slash == std::string::npos){ return path; }
+	return path.substr(slash + 1);
+}
+
+/* A fingerprint of the files' contents, missing files included */
+static size_t fingerprint(const std::vector<std::string>& files){
+	std::string all;
+	for (const std::string& file : files){
+		std::ifstream in(file);
+		std::stringstream contents;
+		if (in.good()){ contents << in.rdbuf(); }
+		all += std::to_string(contents.str().size()) + ":" + contents.str();
+	}
+	return std::hash<std::string>()(all);
+}
+
+/* Watch the directories of files and no others, keeping
+   watched up to date. Returns false if one can't be watched. */
+static bool watchFiles(int notify, const std::vector<std::string>& files,
+  std::map<int, std::vector<std::string>>& watched){
+	bool ok = true;
+	std::map<int, std::vector<std::string>> now;
+	for (const std::string& file : files){
+		// A directory already watched keeps its descriptor
+		int wd = inotify_add_watch(notify, dirOf(file).c_str(),
+		  IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+		if (wd < 0){
+			std::cerr << "Cannot watch " << file << ": "
+			  << strerror(errno) << "\n";
+			ok = false;
+			continue;
+		}
+		now[wd].push_back(baseOf(file));
+	}
+	for (auto& entry : watched){
+		if (now.find(entry.first) == now.end()){
+			inotify_rm_watch(notify, entry.first);
+		}
+	}
+	watched.swap(now);
+	return ok;
+}
+
+/* A run of whole declarations of a file, parsed on its own */
+class WatchedChunk{
+public:
+	WatchedChunk(std::string textIn)
+	: text(textIn), root(nullptr), line(0){ }
+	std::string text;
+	/** Owns the chunk's AST **/
+	AstArena arena;
+	/** nullptr if the chunk did not parse cleanly **/
+	ProgramNode * root;
+	/** The line (from 0) of the file the chunk starts on, as
+	 * far as the positions in its AST are concerned **/
+	size_t line;
+};
+
+class WatchedFile{
+public:
+	WatchedFile() : used(0){ }
+	std::unique_ptr<LexedText> lexed;
+	std::vector<std::shared_ptr<WatchedChunk>> chunks;
+	/** When it was last parsed, counting parses **/
+	size_t used;
+};
+
+/* What has been parsed, by absolute path, while watching or
+   serving */
+static std::map<std::string, WatchedFile> * watchedFiles = nullptr;
+/* How many files to keep (0 for all of them), and the parses so
+   far, which date each file's last */
+static size_t keptLimit = 0;
+static size_t parses = 0;
+
+static std::string absolutePath(const std::string& path){
+	if (!path.empty() && path[0] == '/'){ return normalPath(path); }
+	std::vector<char> cwd(PATH_MAX);
+	if (getcwd(cwd.data(), cwd.size()) == nullptr){ return normalPath(path); }
+	return normalPath(std::string(cwd.data()) + "/" + path);
+}
+
+void keepParses(size_t limit){
+	static std::map<std::string, WatchedFile> kept;
+	watchedFiles = &kept;
+	keptLimit = limit;
+}
+
+static std::shared_ptr<WatchedChunk> parseChunk(const std::string& text){
+	auto chunk = std::make_shared<WatchedChunk>(text);
+	AstArena::Scope scope(&chunk->arena);
+	std::istringstream in(text);
+	// A chunk's errors are not reported: the whole file is
+	// parsed again to report them
+	std::vector<Report::Diagnostic> errors;
+	std::vector<Report::Diagnostic> * outer = Report::collector();
+	size_t errorsBefore = Report::count();
+	Report::collector() = &errors;
+	ProgramNode * root = nullptr;
+	Scanner scanner(&in);
+	Parser parser(scanner, &root);
+	int errCode = parser.parse();
+	Report::collector() = outer;
+	Report::count() = errorsBefore;
+	if (errCode == 0 && errors.empty()){ chunk->root = root; }
+	return chunk;
+}
+
+bool watchedParse(const std::string& path, ProgramNode *& root){
+	if (watchedFiles == nullptr){ return false; }
+	std::ifstream in(path, std::ios::binary);
+	if (!in.good()){ return false; }
+	std::stringstream contents;
+	contents << in.rdbuf();
+	std::string key = absolutePath(path);
+	if (keptLimit > 0 && watchedFiles->size() >= keptLimit
+	  && watchedFiles->find(key) == watchedFiles->end()){
+		auto oldest = watchedFiles->begin();
+		for (auto kept = watchedFiles->begin(); kept != watchedFiles->end();
+		  ++kept){
+			if (kept->second.used < oldest->second.used){ oldest = kept; }
+		}
+		watchedFiles->erase(oldest);
+	}
+	WatchedFile& file = (*watchedFiles)[key];
+	file.used = ++parses;
+	if (file.lexed == nullptr){
+		file.lexed.reset(new LexedText(contents.str()));
+	} else {
+		file.lexed->replace(contents.str());
+	}
+
+	// Identical text parses identically, wherever it has moved to
+	std::unordered_multimap<std::string, std::shared_ptr<WatchedChunk>> old;
+	for (auto& chunk : file.chunks){ old.emplace(chunk->text, chunk); }
+	std::vector<size_t> firstLines = declFirstLines(*file.lexed);
+	file.chunks.clear();
+	auto imports = AstArena::track(new std::list<ImportNode *>());
+	auto globals = AstArena::track(new std::list<DeclNode *>());
+	bool ok = true;
+	for (size_t i = 0; i < firstLines.size(); i++){
+		size_t begin = file.lexed->lineStart(firstLines[i]);
+		size_t end = file.lexed->lineStart(i + 1 < firstLines.size()
+		  ? firstLines[i + 1] : file.lexed->lineCount());
+		std::string piece = file.lexed->text().substr(begin, end - begin);
+		std::shared_ptr<WatchedChunk> chunk;
+		auto found = old.find(piece);
+		if (found != old.end()){
+			chunk = found->second;
+			old.erase(found);
+		} else {
+			chunk = parseChunk(piece);
+		}
+		file.chunks.push_back(chunk);
+		if (chunk->root == nullptr){
+			ok = false;
+			continue;
+		}
+		if (chunk->line != firstLines[i]){
+			std::ptrdiff_t by = static_cast<std::ptrdiff_t>(firstLines[i])
+			  - static_cast<std::ptrdiff_t>(chunk->line);
+			for (Position * pos : chunk->arena.positions()){
+				pos->moveLines(by);
+			}
+			chunk->line = firstLines[i];
+		}
+		// Imports come before every declaration
+		std::list<ImportNode *> * chunkImports = chunk->root->getImports();
+		if (!chunkImports->empty() && !globals->empty()){ ok = false; }
+		imports->insert(imports->end(), chunkImports->begin(),
+		  chunkImports->end());
+		std::list<DeclNode *> * chunkGlobals = chunk->root->getGlobals();
+		globals->insert(globals->end(), chunkGlobals->begin(),
+		  chunkGlobals->end());
+	}
+	if (!ok){ return false; }
+	root = new ProgramNode(imports, globals);
+	return true;
+}
+
+/* Build the imported modules, then run the command line */
+static int runOnce(const WatchInputs& inputs, int argc,
+  const char ** argv, CompileFn compile){
+	if (!inputs.modules.empty()){
+		int code = buildModules(inputs.modules, 0, compile);
+		if (code != 0){ return code; }
+	}
+	// Whatever the build makes, other than the watched files'
+	// ASTs, goes when it is done
+	AstArena arena;
+	AstArena::Scope scope(&arena);
+	int code = 1;
+	try {
+		code = compile(argc, argv);
+	} catch (std::exception& e){
+		std::cerr << "ac failed: " << e.what() << "\n";
+	}
+	std::cout.flush();
+	return code;
+}
+
+int watchAndRebuild(InputsFn inputs, int argc, const char ** argv,
+  CompileFn compile){
+	int notify = inotify_init1(IN_CLOEXEC);
+	if (notify < 0){
+		std::cerr << "Cannot watch files: " << strerror(errno) << "\n";
+		return 1;
+	}
+	// Watch descriptor to the names watched in its directory
+	std::map<int, std::vector<std::string>> watched;
+	WatchInputs found = inputs(argc, argv);
+	if (!watchFiles(notify, found.files, watched)){ return 1; }
+	std::map<std::string, WatchedFile> files;
+	watchedFiles = &files;
+
+	size_t built = fingerprint(found.files);
+	runOnce(found, argc, argv, compile);
+	std::cerr << "Watching for changes\n";
+
+	alignas(struct inotify_event) char buf[4096];
+	for (;;){
+		// Block for the first event, then drain until it is quiet
+		bool relevant = false;
+		int timeout = -1;
+		for (;;){
+			struct pollfd ready = { notify, POLLIN, 0 };
+			int n = poll(&ready, 1, timeout);
+			if (n < 0 && errno == EINTR){ continue; }
+			if (n <= 0){ break; }
+			ssize_t len = read(notify, buf, sizeof buf);
+			if (len <= 0){ break; }
+			size_t at = 0;
+			while (at < static_cast<size_t>(len)){
+				struct inotify_event * event
+				  = reinterpret_cast<struct inotify_event *>(buf + at);
+				auto names = watched.find(event->wd);
+				if (names != watched.end() && event->len > 0){
+					for (const std::string& name : names->second){
+						if (name == event->name){ relevant = true; }
+					}
+				}
+				at += sizeof(struct inotify_event) + event->len;
+			}
+			timeout = settleMs;
+		}
+		if (!relevant){ continue; }
+
+		// The change may have added or dropped an import
+		found = inputs(argc, argv);
+		watchFiles(notify, found.files, watched);
+		for (auto file = files.begin(); file != files.end(); ){
+			bool kept = false;
+			for (const std::string& path : found.files){
+				if (absolutePath(path) == file->first){ kept = true; }
+			}
+			file = kept ? std::next(file) : files.erase(file);
+		}
+		size_t now = fingerprint(found.files);
+		if (now == built){ continue; }
+		built = now;
+		int code = runOnce(found, argc, argv, compile);
+		std::cerr << "Rebuilt (exit code " << code << ")\n";
+	}
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef A_LANG_WATCH_HPP
+#define A_LANG_WATCH_HPP
+
+#include <string>
+#include <vector>
+#include "ast.hpp"
+#include "daemon.hpp"
+
+namespace a_lang{
+
+/** What a command line reads **/
+class WatchInputs{
+public:
+	/** The files it reads, or that decide which files it reads **/
+	std::vector<std::string> files;
+	/** The modules its input imports, directly or not, whose
+	 * interfaces and C a build must bring up to date first **/
+	std::vector<std::string> modules;
+};
+
+typedef WatchInputs (*InputsFn)(int argc, const char ** argv);
+
+/** Run compile on argv, then again each time the contents of
+ * one of its inputs change, until killed. The inputs are found
+ * again after every change, since an edit may add an import, and
+ * the modules imported are built (see buildModules) before each
+ * run. Runs are in this process, which keeps what it parsed from
+ * one to the next (see watchedParse). **/
+int watchAndRebuild(InputsFn inputs, int argc, const char ** argv,
+  CompileFn compile);
+
+/** While watching or keeping parses, set root to the AST of
+ * the file at path as it is now, parsing only the declarations
+ * that changed since it was last parsed, and return true.
+ * Returns false if neither, or if the file (or one of its
+ * declarations) does not parse cleanly, so that the caller
+ * parses all of it and reports the errors as usual. **/
+bool watchedParse(const std::string& path, ProgramNode *& root);
+
+/** Keep what watchedParse parses from now on, as a watch does,
+ * for the limit files parsed most recently (see serveDaemon) **/
+void keepParses(size_t limit);
+
+}
+
+#endif
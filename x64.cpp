@@ -0,0 +1,592 @@
+#include <algorithm>
+#include <utility>
+#include "x64.hpp"
+
+namespace a_lang{
+
+/*
+Instruction selection for x86-64, and the assembler source of
+the native backend. Each IR instruction becomes a few machine
+instructions over the places its registers are assigned; rax,
+rcx, rdx, r10 and r11 are never assigned, so that selection can
+always bring a value into one of them. Calls follow the System
+V ABI, which the runtime's calls into the C library need too.
+
+A frame is addressed from rbp. Below it are the callee-saved
+registers the function uses, then the spill slots (8 bytes
+each), then the IR's frame slots.
+*/
+
+const RegFile x64Registers({ RBX, R12, R13, R14, R15, RSI, RDI, R8, R9 }, 5);
+
+static const int argRegs[] = { RDI, RSI, RDX, RCX, R8, R9 };
+static const size_t nArgRegs = sizeof argRegs / sizeof argRegs[0];
+
+std::string x64StringSym(int64_t id){
+	return "art_str" + std::to_string(id);
+}
+
+typedef X64Instr I;
+typedef X64Operand O;
+
+/* Selection for one function */
+class X64Select{
+public:
+	X64Select(const IrFunction& fn, const RegAssignment& assignment);
+	std::vector<X64Instr> run();
+private:
+	void op(I::Op op, int size, O src, O dst){
+		myCode.push_back(I(op, size, src, dst));
+	}
+	void jump(I::Op op, int cond, int label){
+		I instr(op);
+		instr.cond = cond;
+		instr.label = label;
+		myCode.push_back(instr);
+	}
+	int sizeOf(IrReg r){ return myFn.wide[static_cast<size_t>(r)] ? 8 : 4; }
+	O home(IrReg r){ return myHomes[static_cast<size_t>(r)]; }
+	void mov(int size, O src, O dst);
+	O inReg(IrReg r, int scratch);
+	void parallelMove(std::vector<std::pair<O, O>> moves);
+	void arith(I::Op op, const IrInstr& instr);
+	void compare(const IrInstr& instr);
+	void select(size_t& k);
+	void call(const IrInstr& instr);
+
+	const IrFunction& myFn;
+	std::vector<O> myHomes;
+	std::vector<int> myUses;
+	std::vector<int64_t> mySlots;
+	std::vector<std::pair<int, int64_t>> mySaved;
+	int64_t myFrame;
+	std::vector<X64Instr> myCode;
+};
+
+X64Select::X64Select(const IrFunction& fn, const RegAssignment& assignment)
+: myFn(fn), myUses(fn.wide.size(), 0), myFrame(0){
+	std::vector<int> defs(fn.wide.size(), 0);
+	std::vector<bool> isConst(fn.wide.size(), false);
+	std::vector<int64_t> consts(fn.wide.size(), 0);
+	for (auto& instr : fn.code){
+		if (instr.dst >= 0){
+			size_t dst = static_cast<size_t>(instr.dst);
+			defs[dst]++;
+			isConst[dst] = instr.op == IrOp::CONST;
+			consts[dst] = instr.imm;
+		}
+		std::vector<IrReg> used = instr.args;
+		used.push_back(instr.a);
+		used.push_back(instr.b);
+		for (IrReg r : used){
+			if (r >= 0){ myUses[static_cast<size_t>(r)]++; }
+		}
+	}
+
+	// Lay out the frame, saved registers first
+	std::vector<bool> usedRegs(16, false);
+	for (int reg : assignment.reg){
+		if (reg >= 0){ usedRegs[static_cast<size_t>(reg)] = true; }
+	}
+	for (size_t k = 0; k < x64Registers.preserved; k++){
+		int reg = x64Registers.regs[k];
+		if (!usedRegs[static_cast<size_t>(reg)]){ continue; }
+		myFrame += 8;
+		mySaved.push_back(std::make_pair(reg, -myFrame));
+	}
+	int64_t spills = myFrame;
+	myFrame += 8 * assignment.spills;
+	for (auto& slot : fn.slots){
+		myFrame = (myFrame + slot.size + slot.align - 1) / slot.align
+		  * slot.align;
+		mySlots.push_back(-myFrame);
+	}
+	myFrame = (myFrame + 15) / 16 * 16;
+
+	for (size_t r = 0; r < fn.wide.size(); r++){
+		if (assignment.reg[r] >= 0){
+			myHomes.push_back(O::r(assignment.reg[r]));
+		} else if (assignment.spill[r] >= 0){
+			myHomes.push_back(O::m(RBP, -spills - 8 - 8 * assignment.spill[r]));
+		} else if (defs[r] == 1 && isConst[r]){
+			// Rematerialized at each use
+			myHomes.push_back(O::i(consts[r]));
+		} else {
+			myHomes.push_back(O());
+		}
+	}
+}
+
+/* A move, through rax if neither side is a register */
+void X64Select::mov(int size, O src, O dst){
+	if (src == dst){ return; }
+	if (src.kind == O::MEM && dst.kind == O::MEM){
+		op(I::MOV, size, src, O::r(RAX));
+		src = O::r(RAX);
+	}
+	op(I::MOV, size, src, dst);
+}
+
+/* The register r is in, or scratch after loading it there */
+O X64Select::inReg(IrReg r, int scratch){
+	O place = home(r);
+	if (place.kind == O::REG){ return place; }
+	mov(sizeOf(r), place, O::r(scratch));
+	return O::r(scratch);
+}
+
+/* Moves that all read before any of them writes, as when
+   arguments are passed. Each whole register or slot is moved;
+   a cycle of registers is broken through r11. */
+void X64Select::parallelMove(std::vector<std::pair<O, O>> moves){
+	moves.erase(std::remove_if(moves.begin(), moves.end(),
+	  [](const std::pair<O, O>& move){ return move.first == move.second; }),
+	  moves.end());
+	while (!moves.empty()){
+		bool progress = false;
+		for (size_t k = 0; k < moves.size() && !progress; k++){
+			O dst = moves[k].second;
+			bool read = false;
+			for (size_t j = 0; j < moves.size(); j++){
+				if (j != k && moves[j].first == dst){ read = true; }
+			}
+			if (read){ continue; }
+			mov(8, moves[k].first, dst);
+			moves.erase(moves.begin() + static_cast<std::ptrdiff_t>(k));
+			progress = true;
+		}
+		if (!progress){
+			O saved = moves.front().second;
+			mov(8, saved, O::r(R11));
+			for (auto& move : moves){
+				if (move.first == saved){ move.first = O::r(R11); }
+			}
+		}
+	}
+}
+
+void X64Select::arith(I::Op opcode, const IrInstr& instr){
+	O dst = home(instr.dst);
+	O a = home(instr.a);
+	O b = home(instr.b);
+	if (opcode != I::SUB && dst.kind == O::REG && b == dst){ std::swap(a, b); }
+	O work = dst.kind == O::REG && b != dst ? dst : O::r(RAX);
+	mov(4, a, work);
+	op(opcode, 4, b, work);
+	mov(4, work, dst);
+}
+
+static int condOf(IrOp op){
+	switch (op){
+	case IrOp::EQ: return CC_E;
+	case IrOp::NE: return CC_NE;
+	case IrOp::LT: return CC_L;
+	case IrOp::LE: return CC_LE;
+	case IrOp::GT: return CC_G;
+	default: return CC_GE;
+	}
+}
+
+/* Set the flags for a compare of instr's operands */
+void X64Select::compare(const IrInstr& instr){
+	int size = sizeOf(instr.a);
+	O a = home(instr.a);
+	O b = home(instr.b);
+	if (a.kind == O::IMM || (a.kind == O::MEM && b.kind == O::MEM)){
+		mov(size, a, O::r(RAX));
+		a = O::r(RAX);
+	}
+	op(I::CMP, size, b, a);
+}
+
+void X64Select::call(const IrInstr& instr){
+	// Arguments past the sixth are pushed, last first, keeping
+	// the stack 16 byte aligned at the call
+	size_t n = instr.args.size();
+	int64_t pushed = n > nArgRegs ? static_cast<int64_t>(n - nArgRegs) : 0;
+	int64_t pad = pushed % 2 == 0 ? 0 : 8;
+	if (pad != 0){ op(I::SUB, 8, O::i(pad), O::r(RSP)); }
+	for (size_t k = n; k > nArgRegs; k--){
+		op(I::PUSH, 8, home(instr.args[k - 1]), O());
+	}
+	std::vector<std::pair<O, O>> moves;
+	for (size_t k = 0; k < n && k < nArgRegs; k++){
+		moves.push_back(std::make_pair(home(instr.args[k]), O::r(argRegs[k])));
+	}
+	parallelMove(moves);
+	I callInstr(I::CALL);
+	callInstr.sym = instr.sym;
+	myCode.push_back(callInstr);
+	if (pushed * 8 + pad != 0){
+		op(I::ADD, 8, O::i(pushed * 8 + pad), O::r(RSP));
+	}
+	if (instr.dst >= 0){ mov(sizeOf(instr.dst), O::r(RAX), home(instr.dst)); }
+}
+
+/* Select the instructions of myFn.code[k], and of any that are
+   folded into it */
+void X64Select::select(size_t& k){
+	const IrInstr& instr = myFn.code[k];
+	O dst = instr.dst >= 0 ? home(instr.dst) : O();
+	O work = dst.kind == O::REG ? dst : O::r(RAX);
+	switch (instr.op){
+	case IrOp::CONST:
+		mov(sizeOf(instr.dst), O::i(instr.imm), dst);
+		break;
+	case IrOp::COPY:
+		mov(sizeOf(instr.dst), home(instr.a), dst);
+		break;
+	case IrOp::ADD: arith(I::ADD, instr); break;
+	case IrOp::SUB: arith(I::SUB, instr); break;
+	case IrOp::MUL: arith(I::IMUL, instr); break;
+	case IrOp::DIV: {
+		mov(4, home(instr.a), O::r(RAX));
+		op(I::CLTD, 4, O(), O());
+		O divisor = home(instr.b);
+		if (divisor.kind == O::IMM){
+			mov(4, divisor, O::r(RCX));
+			divisor = O::r(RCX);
+		}
+		op(I::IDIV, 4, divisor, O());
+		mov(4, O::r(RAX), dst);
+		break;
+	}
+	case IrOp::NEG:
+		mov(4, home(instr.a), work);
+		op(I::NEG, 4, O(), work);
+		mov(4, work, dst);
+		break;
+	case IrOp::NOT:
+		mov(4, home(instr.a), work);
+		op(I::XOR, 4, O::i(1), work);
+		mov(4, work, dst);
+		break;
+	case IrOp::EQ: case IrOp::NE: case IrOp::LT:
+	case IrOp::LE: case IrOp::GT: case IrOp::GE: {
+		compare(instr);
+		int cond = condOf(instr.op);
+		if (k + 1 < myFn.code.size() && myFn.code[k + 1].op == IrOp::BRANCH
+		  && myFn.code[k + 1].a == instr.dst
+		  && myUses[static_cast<size_t>(instr.dst)] == 1){
+			// Branch on the flags
+			k++;
+			jump(I::JCC, cond, static_cast<int>(myFn.code[k].imm));
+			jump(I::JMP, 0, static_cast<int>(myFn.code[k].imm2));
+			break;
+		}
+		I set(I::SETCC, 1, O(), O::r(RAX));
+		set.cond = cond;
+		myCode.push_back(set);
+		op(I::MOVZB, 4, O::r(RAX), work);
+		mov(4, work, dst);
+		break;
+	}
+	case IrOp::ARG: {
+		// Every argument at once, since they may be in one
+		// another's way
+		std::vector<std::pair<O, O>> moves;
+		for (; k < myFn.code.size() && myFn.code[k].op == IrOp::ARG; k++){
+			const IrInstr& arg = myFn.code[k];
+			if (myUses[static_cast<size_t>(arg.dst)] == 0){ continue; }
+			size_t index = static_cast<size_t>(arg.imm);
+			O src = index < nArgRegs ? O::r(argRegs[index])
+			  : O::m(RBP, 16 + 8 * static_cast<int64_t>(index - nArgRegs));
+			moves.push_back(std::make_pair(src, home(arg.dst)));
+		}
+		k--;
+		parallelMove(moves);
+		break;
+	}
+	case IrOp::SLOT:
+		op(I::LEA, 8, O::m(RBP, mySlots[static_cast<size_t>(instr.imm)]), work);
+		mov(8, work, dst);
+		break;
+	case IrOp::GLOBAL:
+		op(I::LEA, 8, O::s(instr.sym), work);
+		mov(8, work, dst);
+		break;
+	case IrOp::STR:
+		op(I::LEA, 8, O::s(x64StringSym(instr.imm)), work);
+		mov(8, work, dst);
+		break;
+	case IrOp::OFFSET: {
+		O base = inReg(instr.a, R10);
+		op(I::LEA, 8, O::m(base.reg, instr.imm), work);
+		mov(8, work, dst);
+		break;
+	}
+	case IrOp::LOAD: {
+		O base = inReg(instr.a, R11);
+		O src = O::m(base.reg, instr.imm);
+		if (instr.size == 1){
+			op(I::MOVZB, 4, src, work);
+		} else {
+			op(I::MOV, instr.size, src, work);
+		}
+		mov(sizeOf(instr.dst), work, dst);
+		break;
+	}
+	case IrOp::STORE: {
+		O base = inReg(instr.a, R11);
+		O value = home(instr.b);
+		if (value.kind == O::MEM){
+			mov(sizeOf(instr.b), value, O::r(RAX));
+			value = O::r(RAX);
+		}
+		op(I::MOV, instr.size, value, O::m(base.reg, instr.imm));
+		break;
+	}
+	case IrOp::ZERO: {
+		O base = inReg(instr.a, R11);
+		op(I::XOR, 4, O::r(RAX), O::r(RAX));
+		for (int64_t at = 0; at < instr.imm; ){
+			int size = instr.imm - at >= 8 ? 8 : instr.imm - at >= 4 ? 4 : 1;
+			op(I::MOV, size, O::r(RAX), O::m(base.reg, at));
+			at += size;
+		}
+		break;
+	}
+	case IrOp::MOVE: {
+		O to = inReg(instr.a, R11);
+		O from = inReg(instr.b, R10);
+		for (int64_t at = 0; at < instr.imm; ){
+			int size = instr.imm - at >= 8 ? 8 : instr.imm - at >= 4 ? 4 : 1;
+			op(I::MOV, size, O::m(from.reg, at), O::r(RAX));
+			op(I::MOV, size, O::r(RAX), O::m(to.reg, at));
+			at += size;
+		}
+		break;
+	}
+	case IrOp::CALL:
+		call(instr);
+		break;
+	case IrOp::LABEL:
+		jump(I::LABEL, 0, static_cast<int>(instr.imm));
+		break;
+	case IrOp::JUMP:
+		jump(I::JMP, 0, static_cast<int>(instr.imm));
+		break;
+	case IrOp::BRANCH: {
+		O cond = home(instr.a);
+		if (cond.kind == O::IMM){
+			jump(I::JMP, 0, static_cast<int>(cond.disp != 0 ? instr.imm
+			  : instr.imm2));
+			break;
+		}
+		if (cond.kind == O::REG){
+			op(I::TEST, 4, cond, cond);
+		} else {
+			op(I::CMP, 4, O::i(0), cond);
+		}
+		jump(I::JCC, CC_NE, static_cast<int>(instr.imm));
+		jump(I::JMP, 0, static_cast<int>(instr.imm2));
+		break;
+	}
+	case IrOp::RET:
+		if (instr.a >= 0){ mov(sizeOf(instr.a), home(instr.a), O::r(RAX)); }
+		jump(I::JMP, 0, myFn.labels);
+		break;
+	}
+}
+
+/* Drop jumps to the next instruction, and make a conditional
+   jump over a jump one jump on the opposite condition */
+static std::vector<X64Instr> tidy(const std::vector<X64Instr>& code){
+	std::vector<X64Instr> result;
+	for (size_t k = 0; k < code.size(); k++){
+		const X64Instr& instr = code[k];
+		if (instr.op == I::JMP && k + 1 < code.size()
+		  && code[k + 1].op == I::LABEL && code[k + 1].label == instr.label){
+			continue;
+		}
+		if (instr.op == I::JCC && k + 2 < code.size()
+		  && code[k + 1].op == I::JMP && code[k + 2].op == I::LABEL
+		  && code[k + 2].label == instr.label){
+			X64Instr flipped = code[k + 1];
+			flipped.op = I::JCC;
+			flipped.cond = instr.cond ^ 1;
+			result.push_back(flipped);
+			k++;
+			continue;
+		}
+		result.push_back(instr);
+	}
+	return result;
+}
+
+std::vector<X64Instr> X64Select::run(){
+	op(I::PUSH, 8, O::r(RBP), O());
+	op(I::MOV, 8, O::r(RSP), O::r(RBP));
+	if (myFrame != 0){ op(I::SUB, 8, O::i(myFrame), O::r(RSP)); }
+	for (auto& saved : mySaved){
+		op(I::MOV, 8, O::r(saved.first), O::m(RBP, saved.second));
+	}
+	for (size_t k = 0; k < myFn.code.size(); k++){ select(k); }
+	jump(I::LABEL, 0, myFn.labels);
+	for (auto& saved : mySaved){
+		op(I::MOV, 8, O::m(RBP, saved.second), O::r(saved.first));
+	}
+	op(I::LEAVE, 8, O(), O());
+	op(I::RET, 8, O(), O());
+	return tidy(myCode);
+}
+
+std::vector<X64Instr> selectX64(const IrFunction& fn,
+  const RegAssignment& assignment){
+	return X64Select(fn, assignment).run();
+}
+
+std::vector<X64Instr> compileX64(const IrFunction& fn){
+	IrFunction allocated = fn;
+	RegAssignment assignment = allocateRegs(allocated, x64Registers);
+	return selectX64(allocated, assignment);
+}
+
+/** Assembler source **/
+
+static const char * const regs64[] = {
+	"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+	"r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+};
+static const char * const regs32[] = {
+	"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+	"r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+};
+static const char * const regs8[] = {
+	"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+	"r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b",
+};
+static const char * const conds[] = {
+	"o", "no", "b", "ae", "e", "ne", "be", "a",
+	"s", "ns", "p", "np", "l", "ge", "le", "g",
+};
+
+static std::string operand(const O& op, int size){
+	size_t reg = static_cast<size_t>(op.reg);
+	switch (op.kind){
+	case O::REG:
+		return std::string("%")
+		  + (size == 8 ? regs64 : size == 4 ? regs32 : regs8)[reg];
+	case O::IMM:
+		return "$" + std::to_string(op.disp);
+	case O::MEM:
+		return (op.disp == 0 ? "" : std::to_string(op.disp))
+		  + "(%" + regs64[reg] + ")";
+	case O::SYM:
+		return op.sym + "(%rip)";
+	default:
+		return "";
+	}
+}
+
+static const char * suffix(int size){
+	return size == 1 ? "b" : size == 4 ? "l" : "q";
+}
+
+void printX64(const std::vector<X64Instr>& code, std::string prefix,
+  std::ostream& out){
+	for (auto& instr : code){
+		std::string src = operand(instr.src, instr.size);
+		std::string dst = operand(instr.dst, instr.size);
+		const char * name = nullptr;
+		switch (instr.op){
+		case I::LABEL:
+			out << prefix << instr.label << ":\n";
+			continue;
+		case I::MOVZB:
+			out << "\tmovzbl " << operand(instr.src, 1) << ", "
+			  << operand(instr.dst, 4) << "\n";
+			continue;
+		case I::NEG:
+			out << "\tneg" << suffix(instr.size) << " " << dst << "\n";
+			continue;
+		case I::IDIV:
+			out << "\tidiv" << suffix(instr.size) << " " << src << "\n";
+			continue;
+		case I::CLTD: out << "\tcltd\n"; continue;
+		case I::SETCC:
+			out << "\tset" << conds[instr.cond] << " " << dst << "\n";
+			continue;
+		case I::JMP: out << "\tjmp " << prefix << instr.label << "\n"; continue;
+		case I::JCC:
+			out << "\tj" << conds[instr.cond] << " " << prefix << instr.label
+			  << "\n";
+			continue;
+		case I::CALL: out << "\tcall " << instr.sym << "\n"; continue;
+		case I::RET: out << "\tret\n"; continue;
+		case I::LEAVE: out << "\tleave\n"; continue;
+		case I::PUSH: out << "\tpushq " << src << "\n"; continue;
+		case I::POP: out << "\tpopq " << dst << "\n"; continue;
+		case I::MOV: name = "mov"; break;
+		case I::LEA: name = "lea"; break;
+		case I::ADD: name = "add"; break;
+		case I::SUB: name = "sub"; break;
+		case I::IMUL: name = "imul"; break;
+		case I::XOR: name = "xor"; break;
+		case I::CMP: name = "cmp"; break;
+		case I::TEST: name = "test"; break;
+		}
+		out << "\t" << name << suffix(instr.size) << " " << src << ", " << dst
+		  << "\n";
+	}
+}
+
+/* An .ascii operand holding str */
+static std::string asmQuote(std::string str){
+	static const char * const octal = "01234567";
+	std::string result = "\"";
+	for (char c : str){
+		unsigned char u = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\'){
+			result += '\\';
+			result += c;
+		} else if (u < 32 || u >= 127){
+			result += '\\';
+			result += octal[u >> 6];
+			result += octal[(u >> 3) & 7];
+			result += octal[u & 7];
+		} else {
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+void emitX64(const IrProgram& program, std::ostream& out){
+	emitX64Runtime(out);
+	out << "\t.text\n";
+	int index = 0;
+	for (auto& fn : program.functions){
+		if (fn.name == "main"){ out << "\t.globl main\n"; }
+		out << fn.name << ":\n";
+		printX64(compileX64(fn), ".L" + std::to_string(index++) + "_", out);
+	}
+
+	// Strings are laid out as the C runtime's art_str_rep
+	if (!program.strings.empty()){
+		out << "\t.section .rodata\n";
+		for (size_t k = 0; k < program.strings.size(); k++){
+			out << x64StringSym(static_cast<int64_t>(k)) << "_bytes:\n"
+			  << "\t.ascii " << asmQuote(program.strings[k]) << "\n";
+		}
+		out << "\t.data\n\t.align 8\n";
+		for (size_t k = 0; k < program.strings.size(); k++){
+			const std::string& value = program.strings[k];
+			uint32_t hash = 2166136261u;
+			for (char c : value){
+				hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+			}
+			std::string sym = x64StringSym(static_cast<int64_t>(k));
+			out << sym << ":\n\t.quad " << sym << "_bytes\n"
+			  << "\t.long " << value.length() << ", " << hash << "\n";
+		}
+	}
+	out << "\t.bss\n";
+	for (auto& global : program.globals){
+		out << "\t.align " << global.align << "\n" << global.sym << ":\n"
+		  << "\t.zero " << global.size << "\n";
+	}
+	out << "\t.section .note.GNU-stack,\"\",@progbits\n";
+}
+
+}
@@ -0,0 +1,139 @@
+#ifndef A_LANG_X64_HPP
+#define A_LANG_X64_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+#include "regalloc.hpp"
+
+namespace a_lang{
+
+/** The general registers, numbered as instructions encode them **/
+enum X64Reg : int {
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+/** Conditions of jcc and setcc, numbered as they are encoded **/
+enum X64Cond : int {
+	CC_E = 4, CC_NE = 5, CC_L = 12, CC_GE = 13, CC_LE = 14, CC_G = 15,
+};
+
+/** An operand: a register, an immediate, memory at a register
+ * plus a displacement, or the address of a symbol (which is
+ * reached relative to the instruction pointer) **/
+class X64Operand{
+public:
+	enum Kind { NONE, REG, IMM, MEM, SYM };
+	X64Operand() : kind(NONE), reg(-1), disp(0){ }
+	static X64Operand r(int reg){
+		X64Operand op;
+		op.kind = REG;
+		op.reg = reg;
+		return op;
+	}
+	static X64Operand i(int64_t imm){
+		X64Operand op;
+		op.kind = IMM;
+		op.disp = imm;
+		return op;
+	}
+	static X64Operand m(int base, int64_t disp){
+		X64Operand op;
+		op.kind = MEM;
+		op.reg = base;
+		op.disp = disp;
+		return op;
+	}
+	static X64Operand s(std::string sym){
+		X64Operand op;
+		op.kind = SYM;
+		op.sym = sym;
+		return op;
+	}
+	bool operator==(const X64Operand& other) const {
+		return kind == other.kind && reg == other.reg && disp == other.disp
+		  && sym == other.sym;
+	}
+	bool operator!=(const X64Operand& other) const {
+		return !(*this == other);
+	}
+	Kind kind;
+	/** The register, or the base of memory **/
+	int reg;
+	/** The immediate, or the displacement of memory **/
+	int64_t disp;
+	std::string sym;
+};
+
+/** One machine instruction, in the order AT&T syntax writes
+ * its operands: src, then dst **/
+class X64Instr{
+public:
+	enum Op {
+		MOV,    // size bytes of src to dst
+		MOVZB,  // a byte of src, zero extended, to 4 byte dst
+		LEA,    // the address of src (MEM or SYM) to dst
+		ADD, SUB, IMUL, XOR, CMP, TEST,  // dst op= src; CMP is dst - src
+		NEG,    // dst = -dst
+		CLTD,   // sign extend eax into edx
+		IDIV,   // edx:eax / src
+		SETCC,  // low byte of dst = cond
+		JMP,    // to label
+		JCC,    // to label if cond
+		CALL,   // sym
+		RET,
+		PUSH,   // 8 bytes of src
+		POP,    // 8 bytes to dst
+		LEAVE,
+		LABEL,  // label is here
+	};
+	X64Instr(Op opIn, int sizeIn = 8, X64Operand srcIn = X64Operand(),
+	  X64Operand dstIn = X64Operand())
+	: op(opIn), size(sizeIn), src(srcIn), dst(dstIn), cond(0), label(-1){ }
+	Op op;
+	/** Operand size in bytes: 1, 4 or 8 **/
+	int size;
+	X64Operand src;
+	X64Operand dst;
+	int cond;
+	int label;
+	std::string sym;
+};
+
+/** The registers a function may keep values in, other than the
+ * scratch registers instruction selection uses. The preserved
+ * ones are callee-saved. **/
+extern const RegFile x64Registers;
+
+/** Select instructions for fn, with its registers where
+ * assignment (to x64Registers) puts them. Labels are fn's;
+ * fn.labels is the epilogue. **/
+std::vector<X64Instr> selectX64(const IrFunction& fn,
+  const RegAssignment& assignment);
+
+/** Allocate fn's registers and select its instructions **/
+std::vector<X64Instr> compileX64(const IrFunction& fn);
+
+/** Write code as GNU assembler source, naming labels with
+ * prefix **/
+void printX64(const std::vector<X64Instr>& code, std::string prefix,
+  std::ostream& out);
+
+/** Write a whole program, with the native runtime (see
+ * nruntime.cpp), as assembler source for x86-64 Linux, which the
+ * system assembler and linker make an executable of (e.g. cc
+ * prog.s -o prog) **/
+void emitX64(const IrProgram& program, std::ostream& out);
+
+/** The symbol of string constant id **/
+std::string x64StringSym(int64_t id);
+
+/** Write the native runtime's assembler source **/
+void emitX64Runtime(std::ostream& out);
+
+}
+
+#endif
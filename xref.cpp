@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <unistd.h>
+#include "xref.hpp"
+#include "alang.hpp"
+#include "cache.hpp"
+#include "module.hpp"
+#include "names.hpp"
+
+namespace a_lang{
+
+/*
+The cross-reference index is one file, in native byte order,
+made to be mapped and searched in place:
+
+	header       magic, string count, entry count, blob size
+	uint32_t     start of each string in the blob, plus its end
+	blob         the strings, each ending in a NUL, in sorted
+	             order, padded to a multiple of 4 bytes
+	XrefEntry    every occurrence, sorted by symbol, then place
+	uint32_t     the entries' indices, sorted by place
+
+Finding a name is a binary search of the strings, then of the
+entries. Finding the symbol at a place is a binary search of
+the second ordering.
+*/
+
+class XrefHeader{
+public:
+	char magic[8];
+	uint32_t strings;
+	uint32_t entries;
+	uint32_t blobSize;
+	uint32_t reserved;
+};
+
+static const char xrefMagic[8] = { 'A', 'C', 'X', 'R', 'E', 'F', '1', '\0' };
+
+/* An entry before names and files become ids */
+class XrefPending{
+public:
+	std::string name;
+	std::string declFile;
+	Position decl;
+	std::string file;
+	Position at;
+};
+
+static bool indexFile(const std::string& path,
+  std::vector<XrefPending>& pending){
+	std::ifstream in(path);
+	if (!in.good()){
+		std::cerr << "Bad input stream " << path << "\n";
+		return false;
+	}
+	std::stringstream text;
+	text << in.rdbuf();
+	std::unique_ptr<CompilationUnit> unit = parseSource(text.str());
+	if (!unit->ok()){
+		std::cerr << path;
+		auto& errors = unit->diagnostics();
+		if (!errors.empty()){
+			std::cerr << " " << errors[0].pos.begin() << ": " << errors[0].msg;
+		}
+		std::cerr << ": not indexed\n";
+		return false;
+	}
+
+	NameIndex names;
+	names.declareImports(unit->ast()->getImports(), path, 0);
+	names.declareGlobals(unit->ast()->getGlobals(), 0);
+	names.analyze(unit->ast()->getGlobals(), 0);
+	for (auto& decl : names.decls()){
+		// An imported module's names are indexed with that module
+		if (!decl.file.empty()){ continue; }
+		pending.push_back(XrefPending{ decl.name, path, decl.at,
+		  path, decl.at });
+	}
+	for (auto& use : names.uses()){
+		std::string declFile = use.decl->file.empty() ? path : use.decl->file;
+		pending.push_back(XrefPending{ use.decl->name, declFile,
+		  use.decl->at, path, use.at });
+	}
+	return true;
+}
+
+static uint32_t u32(size_t n){
+	return static_cast<uint32_t>(n);
+}
+
+static bool bySymbol(const XrefEntry& a, const XrefEntry& b){
+	return std::tie(a.name, a.declFile, a.declLine, a.declCol,
+	  a.file, a.line, a.col)
+	  < std::tie(b.name, b.declFile, b.declLine, b.declCol,
+	  b.file, b.line, b.col);
+}
+
+bool writeXrefIndex(const char * indexPath,
+  const std::vector<std::string>& files){
+	std::vector<XrefPending> pending;
+	// Paths are normalized, as imports are, so that a module's
+	// names are one symbol in its file and in those importing it
+	bool complete = true;
+	for (auto& file : files){
+		if (!indexFile(normalPath(file), pending)){ complete = false; }
+	}
+
+	std::set<std::string> strings;
+	for (auto& p : pending){
+		strings.insert(p.name);
+		strings.insert(p.declFile);
+		strings.insert(p.file);
+	}
+	std::map<std::string, uint32_t> ids;
+	std::vector<uint32_t> starts;
+	std::string blob;
+	for (auto& s : strings){
+		ids[s] = u32(starts.size());
+		starts.push_back(u32(blob.size()));
+		blob += s;
+		blob += '\0';
+	}
+	starts.push_back(u32(blob.size()));
+	blob.resize((blob.size() + 3) / 4 * 4, '\0');
+
+	std::vector<XrefEntry> entries;
+	for (auto& p : pending){
+		entries.push_back(XrefEntry{ ids[p.name], ids[p.declFile],
+		  u32(p.decl.line()), u32(p.decl.col()), ids[p.file],
+		  u32(p.at.line()), u32(p.at.col()), u32(p.at.colEnd()) });
+	}
+	std::sort(entries.begin(), entries.end(), bySymbol);
+	entries.erase(std::unique(entries.begin(), entries.end(),
+	  [](const XrefEntry& a, const XrefEntry& b){
+		return !bySymbol(a, b) && !bySymbol(b, a);
+	}), entries.end());
+	std::vector<uint32_t> byPlace;
+	for (size_t i = 0; i < entries.size(); i++){ byPlace.push_back(u32(i)); }
+	std::sort(byPlace.begin(), byPlace.end(), [&](uint32_t a, uint32_t b){
+		return std::tie(entries[a].file, entries[a].line, entries[a].col)
+		  < std::tie(entries[b].file, entries[b].line, entries[b].col);
+	});
+
+	XrefHeader header;
+	memcpy(header.magic, xrefMagic, sizeof header.magic);
+	header.strings = u32(strings.size());
+	header.entries = u32(entries.size());
+	header.blobSize = u32(blob.size());
+	header.reserved = 0;
+
+	// Write aside and rename, so a reader never maps half an index
+	std::string tmpPath = std::string(indexPath) + "."
+	  + std::to_string(getpid());
+	std::ofstream out(tmpPath, std::ios::binary);
+	out.write(reinterpret_cast<const char *>(&header), sizeof header);
+	out.write(reinterpret_cast<const char *>(starts.data()),
+	  static_cast<std::streamsize>(starts.size() * sizeof(uint32_t)));
+	out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+	out.write(reinterpret_cast<const char *>(entries.data()),
+	  static_cast<std::streamsize>(entries.size() * sizeof(XrefEntry)));
+	out.write(reinterpret_cast<const char *>(byPlace.data()),
+	  static_cast<std::streamsize>(byPlace.size() * sizeof(uint32_t)));
+	out.close();
+	if (!out.good() || rename(tmpPath.c_str(), indexPath) != 0){
+		unlink(tmpPath.c_str());
+		std::cerr << "Could not write index " << indexPath << "\n";
+		return false;
+	}
+	return complete;
+}
+
+/* An index as mapped into memory */
+class XrefView{
+public:
+	bool open(const char * data, size_t len);
+	const char * str(uint32_t id) const { return myBlob + myStarts[id]; }
+	bool findString(const std::string& s, uint32_t& id) const;
+	const XrefEntry * begin() const { return myEntries; }
+	const XrefEntry * end() const { return myEntries + myCount; }
+	const uint32_t * placeBegin() const { return myByPlace; }
+	const uint32_t * placeEnd() const { return myByPlace + myCount; }
+private:
+	uint32_t myStrings;
+	const uint32_t * myStarts;
+	const char * myBlob;
+	uint32_t myCount;
+	const XrefEntry * myEntries;
+	const uint32_t * myByPlace;
+};
+
+bool XrefView::open(const char * data, size_t len){
+	if (len < sizeof(XrefHeader)){ return false; }
+	const XrefHeader * header = reinterpret_cast<const XrefHeader *>(data);
+	if (memcmp(header->magic, xrefMagic, sizeof xrefMagic) != 0){
+		return false;
+	}
+	size_t need = sizeof(XrefHeader)
+	  + (size_t(header->strings) + 1) * sizeof(uint32_t)
+	  + header->blobSize
+	  + size_t(header->entries) * (sizeof(XrefEntry) + sizeof(uint32_t));
+	if (need != len){ return false; }
+	myStrings = header->strings;
+	myStarts = reinterpret_cast<const uint32_t *>(data + sizeof(XrefHeader));
+	myBlob = reinterpret_cast<const char *>(myStarts + myStrings + 1);
+	myCount = header->entries;
+	myEntries = reinterpret_cast<const XrefEntry *>(myBlob + header->blobSize);
+	myByPlace = reinterpret_cast<const uint32_t *>(myEntries + myCount);
+	return true;
+}
+
+bool XrefView::findString(const std::string& s, uint32_t& id) const{
+	uint32_t lo = 0;
+	uint32_t hi = myStrings;
+	while (lo < hi){
+		uint32_t mid = lo + (hi - lo) / 2;
+		int cmp = strcmp(str(mid), s.c_str());
+		if (cmp == 0){
+			id = mid;
+			return true;
+		}
+		if (cmp < 0){ lo = mid + 1; }
+		else { hi = mid; }
+	}
+	return false;
+}
+
+static bool sameSymbol(const XrefEntry& a, const XrefEntry& b){
+	return a.name == b.name && a.declFile == b.declFile
+	  && a.declLine == b.declLine && a.declCol == b.declCol;
+}
+
+static void printSymbol(const XrefView& view, const XrefEntry& symbol,
+  std::ostream& out){
+	auto first = std::lower_bound(view.begin(), view.end(), symbol,
+	  [](const XrefEntry& a, const XrefEntry& b){
+		return std::tie(a.name, a.declFile, a.declLine, a.declCol)
+		  < std::tie(b.name, b.declFile, b.declLine, b.declCol);
+	});
+	out << view.str(symbol.name) << " declared at "
+	  << view.str(symbol.declFile) << ":" << symbol.declLine << ":"
+	  << symbol.declCol << "\n";
+	for (auto e = first; e != view.end() && sameSymbol(*e, symbol); ++e){
+		out << "\t" << view.str(e->file) << ":" << e->line << ":"
+		  << e->col << "\n";
+	}
+}
+
+/* The symbols with an occurrence at file:line:col, if query is
+   such a place */
+static bool symbolsAt(const XrefView& view, const std::string& query,
+  std::vector<XrefEntry>& symbols){
+	size_t colon2 = query.rfind(':');
+	if (colon2 == std::string::npos || colon2 == 0){ return false; }
+	size_t colon1 = query.rfind(':', colon2 - 1);
+	if (colon1 == std::string::npos){ return false; }
+	uint32_t file;
+	if (!view.findString(normalPath(query.substr(0, colon1)), file)){
+		return false;
+	}
+	uint32_t line = u32(std::strtoul(query.c_str() + colon1 + 1, nullptr, 10));
+	uint32_t col = u32(std::strtoul(query.c_str() + colon2 + 1, nullptr, 10));
+
+	const XrefEntry * entries = view.begin();
+	auto first = std::lower_bound(view.placeBegin(), view.placeEnd(), 0,
+	  [&](uint32_t e, int){
+		return std::tie(entries[e].file, entries[e].line)
+		  < std::tie(file, line);
+	});
+	for (auto e = first; e != view.placeEnd()
+	  && entries[*e].file == file && entries[*e].line == line; ++e){
+		if (entries[*e].col <= col && col < entries[*e].colEnd){
+			symbols.push_back(entries[*e]);
+		}
+	}
+	return true;
+}
+
+bool queryXrefIndex(const char * indexPath, const std::string& query,
+  std::ostream& out){
+	const char * data;
+	size_t len;
+	if (!mapFile(indexPath, data, len)){
+		std::cerr << "Cannot read index " << indexPath << "\n";
+		return false;
+	}
+	XrefView view;
+	if (!view.open(data, len)){
+		unmapFile(data, len);
+		std::cerr << "Not a cross-reference index: " << indexPath << "\n";
+		return false;
+	}
+
+	std::vector<XrefEntry> symbols;
+	uint32_t name;
+	if (!symbolsAt(view, query, symbols) && view.findString(query, name)){
+		// Every symbol by this name, one entry of each
+		XrefEntry key = XrefEntry{ name, 0, 0, 0, 0, 0, 0, 0 };
+		auto e = std::lower_bound(view.begin(), view.end(), key, bySymbol);
+		for (; e != view.end() && e->name == name; ++e){
+			if (symbols.empty() || !sameSymbol(symbols.back(), *e)){
+				symbols.push_back(*e);
+			}
+		}
+	}
+	for (auto& symbol : symbols){ printSymbol(view, symbol, out); }
+	unmapFile(data, len);
+	return true;
+}
+
+}
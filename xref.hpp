@@ -0,0 +1,43 @@
+#ifndef A_LANG_XREF_HPP
+#define A_LANG_XREF_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace a_lang{
+
+/** One occurrence of a symbol in a cross-reference index. A
+ * symbol is a name and the place it is declared; its own
+ * declaration is one of its occurrences. Names and files are
+ * ids into the index's sorted string table, so the order of ids
+ * is the order of the strings. **/
+class XrefEntry{
+public:
+	uint32_t name;
+	uint32_t declFile;
+	uint32_t declLine;
+	uint32_t declCol;
+	uint32_t file;
+	uint32_t line;
+	uint32_t col;
+	uint32_t colEnd;
+};
+
+/** Build a cross-reference index of the given files and write
+ * it to indexPath. Files that cannot be read or parsed are
+ * reported and left out of the index. Returns false if any file
+ * was left out, or the index could not be written. **/
+bool writeXrefIndex(const char * indexPath,
+  const std::vector<std::string>& files);
+
+/** Print every occurrence of the symbols that query names,
+ * grouped by declaration. The query is a name, or a place as
+ * file:line:col. Returns false if the index can't be read. **/
+bool queryXrefIndex(const char * indexPath, const std::string& query,
+  std::ostream& out);
+
+}
+
+#endif